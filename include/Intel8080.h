@@ -1,7 +1,16 @@
 #ifndef INTEL8080_INTEL8080_H
 #define INTEL8080_INTEL8080_H
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#ifdef INTEL8080_COUNTERS
+#include "Intel8080Counters.h"
+#endif
 
 /*
  * Intel 8080 Emulated Pinout:
@@ -36,7 +45,7 @@
  *
  * For more information on individual instructions see chapter 4 of the Intel 8080 user manual.
  */
-class Intel8080 {
+class alignas(64) Intel8080 {
 public:
     // address pins
     static constexpr std::uint_fast64_t A0 {1ULL << 0ULL};
@@ -145,6 +154,56 @@ public:
     // 8-bit bi-directional data bus
     static constexpr std::uint_fast64_t dbus {0xFF0000ULL};
 
+    /**
+     * Memory and I/O interface used by step() and run(). Instead of watching the pins every state, the processor calls
+     * these directly whenever the equivalent machine cycle would happen on the bus.
+     */
+    class Bus {
+    public:
+        virtual ~Bus() = default;
+
+        // memory read cycle (instruction fetch, memory read and stack read)
+        virtual std::uint8_t read(std::uint16_t addr) = 0;
+
+        // memory write cycle (memory write and stack write)
+        virtual void write(std::uint16_t addr, std::uint8_t val) = 0;
+
+        // input read cycle
+        virtual std::uint8_t in(std::uint8_t port) = 0;
+
+        // output write cycle
+        virtual void out(std::uint8_t port, std::uint8_t val) = 0;
+
+        // interrupt acknowledge cycle, should return the instruction to execute (usually RST n). Defaults to RST 7,
+        // which is what a floating data bus would read.
+        virtual std::uint8_t acknowledge() { return 0xFFU; }
+    };
+
+    /**
+     * Everything the processor keeps from one state to the next, including how far tick() has got through the current
+     * instruction, the interrupt flip-flops and the clock. It's plain bytes without any padding, so it can be copied with
+     * memcpy, written to a file or compared with memcmp. Memory isn't part of it (see Intel8080Memory.h).
+     */
+    struct State {
+        std::uint64_t pins;
+        std::uint64_t clock;
+        std::uint16_t pc, step;
+        std::uint16_t pair[5];
+        std::uint8_t status, ir, tmp, a, f;
+        bool stopped, intWhileHalt, intff, intreq;
+        std::uint8_t unused; // keeps the size a multiple of 8 without padding
+    };
+
+    Intel8080() = default;
+
+    // a copy's ir refers to its own instruction register instead of the original's
+    Intel8080(const Intel8080& other) { loadState(other.saveState()); }
+    Intel8080& operator=(const Intel8080& other)
+    {
+        loadState(other.saveState());
+        return *this;
+    }
+
     /**
      * Steps the processor one state forward. Each instruction consists of 1-5 machine cycles and 3-5 states (T1-T5)
      * constitute a machine cycle. A full instruction cycle requires anywhere from 4-18 states for its completion.
@@ -154,12 +213,79 @@ public:
      */
     void tick();
 
+    /**
+     * Calls tick() until any of the pins in eventMask go high, so the states where the processor doesn't need anything
+     * from the outside world don't have to go through the caller. For example, SYNC|DBIN|WR stops at the start of every
+     * machine cycle and at every read and write. Note the status bits (INTA-MEMR) are on the data bus, so they are only
+     * meaningful as events together with SYNC.
+     * @param eventMask the pins to stop on
+     * @param maxCycles the most states to run for if none of the pins go high
+     * @return the number of states that elapsed, including the one that raised the event
+     */
+    std::uint64_t runUntil(std::uint_fast64_t eventMask, std::uint64_t maxCycles);
+
+    /**
+     * Executes one whole instruction against the given bus instead of one state against the pins. This is a lot faster
+     * than tick() when you don't need to see every state, and the instruction takes exactly as many states as it would
+     * through tick() (without any wait states). The address, data and status pins are not driven, but the INT and INTE
+     * pins work the same way they do with tick().
+     *
+     * Only call this between instructions, i.e. not while tick() is in the middle of one.
+     * @param bus the memory and I/O the instruction will access
+     * @return the number of states the instruction took, or 1 if the processor is halted
+     */
+    unsigned step(Bus& bus);
+
+    /**
+     * Calls step() until at least cycleBudget states have elapsed. A halted processor can only be woken up by an
+     * interrupt, so if there is none the rest of the budget is spent idling.
+     * @param bus the memory and I/O the instructions will access
+     * @param cycleBudget the number of states to run for
+     * @return the number of states that actually elapsed (can overshoot the budget by the last instruction)
+     */
+    std::uint64_t run(Bus& bus, std::uint64_t cycleBudget);
+
     /**
      * Restores the processor's internal program counter to zero, and the cpu will begin the next cycle from T1. Note,
      * however, that this has no effect on status flags, or on any of the processor's working registers
      */
     void reset() { pc = step_ = 0; pins = 0ULL | READY; stopped_ = intff_ = intWhileHalt_ = false;  }
 
+    /**
+     * Takes a snapshot of the processor, which can be done at any state, even in the middle of an instruction.
+     * @return the complete state, which loadState() puts back exactly as it was
+     */
+    [[nodiscard]] State saveState() const
+    {
+        return {pins, clock_, pc, step_, {pair_[BC], pair_[DE], pair_[HL], pair_[SP], pair_[WZ]}, status, ir_, tmp_,
+            a_(), flags_(), stopped_, intWhileHalt_, intff_, intreq_, 0U};
+    }
+
+    /**
+     * Puts back a snapshot taken by saveState(), possibly of another processor. tick() and step() carry on from exactly
+     * where it was taken.
+     * @param state the snapshot
+     */
+    void loadState(const State& state)
+    {
+        pins = state.pins;
+        clock_ = state.clock;
+        pc = state.pc;
+        step_ = state.step;
+        for (int rp {0}; rp < 5; ++rp)
+            pair_[rp] = state.pair[rp];
+        status = state.status;
+        ir_ = state.ir;
+        tmp_ = state.tmp;
+        a_() = state.a;
+        f_() = state.f;
+        result_ = settled_;
+        stopped_ = state.stopped;
+        intWhileHalt_ = state.intWhileHalt;
+        intff_ = state.intff;
+        intreq_ = state.intreq;
+    }
+
     /**
      * Overloaded function to prevent a common bug. The data bus pins are bits 16-24. This function left-shifts a byte
      * the correct amount to set the pins.
@@ -189,28 +315,28 @@ public:
      * If the result of an instruction has the value 0, this flag is set; otherwise it is reset.
      * @return 1 if the zero flag is set; 0 otherwise
      */
-    [[nodiscard]] std::uint8_t z() const { return (f_ & zeroBit) >> 6U; }
+    [[nodiscard]] std::uint8_t z() const { return (f_() & zeroBit) >> 6U | (result_ == 0); }
 
     /**
      * If the modulo 2 sum of the bits of the result of the operation is 0, (i.e., if the result has even parity),
      * this flag is set; otherwise it is reset (i.e., if the result has odd parity).
      * @return 1 if the sign flag is set; 0 otherwise
      */
-    [[nodiscard]] std::uint8_t s() const { return (f_ & signBit) >> 7U; }
+    [[nodiscard]] std::uint8_t s() const { return ((f_() | result_) & signBit) >> 7U; }
 
     /**
      * If the most significant bit of the result of the operation has the value 1, this flag is set; otherwise it is
      * reset.
      * @return 1 if parity flag is set; 0 otherwise
      */
-    [[nodiscard]] std::uint8_t p() const { return (f_ & parityBit) >> 2U; }
+    [[nodiscard]] std::uint8_t p() const { return (flags_() & parityBit) >> 2U; }
 
     /**
      * If the instruction resulted in a carry (from addition), or a borrow (from subtraction or a comparison) out of the
      * high-order bit, this flag is set; otherwise it is reset.
      * @return 1 if carry flag is set; 0 otherwise
      */
-    [[nodiscard]] std::uint8_t cy() const { return f_ & carryBit; }
+    [[nodiscard]] std::uint8_t cy() const { return f_() & carryBit; }
 
     /**
      * Auxiliary Carry: If the instruction caused a carry out of bit 3 and into bit 4 of the resulting value, the
@@ -221,7 +347,7 @@ public:
      * (Decimal Adjust Accumulator) instruction.
      * @return 1 if the auxiliary carry flag is set; 0 otherwise
      */
-    [[nodiscard]] std::uint8_t ac() const { return (f_ & auxiliaryBit) >> 4U; }
+    [[nodiscard]] std::uint8_t ac() const { return (f_() & auxiliaryBit) >> 4U; }
 
     /**
      * For getting the value of a register based on register symbol names.
@@ -237,6 +363,30 @@ public:
      */
     [[nodiscard]] std::uint16_t getPair(const std::uint8_t rp) const { return pair_[rp]; }
 
+    /**
+     * Counts every state tick(), runUntil(), step() and run() have run, and never goes back by itself: reset() leaves it
+     * alone, only loadState() changes it. Devices can be timed off it (see Intel8080Scheduler.h).
+     * @return the states the processor has run for
+     */
+    [[nodiscard]] std::uint64_t clock() const { return clock_; }
+
+    /**
+     * The length of an instruction, from the same description the processor decodes it with.
+     * @param opcode the first byte of the instruction
+     * @return how many bytes the instruction takes, including the opcode
+     */
+    [[nodiscard]] static constexpr int length(const std::uint8_t opcode) { return decoded_[opcode].length; }
+
+#ifdef INTEL8080_COUNTERS
+    /**
+     * @return a snapshot of what the processor has spent its time on since it was constructed or the counters were
+     * last reset (see Intel8080Counters.h)
+     */
+    [[nodiscard]] Intel8080Counters counters() const { return counters_; }
+
+    void resetCounters() { counters_ = {}; }
+#endif
+
     // the cpu's program counter
     std::uint16_t pc {0};
 
@@ -267,20 +417,112 @@ private:
     static constexpr std::uint8_t carryBit {0b00000001U};
     static constexpr std::uint8_t auxiliaryBit {0b00010000U};
 
-    // set flag functions
-    void setZeroFlag_(const bool enabled) { enabled ? f_ |= zeroBit : f_ &= ~zeroBit; }
-    void setSignFlag_(const bool enabled) { enabled ? f_ |= signBit : f_ &= ~signBit; }
-    void setParityFlag_(const bool enabled) { enabled ? f_ |= parityBit : f_ &= ~parityBit; }
-    void setCarryFlag_(const bool enabled) { enabled ? f_ |= carryBit : f_ &= ~carryBit; }
-    void setAuxCarryFlag_(const bool enabled) { enabled ? f_ |= auxiliaryBit : f_ &= ~auxiliaryBit; }
+    // S, Z and P flags of every possible result
+    static constexpr std::array<std::uint8_t, 256> zspTable_ {[] {
+        std::array<std::uint8_t, 256> table {};
+        for (int val {0}; val < 256; ++val)
+            table[val] = (val & signBit) | (val == 0 ? zeroBit : 0U) | (std::popcount(unsigned(val)) % 2 == 0 ? parityBit : 0U);
+        return table;
+    }()};
+
+    /*
+     * The flags are kept half evaluated, since most results of arithmetic and logic never have their S, Z and P read
+     * before the next one replaces them (DCR followed by JNZ only needs Z). F always holds CY and AC, which are cheap
+     * to work out, and those instructions leave S, Z and P clear in F and just keep the result they're of in result_.
+     * Anything that sets the flags outright (POP PSW, DAA, loadState()) sets result_ to settled_, whose S, Z and P are
+     * all clear, so the flags are F alone.
+     */
+    static constexpr std::uint8_t settled_ {0x01U};
+    static_assert(zspTable_[settled_] == 0);
+
+    [[nodiscard]] std::uint8_t flags_() const { return f_() | zspTable_[result_]; }
+
+    // evaluates the flags in full into F, for code that reads and writes F directly
+    void settleFlags_()
+    {
+        if (result_ != settled_) {
+            f_() = flags_();
+            result_ = settled_;
+        }
+    }
+
+    // S, Z, AC and P flags (and bit 1) of every possible INR result. the only case for half carry is 01111 + 1 = 10000
+    static constexpr std::array<std::uint8_t, 256> inrTable_ {[] {
+        std::array<std::uint8_t, 256> table {};
+        for (int val {0}; val < 256; ++val)
+            table[val] = zspTable_[val] | ((val & 0xF) == 0 ? auxiliaryBit : 0U) | 0b10U;
+        return table;
+    }()};
+
+    // S, Z, AC and P flags (and bit 1) of every possible DCR result. the only case for half borrow is 10000 - 1 = 01111
+    static constexpr std::array<std::uint8_t, 256> dcrTable_ {[] {
+        std::array<std::uint8_t, 256> table {};
+        for (int val {0}; val < 256; ++val)
+            table[val] = zspTable_[val] | ((val & 0xF) != 0xF ? auxiliaryBit : 0U) | 0b10U;
+        return table;
+    }()};
+
+    // accumulator (high byte) and flags (low byte) after DAA, indexed by CY << 9 | AC << 8 | A
+    static constexpr std::array<std::uint16_t, 1024> daaTable_ {[] {
+        std::array<std::uint16_t, 1024> table {};
+        for (int i {0}; i < 1024; ++i) {
+            const int a {i & 0xFF}, ac {i >> 8 & 1}, cy {i >> 9 & 1};
+            const int msb {a & 0xF0}, lsb {a & 0xF};
+            int addend {lsb > 9 or ac ? 6 : 0};
+            int flags {lsb + addend > 0xF ? auxiliaryBit : 0};
+
+            if (msb > 0x90 or cy or (msb >= 0x90 and lsb > 9)) {
+                addend += 0x60;
+                flags |= carryBit;
+            } else {
+                flags |= cy;
+            }
+
+            const int res {(a + addend) & 0xFF};
+            table[i] = res << 8 | zspTable_[res] | flags | 0b10;
+        }
+        return table;
+    }()};
+
+    // A and F as a pair in the register file, the way PUSH PSW puts them on the stack
+    static constexpr std::uint8_t AF {5U};
+
+    static constexpr bool littleEndian_ {std::endian::native == std::endian::little};
+    static_assert(littleEndian_ or std::endian::native == std::endian::big, "pairs need a little or big-endian host");
+
+    // where B, C, D, E, H, L, (M,) A and F are in the register file, by their 3-bit fields in the opcodes: the high
+    // byte of BC, DE, HL or AF for B, D, H and A, and the low byte for C, E, L and F
+    static constexpr std::array<std::uint8_t, 9> offset_ {[] {
+        const auto hi {[](const int rp) -> std::uint8_t { return 2 * rp + littleEndian_; }};
+        const auto lo {[](const int rp) -> std::uint8_t { return 2 * rp + !littleEndian_; }};
+        return std::array<std::uint8_t, 9> {hi(BC), lo(BC), hi(DE), lo(DE), hi(HL), lo(HL), 0xFFU, hi(AF), lo(AF)};
+    }()};
+
+    // the register file a byte at a time
+    [[nodiscard]] std::uint8_t* bytes_() { return reinterpret_cast<std::uint8_t*>(pair_); }
+    [[nodiscard]] const std::uint8_t* bytes_() const { return reinterpret_cast<const std::uint8_t*>(pair_); }
+    std::uint8_t& a_() { return bytes_()[offset_[A]]; }
+    [[nodiscard]] std::uint8_t a_() const { return bytes_()[offset_[A]]; }
+    std::uint8_t& f_() { return bytes_()[offset_[F]]; }
+    [[nodiscard]] std::uint8_t f_() const { return bytes_()[offset_[F]]; }
 
     // symbol functions (see ch4 intel 8080 data sheet)
     [[nodiscard]] std::uint8_t rp_() const { return (ir_ & 0b110000U) >> 4U; }
     [[nodiscard]] std::uint8_t dst_() const { return (ir_ & 0b111000U) >> 3U; }
     [[nodiscard]] std::uint8_t src_() const { return ir_ & 0b111U; }
     [[nodiscard]] std::uint8_t nnn_() const { return ir_ & 0b111000; }
-    [[nodiscard]] std::uint8_t psw_() const { return f_; }
+    [[nodiscard]] std::uint8_t psw_() const { return flags_(); }
     [[nodiscard]] bool ccc_() const;
+    template<std::uint8_t ccc> [[nodiscard]] bool condition_() const; // ccc_() with the condition known at compile time
+
+    // passes on whether a conditional jump, call or return is taken, counting it when the counters are compiled in
+    bool branch_(const bool taken)
+    {
+#ifdef INTEL8080_COUNTERS
+        ++(taken ? counters_.taken : counters_.notTaken);
+#endif
+        return taken;
+    }
 
     // common pin manipulation functions
     void setABus_(std::uint16_t val) { pins = pins & ~0xFFFFULL | val; }
@@ -290,11 +532,30 @@ private:
 
     // helper functions
     void setReg_(std::uint8_t, std::uint8_t);
-    void setHi_(const std::uint8_t rp, std::uint8_t val) { pair_[rp] = (pair_[rp] & 0x00FF) | (val << 8U); }
-    void setLo_(const std::uint8_t rp, std::uint8_t val) { pair_[rp] = (pair_[rp] & 0xFF00) | val; }
+    void setHi_(const std::uint8_t rp, std::uint8_t val) { bytes_()[2 * rp + littleEndian_] = val; }
+    void setLo_(const std::uint8_t rp, std::uint8_t val) { bytes_()[2 * rp + !littleEndian_] = val; }
     [[nodiscard]] static std::uint8_t hi_(const std::uint16_t val) { return (val & 0xFF00) >> 8U; }
     [[nodiscard]] static std::uint8_t lo_(const std::uint16_t val) { return val & 0xFF; }
 
+    // getReg() and setReg_() with the register known at compile time, for the instruction-stepped engine
+    template<std::uint8_t r>
+    [[nodiscard]] std::uint8_t reg_() const
+    {
+        static_assert(offset_[r] != 0xFFU);
+        return bytes_()[offset_[r]];
+    }
+
+    template<std::uint8_t r>
+    void setReg_(const std::uint8_t val)
+    {
+        static_assert(offset_[r] != 0xFFU);
+        bytes_()[offset_[r]] = val;
+    }
+
+    // the T-state machine behind tick() (batch is false) and runUntil()
+    template<bool batch>
+    std::uint64_t tick_(std::uint_fast64_t eventMask, std::uint64_t maxCycles);
+
     // state functions
     void t1_(); // ONLY TO BE CALLED AFTER setDBus() CALL
     void t2_();;
@@ -321,23 +582,297 @@ private:
     void xra_(std::uint8_t);
     void ora_(std::uint8_t);
     void cmp_(std::uint8_t);
-
-    // flag helper functions
-    void carryFlagsAlg_();
-    void carryFlagsAnd_(std::uint8_t);
-    void carryFlagsAdd_(std::uint8_t, std::uint8_t cy= 0);
-    void carryFlagsSub_(std::uint8_t, std::uint8_t cy= 0);
-    void zspFlags_(std::uint8_t);
-
+    void dad_(std::uint16_t);
+    void daa_();
+    void rlc_();
+    void rrc_();
+    void ral_();
+    void rar_();
+
+    // instruction-stepped engine (see Intel8080Core.h)
+    template<class> friend class Intel8080Core;
+    template<class> friend class Intel8080BlockCache;
+    template<class> friend class Intel8080Jit;
+    friend class Intel8080Translator;
+    friend struct Intel8080Counters;
+    friend class Intel8080Profiler;
+    template<std::size_t, class> friend class Intel8080Lockstep;
+    template<class Policy> unsigned execute_(Policy&);
+    template<class Policy> unsigned execute_(Policy&, std::uint16_t);
+    template<std::uint8_t opcode, class Policy> unsigned instruction_(Policy&, std::uint16_t);
+    template<class Policy> std::uint64_t run_(Policy&, std::uint64_t);
+    template<class Policy> std::uint64_t runBlocks_(Policy&, std::uint64_t);
+    [[nodiscard]] bool interruptPending_() const { return intreq_ or (pins & INT and pins & INTE); }
+
+    // an instruction as tick() and step() tell them apart
+    struct Instruction {
+        std::string_view mnemonic;
+        std::string_view pattern; // bits 7-0 of its opcodes, with a letter for the bits of an operand field
+        std::uint8_t length;      // bytes, including the opcode
+        std::string_view cycles;  // the states of each machine cycle, the first including the three of the fetch, and
+                                  // a | where a conditional call or return stops when it isn't taken
+    };
+
+    /*
+     * Every instruction, in the order of their states in tick(). The tables below are all generated from it, and
+     * checked against the state counts of the Intel 8080 Microcomputer Systems User's Manual further down. When two
+     * patterns match an opcode, the one with more fixed bits wins, e.g. HLT over MOV M, r.
+     */
+    static constexpr Instruction instructions_[] {
+            {"MOV r1, r2", "01dddsss", 1, "5"},
+            {"MOV r, M", "01ddd110", 1, "4 3"},
+            {"MOV M, r", "01110sss", 1, "4 3"},
+            {"SPHL", "11111001", 1, "5"},
+            {"MVI r, data", "00ddd110", 2, "4 3"},
+            {"MVI M, data", "00110110", 2, "4 3 3"},
+            {"LXI rp, data", "00pp0001", 3, "4 3 3"},
+            {"LDA addr", "00111010", 3, "4 3 3 3"},
+            {"STA addr", "00110010", 3, "4 3 3 3"},
+            {"LHLD addr", "00101010", 3, "4 3 3 3 3"},
+            {"SHLD addr", "00100010", 3, "4 3 3 3 3"},
+            {"LDAX rp", "000p1010", 1, "4 3"},
+            {"STAX rp", "000p0010", 1, "4 3"},
+            {"XCHG", "11101011", 1, "4"},
+            {"ADD r", "10000sss", 1, "4"},
+            {"ADD M", "10000110", 1, "4 3"},
+            {"ADI data", "11000110", 2, "4 3"},
+            {"ADC r", "10001sss", 1, "4"},
+            {"ADC M", "10001110", 1, "4 3"},
+            {"ACI data", "11001110", 2, "4 3"},
+            {"SUB r", "10010sss", 1, "4"},
+            {"SUB M", "10010110", 1, "4 3"},
+            {"SUI data", "11010110", 2, "4 3"},
+            {"SBB r", "10011sss", 1, "4"},
+            {"SBB M", "10011110", 1, "4 3"},
+            {"SBI data", "11011110", 2, "4 3"},
+            {"INR r", "00ddd100", 1, "5"},
+            {"INR M", "00110100", 1, "4 3 3"},
+            {"DCR r", "00ddd101", 1, "5"},
+            {"DCR M", "00110101", 1, "4 3 3"},
+            {"INX rp", "00pp0011", 1, "5"},
+            {"DCX rp", "00pp1011", 1, "5"},
+            {"DAD rp", "00pp1001", 1, "4 3 3"},
+            {"DAA", "00100111", 1, "4"},
+            {"ANA r", "10100sss", 1, "4"},
+            {"ANA M", "10100110", 1, "4 3"},
+            {"ANI data", "11100110", 2, "4 3"},
+            {"XRA r", "10101sss", 1, "4"},
+            {"XRA M", "10101110", 1, "4 3"},
+            {"XRI data", "11101110", 2, "4 3"},
+            {"ORA r", "10110sss", 1, "4"},
+            {"ORA M", "10110110", 1, "4 3"},
+            {"ORI data", "11110110", 2, "4 3"},
+            {"CMP r", "10111sss", 1, "4"},
+            {"CMP M", "10111110", 1, "4 3"},
+            {"CPI data", "11111110", 2, "4 3"},
+            {"RLC", "00000111", 1, "4"},
+            {"RRC", "00001111", 1, "4"},
+            {"RAL", "00010111", 1, "4"},
+            {"RAR", "00011111", 1, "4"},
+            {"CMA", "00101111", 1, "4"},
+            {"CMC", "00111111", 1, "4"},
+            {"STC", "00110111", 1, "4"},
+            {"JMP addr", "1100x011", 3, "4 3 3"},    // and the undocumented CB
+            {"J cond addr", "11ccc010", 3, "4 3 3"},
+            {"CALL addr", "11xx1101", 3, "5 3 3 3 3"}, // and the undocumented DD, ED and FD
+            {"C cond addr", "11ccc100", 3, "5 3 3|3 3"},
+            {"RET", "110x1001", 1, "4 3 3"},         // and the undocumented D9
+            {"R cond addr", "11ccc000", 1, "5|3 3"},
+            {"RST n", "11nnn111", 1, "5 3 3"},
+            {"PCHL", "11101001", 1, "5"},
+            {"PUSH rp", "11pp0101", 1, "5 3 3"},
+            {"PUSH PSW", "11110101", 1, "5 3 3"},
+            {"POP rp", "11pp0001", 1, "4 3 3"},
+            {"POP PSW", "11110001", 1, "4 3 3"},
+            {"XTHL", "11100011", 1, "4 3 3 3 5"},
+            {"IN port", "11011011", 2, "4 3 3"},
+            {"OUT port", "11010011", 2, "4 3 3"},
+            {"EI", "11111011", 1, "4"},
+            {"DI", "11110011", 1, "4"},
+            {"HLT", "01110110", 1, "4 2"},           // the manual's seventh state is the first one halted
+            {"NOP", "00xxx000", 1, "4"},             // and the undocumented 08, 10, 18, 20, 28, 30 and 38
+    };
+    static constexpr int instructionCount_ {std::size(instructions_)};
+
+    // the index of an instruction in instructions_[] by its mnemonic, so code that tells instructions apart names them
+    // instead of depending on their order. a mnemonic that isn't there doesn't compile
+    static constexpr auto index_ {[](const std::string_view mnemonic) {
+        for (int i {0}; i < instructionCount_; ++i)
+            if (instructions_[i].mnemonic == mnemonic)
+                return i;
+        throw "no instruction has that mnemonic";
+    }};
+
+    // the ALU instructions come in threes, a register, M and immediate data, in the order of their opcodes, which the
+    // translator and the lockstep engine work the operand and the operation out from
+    static_assert([] {
+        const std::string_view alu[] {"ADD", "ADC", "SUB", "SBB", "ANA", "XRA", "ORA", "CMP"};
+        const std::string_view immediate[] {"ADI", "ACI", "SUI", "SBI", "ANI", "XRI", "ORI", "CPI"};
+        for (int i {0}; i < 8; ++i) {
+            const int first {index_(i < 4 ? "ADD r" : "ANA r") + i % 4 * 3};
+            if (instructions_[first].mnemonic.substr(0, 3) != alu[i]
+                or instructions_[first + 1].mnemonic.substr(0, 3) != alu[i]
+                or instructions_[first + 2].mnemonic.substr(0, 3) != immediate[i])
+                return false;
+        }
+        return true;
+    }());
+
+    // the sum of the states in a cycles string of instructions_[]
+    static constexpr auto states_ {[](const std::string_view cycles) {
+        unsigned sum {0};
+        for (const char c : cycles)
+            sum += c >= '0' and c <= '9' ? c - '0' : 0;
+        return sum;
+    }};
+
+    // number of states each instruction takes through tick() (without wait states), including the three fetch states
+    static constexpr std::array<unsigned, instructionCount_> cycles_ {[] {
+        std::array<unsigned, instructionCount_> table {};
+        for (int i {0}; i < instructionCount_; ++i)
+            table[i] = states_(instructions_[i].cycles);
+        return table;
+    }()};
+
+    // states skipped by a conditional call or return whose condition isn't met
+    static constexpr unsigned notTaken_ {[] {
+        const std::string_view call {instructions_[index_("C cond addr")].cycles};
+        return states_(call.substr(call.find('|')));
+    }()};
+    static_assert([] {
+        const std::string_view ret {instructions_[index_("R cond addr")].cycles};
+        return states_(ret.substr(ret.find('|'))) == notTaken_;
+    }(), "a conditional call and return skip the same states, which tick() relies on");
+
+    // first state of each instruction in tick(), which lays them out one after the other from the end of the fetch
+    static constexpr std::array<int, instructionCount_> mnemonic_ {[] {
+        std::array<int, instructionCount_> table {};
+        for (int i {0}, first {3}; i < instructionCount_; first += static_cast<int>(cycles_[i]) - 3, ++i)
+            table[i] = first;
+        return table;
+    }()};
+
+    // the states of tick(), the three of the fetch and then those of every instruction
+    static constexpr int stateCount_ {
+            mnemonic_[instructionCount_ - 1] + static_cast<int>(cycles_[instructionCount_ - 1]) - 3};
+
+    // index into mnemonic_[] for every opcode, or -1 when the patterns are wrong (no match, or two equally good ones)
+    static constexpr std::array<int, 256> opcode_ {[] {
+        std::array<int, 256> table {};
+        for (int opcode {0}; opcode < 256; ++opcode) {
+            int best {-1}, bestFixed {-1};
+            bool tie {false};
+            for (int i {0}; i < instructionCount_; ++i) {
+                int fixed {0};
+                bool matches {true};
+                for (int bit {0}; bit < 8; ++bit) {
+                    const char c {instructions_[i].pattern[7 - bit]};
+                    if (c == '0' or c == '1') {
+                        matches = matches and (opcode >> bit & 1) == c - '0';
+                        ++fixed;
+                    }
+                }
+                if (matches and fixed == bestFixed)
+                    tie = true;
+                if (matches and fixed > bestFixed) {
+                    best = i;
+                    bestFixed = fixed;
+                    tie = false;
+                }
+            }
+            table[opcode] = tie ? -1 : best;
+        }
+        return table;
+    }()};
+    static_assert(std::ranges::none_of(opcode_, [](const int i) { return i < 0; }),
+                  "every opcode decodes to exactly one instruction");
+
+    // number of bytes in each instruction, including the opcode
+    static constexpr std::array<std::uint8_t, instructionCount_> length_ {[] {
+        std::array<std::uint8_t, instructionCount_> table {};
+        for (int i {0}; i < instructionCount_; ++i)
+            table[i] = instructions_[i].length;
+        return table;
+    }()};
+
+    // the instruction and length of every opcode, so step() and the block cache decode with a single lookup
+    struct Decoded {
+        std::uint8_t instruction;
+        std::uint8_t length;
+    };
+    static constexpr std::array<Decoded, 256> decoded_ {[] {
+        std::array<Decoded, 256> table {};
+        for (int opcode {0}; opcode < 256; ++opcode)
+            table[opcode] = {static_cast<std::uint8_t>(opcode_[opcode]), length_[opcode_[opcode]]};
+        return table;
+    }()};
+
+    // the first state of an instruction in tick(), by its mnemonic, for checking the labels there
+    static constexpr int first_(const std::string_view mnemonic) { return mnemonic_[index_(mnemonic)]; }
+
+
+    // the states of every opcode from the manual's instruction set summary, with a conditional call or return taken,
+    // and the undocumented opcodes timed as the instruction they decode to
+    static constexpr std::uint8_t manual_[256] {
+             4, 10,  7,  5,  5,  5,  7,  4,  4, 10,  7,  5,  5,  5,  7,  4,
+             4, 10,  7,  5,  5,  5,  7,  4,  4, 10,  7,  5,  5,  5,  7,  4,
+             4, 10, 16,  5,  5,  5,  7,  4,  4, 10, 16,  5,  5,  5,  7,  4,
+             4, 10, 13,  5, 10, 10, 10,  4,  4, 10, 13,  5,  5,  5,  7,  4,
+             5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,
+             5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,
+             5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,
+             7,  7,  7,  7,  7,  7,  7,  7,  5,  5,  5,  5,  5,  5,  7,  5,
+             4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+             4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+             4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+             4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+            11, 10, 10, 10, 17, 11,  7, 11, 11, 10, 10, 10, 17, 17,  7, 11,
+            11, 10, 10, 10, 17, 11,  7, 11, 11, 10, 10, 10, 17, 17,  7, 11,
+            11, 10, 10, 18, 17, 11,  7, 11, 11,  5, 10,  4, 17, 17,  7, 11,
+            11, 10, 10,  4, 17, 11,  7, 11, 11,  5, 10,  4, 17, 17,  7, 11,
+    };
+
+    static_assert([] {
+        for (int opcode {0}; opcode < 256; ++opcode)
+            if (cycles_[opcode_[opcode]] + (opcode == 0x76) != manual_[opcode])
+                return false;
+        return true;
+    }(), "every opcode takes as many states as the manual says");
+    // C cond 11/17 and R cond 5/11 in the manual
+    static_assert(notTaken_ == 6 and cycles_[index_("C cond addr")] - notTaken_ == 11
+                  and cycles_[index_("R cond addr")] - notTaken_ == 5);
+
+    // with pc and pins at the start and the class aligned to 64 bytes, everything an instruction touches up to clock_
+    // is in one cache line
     std::uint16_t step_ {0};
     bool stopped_ {false};
     bool intWhileHalt_ {false};
     bool intff_ {false}, intreq_ {false};
 
-    // registers
+    // the register file, 16 bytes: the pairs BC, DE, HL, SP, WZ and AF in the host's byte order, so the 8-bit registers
+    // are bytes of them (see offset_), then the internal registers
+    alignas(16) std::uint16_t pair_[6] {0U, 0U, 0U, 0U, 0U, 0b10U};
     std::uint8_t ir_ {0}, tmp_ {0};
-    std::uint8_t a_ {0}, f_ {0b10U};
-    std::uint16_t pair_[5] {};
+    std::uint8_t result_ {settled_}; // the result S, Z and P are of, see flags_()
+
+    std::uint64_t clock_ {0}; // states run for before the current call of tick(), runUntil(), step() or run()
+
+#ifdef INTEL8080_COUNTERS
+    Intel8080Counters counters_ {};
+    std::uint64_t begun_ {0}; // clock_ at the fetch of the current instruction
+#endif
 };
 
+static_assert(std::is_trivially_copyable_v<Intel8080::State> and std::is_standard_layout_v<Intel8080::State>);
+static_assert(std::has_unique_object_representations_v<Intel8080::State>, "State shouldn't have any padding");
+#ifndef INTEL8080_COUNTERS
+static_assert(sizeof(Intel8080) == 64, "the processor should take exactly one cache line");
+#endif
+
+inline std::uint8_t Intel8080::getReg(const std::uint8_t r) const {
+    if (r == F)
+        return flags_();
+    return r < F and offset_[r] != 0xFFU ? bytes_()[offset_[r]] : 0xFFU;
+}
+
 #endif //INTEL8080_INTEL8080_H
@@ -0,0 +1,110 @@
+#ifndef INTEL8080_INTEL8080BANKS_H
+#define INTEL8080_INTEL8080BANKS_H
+
+#include "Intel8080MemoryMap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+/*
+ * Bank switching for boards with more memory than the 64K the processor can address. Windows of the address space show
+ * one bank of a larger backing store at a time, and an OUT to a window's port picks which. Switching only points the
+ * window's pages of an Intel8080MemoryMap somewhere else in the store, nothing is copied. For example,
+ *      struct Machine : Intel8080MemoryMap {
+ *          std::uint8_t in(std::uint8_t port);
+ *          void out(std::uint8_t port, std::uint8_t val)
+ *          {
+ *              if (!banks.out(port, val))
+ *                  ... the other ports ...
+ *          }
+ *          std::vector<std::uint8_t> store = std::vector<std::uint8_t>(512 * 1024);
+ *          Intel8080Banks banks {*this, store};
+ *      };
+ *      Intel8080Core<Intel8080BlockCache<Machine>> intel8080 {};
+ *      intel8080.bus.policy.mapRam(0xC0, common);          // C000-FFFF never changes
+ *      intel8080.bus.policy.banks.addWindow(0x00, 0x40, 0); // 0000-3FFF, banked by OUT 0
+ *      intel8080.bus.policy.banks.addWindow(0x40, 0x40, 1); // 4000-7FFF, banked by OUT 1
+ *
+ * The bank is the value written, modulo the number of banks of the window's size in the store, and every window starts
+ * out on bank 0. Intel8080BlockCache throws away the blocks of the pages a switch maps to something else. The banks
+ * point at the map, so a machine like the one above can't be copied or moved once it's set up.
+ */
+class Intel8080Banks {
+public:
+    struct Window {
+        std::uint8_t first; // the high byte of the first address
+        std::size_t pages;
+        std::uint8_t port;
+        bool readOnly;      // banks of ROM
+        std::size_t bank {0};
+    };
+
+    /**
+     * @param map where the windows are
+     * @param store every bank, which has to outlive this and hold at least one bank of every window (see addWindow())
+     */
+    Intel8080Banks(Intel8080MemoryMap& map, const std::span<std::uint8_t> store) : map_ {map}, store_ {store} {}
+
+    /**
+     * Adds a window, mapped to bank 0 right away.
+     * @param first the high byte of its first address
+     * @param pages how many 256-byte pages it takes, which is also the size of its banks
+     * @param port the output port that selects its bank
+     * @return the window's number
+     * @throws std::invalid_argument if the window has no pages or the store can't hold one bank of it
+     */
+    int addWindow(const std::uint8_t first, const std::size_t pages, const std::uint8_t port, const bool readOnly = false)
+    {
+        if (pages == 0 or store_.size() < pages * Intel8080MemoryMap::pageSize)
+            throw std::invalid_argument {"a window needs at least one page and a store that holds one bank of it"};
+        windows_.push_back({first, pages, port, readOnly});
+        select(static_cast<int>(windows_.size()) - 1, 0);
+        return static_cast<int>(windows_.size()) - 1;
+    }
+
+    /**
+     * Switches every window on the port to the bank in val.
+     * @return whether the port selects banks, otherwise it's for something else
+     */
+    bool out(const std::uint8_t port, const std::uint8_t val)
+    {
+        bool banked {false};
+        for (int i {0}; i < static_cast<int>(windows_.size()); ++i) {
+            if (windows_[i].port == port) {
+                select(i, val);
+                banked = true;
+            }
+        }
+        return banked;
+    }
+
+    // maps a window to a bank, whichever port it's on
+    void select(const int window, const std::size_t bank)
+    {
+        Window& w {windows_[window]};
+        const std::size_t size {w.pages * Intel8080MemoryMap::pageSize};
+        w.bank = bank % banks(window);
+        const std::span<std::uint8_t> memory {store_.subspan(w.bank * size, size)};
+        if (w.readOnly)
+            map_.mapRom(w.first, memory);
+        else
+            map_.mapRam(w.first, memory);
+    }
+
+    [[nodiscard]] const Window& window(const int window) const { return windows_[window]; }
+
+    // how many banks the window can switch between
+    [[nodiscard]] std::size_t banks(const int window) const
+    {
+        return store_.size() / (windows_[window].pages * Intel8080MemoryMap::pageSize);
+    }
+private:
+    Intel8080MemoryMap& map_;
+    std::span<std::uint8_t> store_;
+    std::vector<Window> windows_ {};
+};
+
+#endif //INTEL8080_INTEL8080BANKS_H
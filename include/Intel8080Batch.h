@@ -0,0 +1,83 @@
+#ifndef INTEL8080_INTEL8080BATCH_H
+#define INTEL8080_INTEL8080BATCH_H
+
+#include "Intel8080.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/*
+ * Runs lots of independent programs (regression ROMs, fuzz cases, parameter sweeps) on a pool of threads. For example,
+ *      Intel8080Batch batch {};
+ *      std::vector<Intel8080Batch::Result> results {batch.run(jobs)};
+ *
+ * Every thread has its own processor and 64K of memory, which it reuses for one job after another, putting both back
+ * the way they were at power-on first, so a job runs the same whichever job came before it. Jobs are dealt out
+ * to the threads up front, and a thread that runs out of its own steals from the others, so a few long jobs don't keep
+ * the rest of the pool waiting. Each job runs on the instruction-stepped engine (see Intel8080Core.h), so its states are
+ * counted exactly like step() counts them.
+ */
+class Intel8080Batch {
+public:
+    using Memory = std::array<std::uint8_t, 0x10000>;
+
+    // the job as its port handlers see it
+    struct Machine {
+        Intel8080& cpu;
+        Memory& memory;
+        std::vector<std::uint8_t> output {}; // whatever the handlers want to hand back with the result
+        bool running {true};                 // clear to end the job after the current instruction
+    };
+
+    struct Job {
+        std::vector<std::uint8_t> image {};
+        std::uint16_t loadAddress {0x100};
+        std::uint16_t entry {0x100};
+        std::uint64_t cycleBudget {~0ULL};
+        // bytes written over memory after loading the image, e.g. to stub out an operating system
+        std::vector<std::pair<std::uint16_t, std::uint8_t>> patches {};
+        // IN and OUT, either of which can be left empty (IN then reads 0)
+        std::function<std::uint8_t(Machine&, std::uint8_t port)> in {};
+        std::function<void(Machine&, std::uint8_t port, std::uint8_t val)> out {};
+    };
+
+    enum class Exit {
+        stopped, // a port handler cleared running
+        halted,  // HLT, and with nothing to interrupt it the job can't go on
+        budget   // the cycle budget ran out
+    };
+
+    struct Result {
+        std::uint64_t cycles {0};
+        std::uint64_t instructions {0};
+        std::vector<std::uint8_t> output {};
+        Exit exit {Exit::budget};
+    };
+
+    /**
+     * @param threads the number of threads to run jobs on, or 0 for one per hardware thread
+     */
+    explicit Intel8080Batch(unsigned threads = 0);
+
+    /**
+     * Runs every job and waits for all of them. If a port handler throws, the rest of the jobs still run and the first
+     * exception is rethrown from here.
+     * @param jobs the jobs, which have to stay alive until this returns
+     * @return the results, in the same order as the jobs
+     */
+    [[nodiscard]] std::vector<Result> run(const std::vector<Job>& jobs) const;
+
+    /**
+     * Runs a single job on the calling thread.
+     */
+    [[nodiscard]] static Result run(const Job& job);
+
+    [[nodiscard]] unsigned threads() const { return threads_; }
+private:
+    unsigned threads_;
+};
+
+#endif //INTEL8080_INTEL8080BATCH_H
@@ -0,0 +1,198 @@
+#ifndef INTEL8080_INTEL8080BLOCKCACHE_H
+#define INTEL8080_INTEL8080BLOCKCACHE_H
+
+#include "Intel8080.h"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/*
+ * Bus policy for Intel8080Core that sits in front of another one and keeps the instructions it has already decoded, so
+ * Intel8080Core::run() doesn't have to fetch and decode the same code over and over. For example,
+ *      Intel8080Core<Intel8080BlockCache<Memory>> intel8080 {};
+ *      intel8080.bus.policy.load(program); // whatever Memory does
+ *
+ * Decoded instructions are kept in blocks of straight-line code, from the address the processor first ran them from up
+ * to the next unconditional jump, call, return or HLT (a conditional one that is taken leaves the block early). Blocks
+ * are found by their address modulo maxBlocks, so a block that collides with another is simply decoded again.
+ *
+ * Every 256-byte page of memory has a generation that goes up whenever the processor writes to a byte of it that has
+ * been decoded as code. A block remembers the generation of the (at most two) pages it was decoded from and is thrown
+ * away once either of them changes, so self-modifying code behaves exactly the same as without the cache, while data
+ * sharing a page with code doesn't keep throwing its blocks away. Memory that changes without the processor writing it
+ * (DMA, loading a program) needs a call to invalidate(), except when the policy is an Intel8080MemoryMap (or has its
+ * remaps() and remapped()): pages it maps to something else are invalidated whoever maps them, the program, the host,
+ * a scheduler callback or a device.
+ *
+ * The code is decoded by reading it through the wrapped policy's read(), possibly ahead of where the processor gets to,
+ * so don't use this if reading memory has side effects.
+ */
+template<class Policy>
+class Intel8080BlockCache {
+public:
+    // most instructions kept in a single block
+    static constexpr int maxInstructions {16};
+
+    // number of blocks kept at once
+    static constexpr int maxBlocks {4096};
+
+    struct Instruction {
+        std::uint8_t opcode;
+        std::uint8_t instruction; // index into Intel8080::instructions_[]
+        std::uint8_t length;
+        bool sideEffects;         // writes to memory or does I/O, either of which can change the code
+        std::uint16_t data;       // the data bytes following the opcode
+    };
+
+    struct Block {
+        std::uint16_t pc {0};
+        int size {0};
+        std::uint8_t page[2] {};
+        std::uint64_t generation[2] {};
+        std::array<Instruction, maxInstructions> code {};
+    };
+
+    Intel8080BlockCache() = default;
+    explicit Intel8080BlockCache(Policy policy) : policy {policy} {}
+
+    std::uint8_t read(const std::uint16_t addr) { return policy.read(addr); }
+
+    void write(const std::uint16_t addr, const std::uint8_t val)
+    {
+        if (code_[addr])
+            ++generation_[addr >> 8U];
+        policy.write(addr, val);
+        remapped_();
+    }
+
+    std::uint8_t in(const std::uint8_t port) { return policy.in(port); }
+
+    void out(const std::uint8_t port, const std::uint8_t val)
+    {
+        policy.out(port, val);
+        remapped_();
+    }
+
+    std::uint8_t acknowledge()
+    {
+        if constexpr (requires { policy.acknowledge(); })
+            return policy.acknowledge();
+        else
+            return 0xFFU; // RST 7
+    }
+
+    /**
+     * Finds the block starting at pc, decoding it first if it isn't cached or the memory under it has changed.
+     * @param pc the address of the first instruction
+     * @return the decoded block, valid until the next call
+     */
+    const Block& block(const std::uint16_t pc)
+    {
+        remapped_();
+        Block& block {blocks_[pc % maxBlocks]};
+        if (block.size == 0 or block.pc != pc or !valid(block))
+            decode_(block, pc);
+        return block;
+    }
+
+    /**
+     * @return true if none of the memory the block was decoded from has been written since
+     */
+    [[nodiscard]] bool valid(const Block& block) const
+    {
+        return generation_[block.page[0]] == block.generation[0] and generation_[block.page[1]] == block.generation[1];
+    }
+
+    /**
+     * Forgets every block decoded from the given page.
+     * @param page the high byte of the addresses that changed
+     */
+    void invalidate(const std::uint8_t page) { ++generation_[page]; }
+
+    /**
+     * Forgets every block.
+     */
+    void invalidate()
+    {
+        for (auto& generation : generation_)
+            ++generation;
+    }
+
+    // the memory and I/O underneath the cache
+    [[no_unique_address]] Policy policy {};
+protected:
+    std::array<std::uint64_t, 256> generation_ {};
+    // every byte that has ever been decoded, since the blocks that were decoded from it could still be around
+    std::vector<std::uint8_t> code_ = std::vector<std::uint8_t>(0x10000);
+
+    // invalidates the pages the policy has mapped to something else since the last time, or every page if it's mapped
+    // too many to remember which
+    void remapped_()
+    {
+        if constexpr (requires { policy.remaps(); policy.remapped(remaps_); }) {
+            if (policy.remaps() == remaps_) [[likely]]
+                return;
+            if (policy.remaps() - remaps_ > 256)
+                invalidate();
+            else
+                for (; remaps_ != policy.remaps(); ++remaps_)
+                    invalidate(policy.remapped(remaps_));
+            remaps_ = policy.remaps();
+        }
+    }
+
+    std::uint64_t remaps_ {0};
+private:
+    // the conditional jumps, calls and returns only end the block when they are taken
+    static constexpr std::array<bool, Intel8080::instructionCount_> ends_ {[] {
+        std::array<bool, Intel8080::instructionCount_> table {};
+        for (const std::string_view mnemonic : {"JMP addr", "CALL addr", "RET", "RST n", "PCHL", "HLT"})
+            table[Intel8080::index_(mnemonic)] = true;
+        return table;
+    }()};
+
+    static constexpr std::array<bool, Intel8080::instructionCount_> sideEffects_ {[] {
+        std::array<bool, Intel8080::instructionCount_> table {};
+        for (const std::string_view mnemonic : {"MOV M, r", "MVI M, data", "STA addr", "SHLD addr", "STAX rp", "INR M",
+                                                "DCR M", "CALL addr", "C cond addr", "RST n", "PUSH rp", "PUSH PSW",
+                                                "XTHL", "IN port", "OUT port"})
+            table[Intel8080::index_(mnemonic)] = true;
+        return table;
+    }()};
+
+    void decode_(Block& block, std::uint16_t pc)
+    {
+        block.pc = pc;
+        block.size = 0;
+        block.page[0] = pc >> 8U;
+        block.generation[0] = generation_[block.page[0]];
+
+        int instruction {0};
+        do {
+            Instruction& next {block.code[block.size++]};
+            next.opcode = policy.read(pc);
+            const Intel8080::Decoded decoded {Intel8080::decoded_[next.opcode]};
+            next.instruction = instruction = decoded.instruction;
+            next.length = decoded.length;
+            next.sideEffects = sideEffects_[instruction];
+            next.data = 0;
+            if (next.length > 1)
+                next.data = policy.read(pc + 1);
+            if (next.length > 2)
+                next.data |= policy.read(pc + 2) << 8U;
+            for (int i {0}; i < next.length; ++i)
+                code_[std::uint16_t(pc + i)] = 1;
+            pc += next.length;
+        } while (block.size < maxInstructions and !ends_[instruction]);
+
+        // the last byte of the block, which can be on the next page
+        block.page[1] = (pc - 1) >> 8U;
+        block.generation[1] = generation_[block.page[1]];
+    }
+
+    std::vector<Block> blocks_ = std::vector<Block>(maxBlocks);
+};
+
+#endif //INTEL8080_INTEL8080BLOCKCACHE_H
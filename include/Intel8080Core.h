@@ -0,0 +1,545 @@
+#ifndef INTEL8080_INTEL8080CORE_H
+#define INTEL8080_INTEL8080CORE_H
+
+#include "Intel8080.h"
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+/*
+ * Intel 8080 with its memory and I/O chosen at compile time. Policy has to supply these members, either static or not:
+ *      std::uint8_t read(std::uint16_t addr);
+ *      void write(std::uint16_t addr, std::uint8_t val);
+ *      std::uint8_t in(std::uint8_t port);
+ *      void out(std::uint8_t port, std::uint8_t val);
+ * and optionally,
+ *      std::uint8_t acknowledge();
+ * which returns the instruction to execute on an interrupt (RST 7 if it's missing). These do the same job as the
+ * functions of Intel8080::Bus, but because the compiler knows exactly which ones get called it can inline them right
+ * into each instruction instead of going through a virtual call. Every opcode is a handler of its own, instantiated with
+ * its register, pair and condition fields, so MOV B, C comes down to a byte move.
+ *
+ * It's still an Intel8080, so tick() and the pins keep working exactly like they do on the base class. Intel8080::step()
+ * is the same engine with Intel8080::Bus as its policy. run() also makes use of policies that cache decoded blocks
+ * (Intel8080BlockCache.h) or translate them (Intel8080Jit.h).
+ */
+template<class Policy>
+class Intel8080Core : public Intel8080 {
+public:
+    Intel8080Core() = default;
+    explicit Intel8080Core(Policy policy) : bus {policy} {}
+
+    using Intel8080::step;
+    using Intel8080::run;
+
+    /**
+     * Same as Intel8080::step() but against this processor's bus.
+     * @return the number of states the instruction took, or 1 if the processor is halted
+     */
+    unsigned step()
+    {
+        const unsigned states {execute_(bus)};
+        clock_ += states;
+        return states;
+    }
+
+    /**
+     * Same as Intel8080::run() but against this processor's bus.
+     * @param cycleBudget the number of states to run for
+     * @return the number of states that actually elapsed (can overshoot the budget by the last instruction)
+     */
+    std::uint64_t run(const std::uint64_t cycleBudget)
+    {
+        const std::uint64_t elapsed {run_(bus, cycleBudget)};
+        clock_ += elapsed;
+        return elapsed;
+    }
+
+    // the memory and I/O this processor is wired to
+    [[no_unique_address]] Policy bus {};
+};
+
+template<class Policy>
+unsigned Intel8080::execute_(Policy& bus)
+{
+    // same interrupt handling as the start of tick(), but every call begins a new instruction
+    if (pins & INT and pins & INTE) {
+        intreq_ = true;
+    }
+    if (intreq_) {
+        intff_ = true;
+        intreq_ = false;
+        stopped_ = false;
+    }
+    if (stopped_) {
+#ifdef INTEL8080_COUNTERS
+        ++counters_.states[ir_];
+#endif
+        return 1;
+    }
+
+    if (intff_) {
+        intff_ = false;
+        pins &= ~INTE;
+#ifdef INTEL8080_COUNTERS
+        ++counters_.interrupts;
+#endif
+        if constexpr (requires { bus.acknowledge(); })
+            ir_ = bus.acknowledge();
+        else
+            ir_ = 0xFFU; // RST 7
+    } else {
+        ir_ = bus.read(pc++);
+    }
+
+    // the data bytes are always the first thing an instruction reads, so fetching them here changes nothing
+    const std::uint8_t length {decoded_[ir_].length};
+    std::uint16_t data {0};
+    if (length > 1)
+        data = bus.read(pc++);
+    if (length > 2)
+        data |= bus.read(pc++) << 8U;
+    return execute_(bus, data);
+}
+
+template<class Policy>
+unsigned Intel8080::execute_(Policy& bus, const std::uint16_t data)
+{
+    // every opcode has a handler of its own, so none of them have to decode their operand fields at run time
+    static constexpr auto handlers {[]<std::size_t... opcode>(std::index_sequence<opcode...>) {
+        return std::array<unsigned (*)(Intel8080&, Policy&, std::uint16_t), 256> {
+                [](Intel8080& cpu, Policy& policy, const std::uint16_t operand) {
+                    return cpu.instruction_<opcode>(policy, operand);
+                }...
+        };
+    }(std::make_index_sequence<256> {})};
+
+    const unsigned states {handlers[ir_](*this, bus, data)};
+#ifdef INTEL8080_COUNTERS
+    ++counters_.executed[ir_];
+    counters_.states[ir_] += states;
+#endif
+    return states;
+}
+
+template<std::uint8_t opcode, class Policy>
+unsigned Intel8080::instruction_(Policy& bus, const std::uint16_t data)
+{
+    constexpr int instruction {opcode_[opcode]};
+    // the symbols of the opcode, the same as dst_(), src_(), rp_(), ccc_() and nnn_() but known at compile time
+    constexpr std::uint8_t dst {opcode >> 3U & 7U}, src {opcode & 7U}, rp {opcode >> 4U & 3U};
+    constexpr std::uint8_t ccc {dst}, nnn {opcode & 0b111000U};
+    unsigned states {cycles_[instruction]};
+
+    if constexpr (instruction == index_("MOV r1, r2")) {
+        setReg_<dst>(reg_<src>());
+    } else if constexpr (instruction == index_("MOV r, M")) {
+        setReg_<dst>(bus.read(pair_[HL]));
+    } else if constexpr (instruction == index_("MOV M, r")) {
+        bus.write(pair_[HL], reg_<src>());
+    } else if constexpr (instruction == index_("SPHL")) {
+        pair_[SP] = pair_[HL];
+    } else if constexpr (instruction == index_("MVI r, data")) {
+        setReg_<dst>(data);
+    } else if constexpr (instruction == index_("MVI M, data")) {
+        tmp_ = data;
+        bus.write(pair_[HL], tmp_);
+    } else if constexpr (instruction == index_("LXI rp, data")) {
+        pair_[rp] = data;
+    } else if constexpr (instruction == index_("LDA addr")) {
+        pair_[WZ] = data;
+        a_() = bus.read(pair_[WZ]);
+    } else if constexpr (instruction == index_("STA addr")) {
+        pair_[WZ] = data;
+        bus.write(pair_[WZ], a_());
+    } else if constexpr (instruction == index_("LHLD addr")) {
+        pair_[WZ] = data;
+        setLo_(HL, bus.read(pair_[WZ]++));
+        setHi_(HL, bus.read(pair_[WZ]));
+    } else if constexpr (instruction == index_("SHLD addr")) {
+        pair_[WZ] = data;
+        bus.write(pair_[WZ]++, lo_(pair_[HL]));
+        bus.write(pair_[WZ], hi_(pair_[HL]));
+    } else if constexpr (instruction == index_("LDAX rp")) {
+        a_() = bus.read(pair_[rp]);
+    } else if constexpr (instruction == index_("STAX rp")) {
+        bus.write(pair_[rp], a_());
+    } else if constexpr (instruction == index_("XCHG")) {
+        std::swap(pair_[HL], pair_[DE]);
+    } else if constexpr (instruction == index_("ADD r")) {
+        add_(reg_<src>());
+    } else if constexpr (instruction == index_("ADD M")) {
+        add_(tmp_ = bus.read(pair_[HL]));
+    } else if constexpr (instruction == index_("ADI data")) {
+        add_(tmp_ = data);
+    } else if constexpr (instruction == index_("ADC r")) {
+        adc_(reg_<src>());
+    } else if constexpr (instruction == index_("ADC M")) {
+        adc_(tmp_ = bus.read(pair_[HL]));
+    } else if constexpr (instruction == index_("ACI data")) {
+        adc_(tmp_ = data);
+    } else if constexpr (instruction == index_("SUB r")) {
+        sub_(reg_<src>());
+    } else if constexpr (instruction == index_("SUB M")) {
+        sub_(tmp_ = bus.read(pair_[HL]));
+    } else if constexpr (instruction == index_("SUI data")) {
+        sub_(tmp_ = data);
+    } else if constexpr (instruction == index_("SBB r")) {
+        sbb_(reg_<src>());
+    } else if constexpr (instruction == index_("SBB M")) {
+        sbb_(tmp_ = bus.read(pair_[HL]));
+    } else if constexpr (instruction == index_("SBI data")) {
+        sbb_(tmp_ = data);
+    } else if constexpr (instruction == index_("INR r")) {
+        setReg_<dst>(inr_(reg_<dst>()));
+    } else if constexpr (instruction == index_("INR M")) {
+        tmp_ = bus.read(pair_[HL]);
+        bus.write(pair_[HL], inr_(tmp_));
+    } else if constexpr (instruction == index_("DCR r")) {
+        setReg_<dst>(dcr_(reg_<dst>()));
+    } else if constexpr (instruction == index_("DCR M")) {
+        tmp_ = bus.read(pair_[HL]);
+        bus.write(pair_[HL], dcr_(tmp_));
+    } else if constexpr (instruction == index_("INX rp")) {
+        ++pair_[rp];
+    } else if constexpr (instruction == index_("DCX rp")) {
+        --pair_[rp];
+    } else if constexpr (instruction == index_("DAD rp")) {
+        dad_(pair_[rp]);
+    } else if constexpr (instruction == index_("DAA")) {
+        daa_();
+    } else if constexpr (instruction == index_("ANA r")) {
+        ana_(reg_<src>());
+    } else if constexpr (instruction == index_("ANA M")) {
+        ana_(tmp_ = bus.read(pair_[HL]));
+    } else if constexpr (instruction == index_("ANI data")) {
+        ani_(tmp_ = data);
+    } else if constexpr (instruction == index_("XRA r")) {
+        xra_(reg_<src>());
+    } else if constexpr (instruction == index_("XRA M")) {
+        xra_(tmp_ = bus.read(pair_[HL]));
+    } else if constexpr (instruction == index_("XRI data")) {
+        xra_(tmp_ = data);
+    } else if constexpr (instruction == index_("ORA r")) {
+        ora_(reg_<src>());
+    } else if constexpr (instruction == index_("ORA M")) {
+        ora_(tmp_ = bus.read(pair_[HL]));
+    } else if constexpr (instruction == index_("ORI data")) {
+        ora_(tmp_ = data);
+    } else if constexpr (instruction == index_("CMP r")) {
+        cmp_(reg_<src>());
+    } else if constexpr (instruction == index_("CMP M")) {
+        cmp_(tmp_ = bus.read(pair_[HL]));
+    } else if constexpr (instruction == index_("CPI data")) {
+        cmp_(tmp_ = data);
+    } else if constexpr (instruction == index_("RLC")) {
+        rlc_();
+    } else if constexpr (instruction == index_("RRC")) {
+        rrc_();
+    } else if constexpr (instruction == index_("RAL")) {
+        ral_();
+    } else if constexpr (instruction == index_("RAR")) {
+        rar_();
+    } else if constexpr (instruction == index_("CMA")) {
+        a_() = ~a_();
+    } else if constexpr (instruction == index_("CMC")) {
+        f_() ^= carryBit;
+    } else if constexpr (instruction == index_("STC")) {
+        f_() |= carryBit;
+    } else if constexpr (instruction == index_("JMP addr")) {
+        pair_[WZ] = data;
+        pc = pair_[WZ];
+    } else if constexpr (instruction == index_("J cond addr")) {
+        pair_[WZ] = data;
+        if (branch_(condition_<ccc>()))
+            pc = pair_[WZ];
+    } else if constexpr (instruction == index_("CALL addr")) {
+        pair_[WZ] = data;
+        bus.write(--pair_[SP], hi_(pc));
+        bus.write(--pair_[SP], lo_(pc));
+        pc = pair_[WZ];
+    } else if constexpr (instruction == index_("C cond addr")) {
+        pair_[WZ] = data;
+        if (branch_(condition_<ccc>())) {
+            bus.write(--pair_[SP], hi_(pc));
+            bus.write(--pair_[SP], lo_(pc));
+            pc = pair_[WZ];
+        } else {
+            states -= notTaken_;
+        }
+    } else if constexpr (instruction == index_("RET")) {
+        setLo_(WZ, bus.read(pair_[SP]++));
+        setHi_(WZ, bus.read(pair_[SP]++));
+        pc = pair_[WZ];
+    } else if constexpr (instruction == index_("R cond addr")) {
+        if (branch_(condition_<ccc>())) {
+            setLo_(WZ, bus.read(pair_[SP]++));
+            setHi_(WZ, bus.read(pair_[SP]++));
+            pc = pair_[WZ];
+        } else {
+            states -= notTaken_;
+        }
+    } else if constexpr (instruction == index_("RST n")) {
+        bus.write(--pair_[SP], hi_(pc));
+        bus.write(--pair_[SP], lo_(pc));
+        pair_[WZ] = nnn;
+        pc = pair_[WZ];
+    } else if constexpr (instruction == index_("PCHL")) {
+        pc = pair_[HL];
+    } else if constexpr (instruction == index_("PUSH rp")) {
+        bus.write(--pair_[SP], hi_(pair_[rp]));
+        bus.write(--pair_[SP], lo_(pair_[rp]));
+    } else if constexpr (instruction == index_("PUSH PSW")) {
+        bus.write(--pair_[SP], a_());
+        bus.write(--pair_[SP], psw_());
+    } else if constexpr (instruction == index_("POP rp")) {
+        setLo_(rp, bus.read(pair_[SP]++));
+        setHi_(rp, bus.read(pair_[SP]++));
+    } else if constexpr (instruction == index_("POP PSW")) {
+        f_() = (bus.read(pair_[SP]++) & 0b11010111U) | 0b10U; // bits 3 and 5 are always zero, bit 1 is always one
+        result_ = settled_;
+        a_() = bus.read(pair_[SP]++);
+    } else if constexpr (instruction == index_("XTHL")) {
+        setLo_(WZ, bus.read(pair_[SP]));
+        setHi_(WZ, bus.read(pair_[SP] + 1));
+        bus.write(pair_[SP] + 1, hi_(pair_[HL]));
+        bus.write(pair_[SP], lo_(pair_[HL]));
+        pair_[HL] = pair_[WZ];
+    } else if constexpr (instruction == index_("IN port")) {
+        pair_[WZ] = data;
+        a_() = bus.in(lo_(pair_[WZ]));
+    } else if constexpr (instruction == index_("OUT port")) {
+        pair_[WZ] = data;
+        bus.out(lo_(pair_[WZ]), a_());
+    } else if constexpr (instruction == index_("EI")) {
+        pins |= INTE;
+    } else if constexpr (instruction == index_("DI")) {
+        pins &= ~INTE;
+    } else if constexpr (instruction == index_("HLT")) {
+        stopped_ = true;
+    } // and NOP does nothing
+    return states;
+}
+
+template<class Policy>
+std::uint64_t Intel8080::run_(Policy& bus, const std::uint64_t cycleBudget)
+{
+    if constexpr (requires { bus.block(pc); })
+        return runBlocks_(bus, cycleBudget);
+
+    std::uint64_t elapsed {0};
+    while (elapsed < cycleBudget) {
+        if (stopped_ and !interruptPending_()) {
+#ifdef INTEL8080_COUNTERS
+            counters_.states[ir_] += cycleBudget - elapsed;
+#endif
+            return cycleBudget; // nothing left to wake the processor up
+        }
+        elapsed += execute_(bus);
+    }
+    return elapsed;
+}
+
+template<class Policy>
+std::uint64_t Intel8080::runBlocks_(Policy& bus, const std::uint64_t cycleBudget)
+{
+    std::uint64_t elapsed {0};
+    while (elapsed < cycleBudget) {
+        // interrupts (and the halts they end) go through execute_(), exactly like run_()
+        if (stopped_ or interruptPending_()) {
+            if (stopped_ and !interruptPending_()) {
+#ifdef INTEL8080_COUNTERS
+                counters_.states[ir_] += cycleBudget - elapsed;
+#endif
+                return cycleBudget;
+            }
+            elapsed += execute_(bus);
+            continue;
+        }
+
+#ifndef INTEL8080_COUNTERS // translated code would go uncounted
+        if constexpr (requires { bus.native(*this, cycleBudget); }) {
+            if (const unsigned states {bus.native(*this, cycleBudget - elapsed)}) {
+                elapsed += states;
+                continue;
+            }
+        }
+#endif
+
+        const auto& block {bus.block(pc)};
+        for (int i {0}; i < block.size and elapsed < cycleBudget; ++i) {
+            const auto& next {block.code[i]};
+            const std::uint16_t fallThrough {static_cast<std::uint16_t>(pc + next.length)};
+            ir_ = next.opcode;
+            pc = fallThrough;
+            elapsed += execute_(bus, next.data);
+            // leave the block where the code stops being straight-line (a conditional jump, call or return was taken),
+            // where execute_() would notice an interrupt, or once an instruction could have changed the code the rest
+            // of the block was decoded from
+            if (pc != fallThrough or interruptPending_() or (next.sideEffects and !bus.valid(block)))
+                break;
+        }
+    }
+    return elapsed;
+}
+
+inline bool Intel8080::ccc_() const {
+    switch (ir_ >> 3U & 7U) {
+        // NZ - not zero (Z = 0)
+        case 0b000: return (z()) == 0;
+        // Z - zero (Z = 1)
+        case 0b001: return (z()) != 0;
+        // NC - no carry (CY = 0)
+        case 0b010: return (cy()) == 0;
+        // C - carry (CY = 1)
+        case 0b011: return (cy()) != 0;
+        // PO - parity odd (P = 0)
+        case 0b100: return (p()) == 0;
+        // PE - parity even (P = 1)
+        case 0b101: return (p()) != 0;
+        // P - plus (S = 0)
+        case 0b110: return (s()) == 0;
+        // M - minus (S = 1)
+        case 0b111: return (s()) != 0;
+        default: return false;
+    }
+}
+
+template<std::uint8_t ccc>
+bool Intel8080::condition_() const
+{
+    if constexpr (ccc >> 1U == 0b00U) // NZ, Z
+        return (z() != 0) == (ccc & 1U);
+    else if constexpr (ccc >> 1U == 0b01U) // NC, C
+        return (cy() != 0) == (ccc & 1U);
+    else if constexpr (ccc >> 1U == 0b10U) // PO, PE
+        return (p() != 0) == (ccc & 1U);
+    else // P, M
+        return (s() != 0) == (ccc & 1U);
+}
+
+inline void Intel8080::setReg_(const std::uint8_t r, const std::uint8_t val) {
+    if (r == F)
+        result_ = settled_;
+    if (r <= F and offset_[r] != 0xFFU)
+        bytes_()[offset_[r]] = val;
+}
+
+// every arithmetic and logical instruction writes all five flags at once, CY and AC to F and S, Z and P as the result
+// they're of (see flags_()). bits 3 and 5 of the flags are always zero and bit 1 is always one (see POP PSW)
+inline void Intel8080::add_(const std::uint8_t addend)
+{
+    const unsigned res {unsigned(a_()) + addend};
+    f_() = ((a_() ^ addend ^ res) & auxiliaryBit) | (res >> 8U) | 0b10U;
+    a_() = result_ = res;
+}
+
+inline void Intel8080::adc_(const std::uint8_t addend)
+{
+    const unsigned res {unsigned(a_()) + addend + cy()};
+    f_() = ((a_() ^ addend ^ res) & auxiliaryBit) | (res >> 8U) | 0b10U;
+    a_() = result_ = res;
+}
+
+inline void Intel8080::sub_(const std::uint8_t subtrahend)
+{
+    cmp_(subtrahend);
+    a_() -= subtrahend;
+}
+
+inline void Intel8080::sbb_(const std::uint8_t subtrahend)
+{
+    const unsigned res {unsigned(a_()) - subtrahend - cy()}; // borrow wraps into bit 8
+    f_() = (~(a_() ^ subtrahend ^ res) & auxiliaryBit) | ((res >> 8U) & carryBit) | 0b10U;
+    a_() = result_ = res;
+}
+
+inline std::uint8_t Intel8080::inr_(std::uint8_t operand)
+{
+    ++operand;
+    f_() = (f_() & carryBit) | ((operand & 0xFU) == 0 ? auxiliaryBit : 0U) | 0b10U; // see inrTable_
+    result_ = operand;
+    return operand;
+}
+
+inline std::uint8_t Intel8080::dcr_(std::uint8_t operand)
+{
+    --operand;
+    f_() = (f_() & carryBit) | ((operand & 0xFU) != 0xFU ? auxiliaryBit : 0U) | 0b10U; // see dcrTable_
+    result_ = operand;
+    return operand;
+}
+
+inline void Intel8080::ana_(const std::uint8_t operand)
+{
+    f_() = (((a_() | operand) & 0b1000U) << 1U) | 0b10U;
+    a_() = result_ = a_() & operand;
+}
+
+inline void Intel8080::ani_(const std::uint8_t operand)
+{
+    ana_(operand);
+}
+
+inline void Intel8080::xra_(const std::uint8_t operand)
+{
+    a_() = result_ = a_() ^ operand;
+    f_() = 0b10U;
+}
+
+inline void Intel8080::ora_(const std::uint8_t operand)
+{
+    a_() = result_ = a_() | operand;
+    f_() = 0b10U;
+}
+
+inline void Intel8080::cmp_(const std::uint8_t operand)
+{
+    const unsigned res {unsigned(a_()) - operand}; // borrow wraps into bit 8
+    f_() = (~(a_() ^ operand ^ res) & auxiliaryBit) | ((res >> 8U) & carryBit) | 0b10U;
+    result_ = res;
+}
+
+inline void Intel8080::dad_(const std::uint16_t addend)
+{
+    const unsigned res {unsigned(pair_[HL]) + addend};
+    f_() = (f_() & ~carryBit) | (res >> 16U);
+    pair_[HL] = res;
+}
+
+inline void Intel8080::daa_()
+{
+    const std::uint16_t entry {daaTable_[(f_() & carryBit) << 9U | (f_() & auxiliaryBit) << 4U | a_()]};
+    a_() = entry >> 8U;
+    f_() = entry;
+    result_ = settled_;
+}
+
+inline void Intel8080::rlc_()
+{
+    f_() = (f_() & ~carryBit) | (a_() >> 7U);
+    a_() = (a_() << 1U) | (a_() >> 7U);
+}
+
+inline void Intel8080::rrc_()
+{
+    f_() = (f_() & ~carryBit) | (a_() & 0x01U);
+    a_() = (a_() >> 1U) | (a_() << 7U);
+}
+
+inline void Intel8080::ral_()
+{
+    const std::uint8_t carry {cy()};
+    f_() = (f_() & ~carryBit) | (a_() >> 7U);
+    a_() = (a_() << 1U) | carry;
+}
+
+inline void Intel8080::rar_()
+{
+    const std::uint8_t carry {cy()};
+    f_() = (f_() & ~carryBit) | (a_() & 0x01U);
+    a_() = (a_() >> 1U) | (carry << 7U);
+}
+
+#endif //INTEL8080_INTEL8080CORE_H
@@ -0,0 +1,47 @@
+#ifndef INTEL8080_INTEL8080COUNTERS_H
+#define INTEL8080_INTEL8080COUNTERS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * What a processor has spent its time on, per opcode. Only kept when the library and everything using it are built with
+ * INTEL8080_COUNTERS defined (the CMake option of the same name), otherwise none of the counting is compiled in at all.
+ * For example,
+ *      Intel8080Core<Machine> intel8080 {};
+ *      ... run the ROM ...
+ *      std::cout << intel8080.counters().report(20); // the 20 opcodes that took the most states
+ *      intel8080.resetCounters();
+ *
+ * tick(), runUntil(), step() and run() all count, including run() with Intel8080BlockCache. Intel8080Jit doesn't run
+ * its translations while counting, since translated code never goes through the counters.
+ */
+struct Intel8080Counters {
+    // times each opcode was executed, including the ones supplied by an interrupt acknowledge
+    std::array<std::uint64_t, 256> executed {};
+
+    // states spent on each opcode from its fetch to its last state, including wait states. HLT also gets the states the
+    // processor spends halted
+    std::array<std::uint64_t, 256> states {};
+
+    // states tick() and runUntil() spent waiting for READY (step() and run() never wait)
+    std::uint64_t waitStates {0};
+
+    // conditional jumps, calls and returns whose condition was met and wasn't
+    std::uint64_t taken {0};
+    std::uint64_t notTaken {0};
+
+    // interrupts acknowledged
+    std::uint64_t interrupts {0};
+
+    /**
+     * @param top how many opcodes to list, busiest first
+     * @return a table of the opcodes that took the most states, with their executions, states and share of the total,
+     * followed by the wait states, branches and interrupts
+     */
+    [[nodiscard]] std::string report(std::size_t top = 256) const;
+};
+
+#endif //INTEL8080_INTEL8080COUNTERS_H
@@ -0,0 +1,194 @@
+#ifndef INTEL8080_INTEL8080INTERRUPTCONTROLLER_H
+#define INTEL8080_INTEL8080INTERRUPTCONTROLLER_H
+
+#include "Intel8080.h"
+
+#include <bit>
+#include <cstdint>
+#include <optional>
+
+/*
+ * An 8259-style priority interrupt controller, which owns the processor's INT pin so devices only have to call
+ * requestInterrupt() with their level. Of the 8 levels, 0 has the highest priority. A request stays pending until it's
+ * acknowledged, and INT is high exactly while an unmasked request is pending with a higher priority than any level in
+ * service (fully nested mode, so a handler can only be interrupted by a more important device). The acknowledge puts
+ * RST n on the data bus for level n, so its handler is at address 8n, and marks the level in service until an
+ * end-of-interrupt. For example,
+ *      struct Machine {
+ *          ...
+ *          std::uint8_t in(std::uint8_t port) { return pic->in(port).value_or(0xFF); }
+ *          void out(std::uint8_t port, std::uint8_t val) { pic->out(port, val); }
+ *          std::uint8_t acknowledge() { return pic->acknowledge(); }
+ *          Intel8080InterruptController* pic;
+ *      };
+ *      Intel8080Core<Machine> intel8080 {};
+ *      Intel8080InterruptController pic {intel8080};
+ *      intel8080.bus.pic = &pic;
+ *      scheduler.every(33333, 33333, [&pic](std::uint64_t) { pic.requestInterrupt(2); });
+ * or with tick() and runUntil(), call access() at every read.
+ *
+ * The emulated program sees the two ports of an 8259 (0x20 and 0x21 by default): ICW1-ICW4 to initialize it, of which
+ * only the auto-EOI bit of ICW4 matters, OCW1 to read and write the mask, OCW2 for non-specific and specific EOI, and
+ * OCW3 to choose between reading the requests and the levels in service. The 8080 mode's CALL to the address in ICW2 is
+ * replaced by RST, and the rotating priority and special mask modes aren't there.
+ *
+ * Nothing runs per state, the controller only does something when a request comes in, on the acknowledge and on
+ * mask and EOI changes. Requests are plain function calls on the emulation's thread, e.g. from a device's callback in
+ * Intel8080Scheduler or from in() and out(), which all run between states.
+ */
+class Intel8080InterruptController {
+public:
+    static constexpr int levels {8};
+
+    /**
+     * @param cpu the processor whose INT pin it drives, which has to outlive it
+     * @param port the first of its two I/O ports
+     */
+    explicit Intel8080InterruptController(Intel8080& cpu, const std::uint8_t port = 0x20) : cpu_ {cpu}, port_ {port} {}
+
+    // raises a request on a level 0-7, which is served once it's the most important one that's unmasked
+    void requestInterrupt(const int level)
+    {
+        requests_ |= 1U << (level & 7);
+        update_();
+    }
+
+    /**
+     * Answers the processor's interrupt acknowledge: the most important request goes in service and is no longer
+     * pending.
+     * @return the RST for its level, or RST 7 if the request went away (a spurious interrupt, with nothing in service)
+     */
+    std::uint8_t acknowledge()
+    {
+        const std::uint8_t ready {ready_()};
+        if (!ready)
+            return rst(7);
+        const int level {std::countr_zero(ready)};
+        requests_ &= ~(1U << level);
+        if (!autoEoi_)
+            inService_ |= 1U << level;
+        update_();
+        return rst(level);
+    }
+
+    /**
+     * Puts the RST on the data bus if the processor's pins are reading an interrupt acknowledge.
+     * @return whether they were, instead of anything else the host has to see to
+     */
+    bool access(Intel8080& cpu)
+    {
+        if (cpu.pins & Intel8080::DBIN and (cpu.status == Intel8080::interruptAck
+                                            or cpu.status == Intel8080::interruptAckWhileHalt)) {
+            cpu.setDBus(std::uint_fast8_t {acknowledge()});
+            return true;
+        }
+        return false;
+    }
+
+    // ends the most important level in service, what a handler does before it returns
+    void endOfInterrupt()
+    {
+        inService_ &= inService_ - 1U;
+        update_();
+    }
+
+    void endOfInterrupt(const int level)
+    {
+        inService_ &= ~(1U << (level & 7));
+        update_();
+    }
+
+    // a set bit masks its level, whose requests stay pending without raising INT
+    void setMask(const std::uint8_t mask)
+    {
+        mask_ = mask;
+        update_();
+    }
+
+    // with it, levels are never in service and don't need an end-of-interrupt
+    void setAutoEoi(const bool autoEoi) { autoEoi_ = autoEoi; }
+
+    [[nodiscard]] std::uint8_t mask() const { return mask_; }
+    [[nodiscard]] std::uint8_t requests() const { return requests_; }
+    [[nodiscard]] std::uint8_t inService() const { return inService_; }
+
+    [[nodiscard]] static constexpr std::uint8_t rst(const int level) { return 0xC7U | (level & 7) << 3U; }
+
+    /**
+     * What the emulated program writes to the controller's ports.
+     * @return whether the port is one of its two, otherwise it's for something else
+     */
+    bool out(const std::uint8_t port, const std::uint8_t val)
+    {
+        if (port == port_) {
+            if (val & 0x10U) {
+                // ICW1 starts over: nothing masked or in service, and ICW2 next, then ICW3 unless it's the only one,
+                // then ICW4 if asked for
+                icw1_ = val;
+                icw_ = 2;
+                mask_ = inService_ = 0U;
+                autoEoi_ = readInService_ = false;
+            } else if (val & 0x08U) {
+                if (val & 0x02U) // OCW3 with read register set
+                    readInService_ = val & 0x01U;
+            } else if (val >> 5U == 0b001U) { // OCW2, non-specific EOI
+                endOfInterrupt();
+            } else if (val >> 5U == 0b011U) { // OCW2, specific EOI
+                endOfInterrupt(val & 7);
+            }
+            update_();
+            return true;
+        }
+
+        if (port == static_cast<std::uint8_t>(port_ + 1U)) {
+            if (icw_ == 4) {
+                autoEoi_ = val & 0x02U;
+                icw_ = 0;
+            } else if (icw_ != 0) {
+                icw_ = icw_ == 2 and !(icw1_ & 0x02U) ? 3 : icw1_ & 0x01U ? 4 : 0;
+            } else {
+                setMask(val); // OCW1
+            }
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * What the emulated program reads from the controller's ports.
+     * @return the requests or levels in service (as chosen by OCW3) or the mask, or nothing if the port isn't its own
+     */
+    [[nodiscard]] std::optional<std::uint8_t> in(const std::uint8_t port) const
+    {
+        if (port == port_)
+            return readInService_ ? inService_ : requests_;
+        if (port == static_cast<std::uint8_t>(port_ + 1U))
+            return mask_;
+        return std::nullopt;
+    }
+private:
+    // the unmasked requests more important than everything in service
+    [[nodiscard]] std::uint8_t ready_() const
+    {
+        const std::uint8_t above {static_cast<std::uint8_t>(inService_ ? (inService_ & -inService_) - 1U : 0xFFU)};
+        return requests_ & ~mask_ & above;
+    }
+
+    void update_()
+    {
+        if (ready_())
+            cpu_.pins |= Intel8080::INT;
+        else
+            cpu_.pins &= ~Intel8080::INT;
+    }
+
+    Intel8080& cpu_;
+    std::uint8_t port_;
+    std::uint8_t requests_ {0}, inService_ {0}, mask_ {0};
+    bool autoEoi_ {false};
+    bool readInService_ {false};
+    std::uint8_t icw1_ {0};
+    int icw_ {0}; // the initialization word expected on the second port next, or 0 outside of initialization
+};
+
+#endif //INTEL8080_INTEL8080INTERRUPTCONTROLLER_H
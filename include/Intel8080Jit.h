@@ -0,0 +1,208 @@
+#ifndef INTEL8080_INTEL8080JIT_H
+#define INTEL8080_INTEL8080JIT_H
+
+#include "Intel8080BlockCache.h"
+#include "Intel8080Core.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Turns a run of decoded 8080 instructions into x86-64 machine code. This is the part of Intel8080Jit (see below) that
+ * doesn't depend on the bus policy.
+ *
+ * The translated code keeps the 8080 registers in a State and reads and writes memory directly. It stops in front of
+ * every instruction it can't do on its own (IN, OUT, EI, DI and HLT), so the interpreter can execute those.
+ */
+class Intel8080Translator {
+public:
+    // everything translated code gets to touch
+    struct State {
+        std::uint16_t pair[5];           // BC, DE, HL, SP and WZ, laid out little-endian so C, B, E, D, L, H are bytes 0-5
+        std::uint8_t a, f;
+        std::uint16_t pc;
+        std::uint8_t ir;
+        bool interpret;                  // set if the next instruction has to go through the interpreter (MMIO)
+        std::uint8_t* memory;            // the 64K of RAM
+        const std::uint8_t* code;        // non-zero for every byte that has been decoded
+        std::uint64_t* generation;       // generation of each page, bumped when code is written
+        const std::uint8_t* mmio;        // non-zero for every page that has to go through the bus
+    };
+
+    struct Instruction {
+        std::uint16_t pc;
+        std::uint8_t opcode;
+        std::uint16_t data;
+    };
+
+    // runs a translated block, returns the number of states it took
+    using Code = unsigned (*)(State*);
+
+    Intel8080Translator() = default;
+    ~Intel8080Translator();
+
+    // translated code can't be shared, so a copy starts out empty
+    Intel8080Translator(const Intel8080Translator&) : Intel8080Translator() {}
+    Intel8080Translator& operator=(const Intel8080Translator&);
+
+    /**
+     * @return true if this build and platform can run translated code
+     */
+    [[nodiscard]] static bool available();
+
+    /**
+     * Translates instructions until the end of the run or the first one that has to be interpreted.
+     * @param code the instructions, one after another in memory
+     * @param size the number of instructions
+     * @param mmio whether some pages are memory mapped I/O, in which case every access gets checked against them
+     * @param budget set to the states elapsed before the last instruction the code can execute. Only run the code if
+     *               more states than that are left in the budget, otherwise it can overshoot by more than run() would
+     * @return the code, or nullptr if the first instruction can't be translated or there is no executable memory
+     */
+    Code translate(const Instruction* code, int size, bool mmio, unsigned& budget);
+
+    /**
+     * Throws away all translated code.
+     */
+    void clear();
+
+    /**
+     * @return a number that changes every time clear() throws away translated code
+     */
+    [[nodiscard]] std::uint64_t epoch() const { return epoch_; }
+private:
+    static constexpr std::size_t capacity_ {1U << 22U};
+
+    std::uint8_t* buffer_ {nullptr};
+    std::size_t used_ {0};
+    std::uint64_t epoch_ {1};
+};
+
+/*
+ * Block cache (see Intel8080BlockCache.h) that also translates blocks that run often into x86-64 machine code, which
+ * Intel8080Core::run() then calls instead of interpreting them. For example,
+ *      Intel8080Core<Intel8080Jit<Memory>> intel8080 {};
+ *
+ * On top of what Intel8080BlockCache needs, Policy has to supply
+ *      std::uint8_t* memory();
+ * which returns the 64K of RAM behind its read() and write(), since translated code accesses it directly. Pages that
+ * aren't plain RAM have to be marked with mmio(), then any instruction that touches them is interpreted instead.
+ *
+ * A translated block only runs when the rest of the budget covers it, and there is nothing in it that can raise an
+ * interrupt, so states, registers and memory come out exactly the same as with the interpreter. Set enabled to false to
+ * go back to the block cache alone, which is also what happens when available() is false.
+ */
+template<class Policy>
+class Intel8080Jit : public Intel8080BlockCache<Policy> {
+public:
+    using Cache = Intel8080BlockCache<Policy>;
+
+    // number of times a block has to be run before it gets translated
+    static constexpr int hot {16};
+
+    Intel8080Jit() = default;
+    explicit Intel8080Jit(Policy policy) : Cache {policy} {}
+
+    /**
+     * @return true if this build and platform can run translated code
+     */
+    [[nodiscard]] static bool available() { return Intel8080Translator::available(); }
+
+    /**
+     * Marks a page as memory mapped I/O (or as plain RAM again), so every access to it goes through read() and write().
+     * @param page the high byte of the addresses
+     * @param enabled true for I/O, false for RAM
+     */
+    void mmio(const std::uint8_t page, const bool enabled = true)
+    {
+        mmio_[page] = enabled;
+        mmioPages_ = 0;
+        for (const std::uint8_t io : mmio_)
+            mmioPages_ += io;
+        translator_.clear();
+    }
+
+    /**
+     * Runs the translated code for the block at the processor's pc, translating it if it's hot enough. Called by
+     * Intel8080Core::run().
+     * @param cpu the processor
+     * @param cycleBudget the states left to run for
+     * @return the number of states that elapsed, or 0 if the block has to be interpreted
+     */
+    unsigned native(Intel8080& cpu, const std::uint64_t cycleBudget)
+    {
+        if (!enabled)
+            return 0;
+
+        // a cached translation skips block(), so remaps have to be looked for here too
+        this->remapped_();
+        Translation& translation {translations_[cpu.pc % Cache::maxBlocks]};
+        if (translation.pc != cpu.pc or translation.epoch != translator_.epoch() or !valid_(translation)) {
+            const auto& block {this->block(cpu.pc)};
+            translation = {cpu.pc, translator_.epoch(), {block.page[0], block.page[1]},
+                           {block.generation[0], block.generation[1]}, nullptr, 0, 0};
+        }
+
+        if (translation.hits < hot) {
+            if (++translation.hits < hot)
+                return 0;
+            const auto& block {this->block(cpu.pc)};
+            std::array<Intel8080Translator::Instruction, Cache::maxInstructions> code {};
+            std::uint16_t pc {cpu.pc};
+            for (int i {0}; i < block.size; ++i) {
+                code[i] = {pc, block.code[i].opcode, block.code[i].data};
+                pc += block.code[i].length;
+            }
+            translation.code = translator_.translate(code.data(), block.size, mmioPages_ != 0, translation.budget);
+            // translating can have thrown away everything else
+            translation.epoch = translator_.epoch();
+        }
+        if (!translation.code or cycleBudget <= translation.budget)
+            return 0;
+
+        // translated code works on the flags in full
+        cpu.settleFlags_();
+        Intel8080Translator::State state {
+                {cpu.pair_[0], cpu.pair_[1], cpu.pair_[2], cpu.pair_[3], cpu.pair_[4]}, cpu.a_(), cpu.f_(), cpu.pc,
+                cpu.ir_, false, this->policy.memory(), this->code_.data(), this->generation_.data(), mmio_.data()};
+        unsigned states {translation.code(&state)};
+        std::copy(std::begin(state.pair), std::end(state.pair), cpu.pair_);
+        cpu.a_() = state.a;
+        cpu.f_() = state.f;
+        cpu.pc = state.pc;
+        cpu.ir_ = state.ir;
+
+        if (state.interpret)
+            states += cpu.execute_(*this);
+        return states;
+    }
+
+    // turns translation on or off at runtime
+    bool enabled {available()};
+private:
+    struct Translation {
+        std::uint16_t pc {0};
+        std::uint64_t epoch {0};
+        std::uint8_t page[2] {};
+        std::uint64_t generation[2] {};
+        Intel8080Translator::Code code {nullptr};
+        unsigned budget {0};
+        int hits {0};
+    };
+
+    [[nodiscard]] bool valid_(const Translation& translation) const
+    {
+        return this->generation_[translation.page[0]] == translation.generation[0]
+            and this->generation_[translation.page[1]] == translation.generation[1];
+    }
+
+    Intel8080Translator translator_ {};
+    std::vector<Translation> translations_ = std::vector<Translation>(Cache::maxBlocks);
+    std::array<std::uint8_t, 256> mmio_ {};
+    int mmioPages_ {0};
+};
+
+#endif //INTEL8080_INTEL8080JIT_H
@@ -0,0 +1,670 @@
+#ifndef INTEL8080_INTEL8080LOCKSTEP_H
+#define INTEL8080_INTEL8080LOCKSTEP_H
+
+#include "Intel8080.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/*
+ * Many Intel 8080s running the same code side by side, for fuzzing and exhaustive testing where only the starting
+ * registers or memory differ. For example,
+ *      Intel8080Lockstep<16, Io> intel8080s {};
+ *      intel8080s.load(0x100, program);
+ *      intel8080s.setPair(lane, Intel8080::HL, val); // for every lane that needs its own values
+ *      intel8080s.run(cycleBudget);
+ *
+ * Every register is kept as an array with one element per lane (structure of arrays), and each lane has its own 64K of
+ * memory, interleaved so the same address in every lane is one contiguous run of bytes. An instruction is decoded once
+ * and executed for every lane that is at the same pc with the same opcode, in loops over the lanes that the compiler
+ * turns into vector instructions (SSE2 by default, AVX2 or AVX-512 with -march to match) or plain scalar code where
+ * there is nothing to vectorize with. Lanes whose pc or opcode differ (they took another branch, or their code was
+ * changed) are masked off and wait; the lowest pc always goes next so lanes that split up on a branch meet again.
+ *
+ * Each lane computes exactly what Intel8080Core would: the same flags (see add_(), sub_(), ana_() and the rest), the
+ * same WZ and the same states, its own cycles counting only the instructions that lane executed. There are no
+ * interrupts, so EI and DI do nothing and a lane that executes HLT is done for good. Policy has to supply
+ *      std::uint8_t in(std::size_t lane, std::uint8_t port);
+ *      void out(std::size_t lane, std::uint8_t port, std::uint8_t val);
+ * either static or not, which are called for each lane in turn.
+ */
+template<std::size_t lanes, class Policy>
+class Intel8080Lockstep {
+public:
+    static_assert(lanes > 0);
+
+    using Bytes = std::array<std::uint8_t, lanes>;
+    using Words = std::array<std::uint16_t, lanes>;
+    using Mask = std::array<std::uint8_t, lanes>; // 1 for lanes that take part, 0 for the rest
+
+    Intel8080Lockstep() { a_.fill(0U); f_.fill(0b10U); }
+    explicit Intel8080Lockstep(Policy policy) : Intel8080Lockstep() { bus = policy; }
+
+    [[nodiscard]] std::uint8_t read(const std::size_t lane, const std::uint16_t addr) const { return at_(addr, lane); }
+    void write(const std::size_t lane, const std::uint16_t addr, const std::uint8_t val) { at_(addr, lane) = val; }
+
+    /**
+     * Copies data into the memory of every lane.
+     * @param addr where the first byte goes
+     * @param data the bytes, which wrap around past 0xFFFF
+     */
+    void load(const std::uint16_t addr, const std::span<const std::uint8_t> data)
+    {
+        for (std::size_t i {0}; i < data.size(); ++i)
+            for (std::size_t lane {0}; lane < lanes; ++lane)
+                at_(static_cast<std::uint16_t>(addr + i), lane) = data[i];
+    }
+
+    // the register constants are the ones of Intel8080
+    [[nodiscard]] std::uint8_t getReg(const std::size_t lane, const std::uint8_t r) const
+    {
+        if (r == Intel8080::A)
+            return a_[lane];
+        if (r == Intel8080::F)
+            return f_[lane];
+        return r & 1U ? pair_[r >> 1U][lane] & 0xFFU : pair_[r >> 1U][lane] >> 8U;
+    }
+
+    void setReg(const std::size_t lane, const std::uint8_t r, const std::uint8_t val)
+    {
+        if (r == Intel8080::A)
+            a_[lane] = val;
+        else if (r == Intel8080::F)
+            f_[lane] = (val & 0b11010111U) | 0b10U; // same as POP PSW
+        else if (r & 1U)
+            pair_[r >> 1U][lane] = pair_[r >> 1U][lane] & 0xFF00U | val;
+        else
+            pair_[r >> 1U][lane] = pair_[r >> 1U][lane] & 0x00FFU | val << 8U;
+    }
+
+    [[nodiscard]] std::uint16_t getPair(const std::size_t lane, const std::uint8_t rp) const { return pair_[rp][lane]; }
+    void setPair(const std::size_t lane, const std::uint8_t rp, const std::uint16_t val) { pair_[rp][lane] = val; }
+
+    /**
+     * @return true once the lane has executed HLT
+     */
+    [[nodiscard]] bool halted(const std::size_t lane) const { return halted_[lane]; }
+
+    /**
+     * Sets every lane's pc to zero and wakes up the halted ones. Like Intel8080::reset(), the registers and memory are
+     * left alone.
+     */
+    void reset()
+    {
+        pc.fill(0U);
+        halted_.fill(0U);
+        activate_();
+    }
+
+    /**
+     * Executes the instruction at the lowest pc of the lanes that are still running, on every one of them that is at
+     * that pc with the same opcode.
+     * @return the number of lanes that executed it, or 0 if every lane has halted or used up the budget of run()
+     */
+    unsigned step();
+
+    /**
+     * Calls step() until every lane has run for at least cycleBudget more states, or halted.
+     * @param cycleBudget the number of states to run each lane for
+     * @return the number of instructions executed, over all lanes
+     */
+    std::uint64_t run(std::uint64_t cycleBudget);
+
+    // each lane's program counter
+    Words pc {};
+
+    // the number of states each lane has executed
+    std::array<std::uint64_t, lanes> cycles {};
+
+    // the I/O of every lane
+    [[no_unique_address]] Policy bus {};
+private:
+    static constexpr std::uint8_t zeroBit {0b01000000U};
+    static constexpr std::uint8_t signBit {0b10000000U};
+    static constexpr std::uint8_t parityBit {0b00000100U};
+    static constexpr std::uint8_t carryBit {0b00000001U};
+    static constexpr std::uint8_t auxiliaryBit {0b00010000U};
+
+    // Intel8080::zspTable_ worked out instead of looked up, since a table lookup per lane can't be vectorized
+    static constexpr std::uint8_t zsp_(const std::uint8_t val)
+    {
+        std::uint8_t parity = val ^ val >> 4U;
+        parity ^= parity >> 2U;
+        parity ^= parity >> 1U;
+        return (val & signBit) | (val == 0 ? zeroBit : 0U) | (~parity & 1U) << 2U;
+    }
+
+    // Intel8080::inrTable_ and dcrTable_, likewise
+    static constexpr std::uint8_t inr_(const std::uint8_t val)
+    {
+        return zsp_(val) | ((val & 0xFU) == 0 ? auxiliaryBit : 0U) | 0b10U;
+    }
+
+    static constexpr std::uint8_t dcr_(const std::uint8_t val)
+    {
+        return zsp_(val) | ((val & 0xFU) != 0xFU ? auxiliaryBit : 0U) | 0b10U;
+    }
+
+    static constexpr bool sameFlags_()
+    {
+        for (int val {0}; val < 256; ++val)
+            if (zsp_(val) != Intel8080::zspTable_[val] or inr_(val) != Intel8080::inrTable_[val]
+                or dcr_(val) != Intel8080::dcrTable_[val])
+                return false;
+        return true;
+    }
+
+    std::uint8_t& at_(const std::uint16_t addr, const std::size_t lane) { return memory_[addr * lanes + lane]; }
+    [[nodiscard]] std::uint8_t at_(const std::uint16_t addr, const std::size_t lane) const
+    {
+        return memory_[addr * lanes + lane];
+    }
+
+    void activate_()
+    {
+        for (std::size_t l {0}; l < lanes; ++l)
+            active_[l] = !halted_[l] & (cycles[l] < target_[l]);
+    }
+
+    // the row of memory at the address every lane has in addr, or nullptr if they don't all have the same one
+    [[nodiscard]] const std::uint8_t* row_(const Words& addr) const
+    {
+        std::uint16_t differ {0};
+        for (std::size_t l {0}; l < lanes; ++l)
+            differ |= addr[l] ^ addr[0];
+        return differ == 0 ? &memory_[addr[0] * lanes] : nullptr;
+    }
+
+    template<class T>
+    static void select_(std::array<T, lanes>& to, const std::array<T, lanes>& from, const Mask& m)
+    {
+        for (std::size_t l {0}; l < lanes; ++l)
+            to[l] = m[l] ? from[l] : to[l];
+    }
+
+    // an 8-bit register of every lane (not M)
+    [[nodiscard]] Bytes reg_(const int r) const
+    {
+        if (r == Intel8080::A)
+            return a_;
+        Bytes val {};
+        const auto& pair {pair_[r >> 1]};
+        const unsigned shift {r & 1 ? 0U : 8U};
+        for (std::size_t l {0}; l < lanes; ++l)
+            val[l] = pair[l] >> shift;
+        return val;
+    }
+
+    void setReg_(const int r, const Bytes& val, const Mask& m)
+    {
+        if (r == Intel8080::A) {
+            select_(a_, val, m);
+            return;
+        }
+        auto& pair {pair_[r >> 1]};
+        for (std::size_t l {0}; l < lanes; ++l) {
+            const std::uint16_t to = r & 1 ? (pair[l] & 0xFF00U) | val[l] : (pair[l] & 0x00FFU) | val[l] << 8U;
+            pair[l] = m[l] ? to : pair[l];
+        }
+    }
+
+    [[nodiscard]] Bytes load_(const Words& addr, const Mask& m) const
+    {
+        Bytes val {};
+        if (const std::uint8_t* row {row_(addr)}) {
+            for (std::size_t l {0}; l < lanes; ++l)
+                val[l] = row[l];
+            return val;
+        }
+        for (std::size_t l {0}; l < lanes; ++l)
+            if (m[l])
+                val[l] = at_(addr[l], l);
+        return val;
+    }
+
+    void store_(const Words& addr, const Bytes& val, const Mask& m)
+    {
+        if (row_(addr)) {
+            std::uint8_t* row {&memory_[addr[0] * lanes]};
+            for (std::size_t l {0}; l < lanes; ++l)
+                row[l] = m[l] ? val[l] : row[l];
+            return;
+        }
+        for (std::size_t l {0}; l < lanes; ++l)
+            if (m[l])
+                at_(addr[l], l) = val[l];
+    }
+
+    static Bytes lo_(const Words& val)
+    {
+        Bytes lo {};
+        for (std::size_t l {0}; l < lanes; ++l)
+            lo[l] = val[l];
+        return lo;
+    }
+
+    static Words plus_(const Words& val, const std::uint16_t n)
+    {
+        Words sum {};
+        for (std::size_t l {0}; l < lanes; ++l)
+            sum[l] = val[l] + n;
+        return sum;
+    }
+
+    void push_(const Words& val, const Mask& m)
+    {
+        auto& sp {pair_[Intel8080::SP]};
+        Bytes high {};
+        for (std::size_t l {0}; l < lanes; ++l)
+            high[l] = val[l] >> 8U;
+        select_(sp, plus_(sp, 0xFFFFU), m);
+        store_(sp, high, m);
+        select_(sp, plus_(sp, 0xFFFFU), m);
+        store_(sp, lo_(val), m);
+    }
+
+    [[nodiscard]] Words pop_(const Mask& m)
+    {
+        auto& sp {pair_[Intel8080::SP]};
+        const Bytes low {load_(sp, m)};
+        select_(sp, plus_(sp, 1), m);
+        const Bytes high {load_(sp, m)};
+        select_(sp, plus_(sp, 1), m);
+        Words val {};
+        for (std::size_t l {0}; l < lanes; ++l)
+            val[l] = high[l] << 8U | low[l];
+        return val;
+    }
+
+    // the lanes of m whose flags meet the condition of a J/C/R cond opcode (Intel8080::ccc_())
+    [[nodiscard]] Mask ccc_(const std::uint8_t opcode, const Mask& m) const
+    {
+        constexpr std::uint8_t flag[4] {zeroBit, carryBit, parityBit, signBit};
+        const std::uint8_t bit {flag[opcode >> 4U & 3U]};
+        const std::uint8_t set = opcode & 0b1000U ? bit : 0U;
+        Mask taken {};
+        for (std::size_t l {0}; l < lanes; ++l)
+            taken[l] = m[l] & ((f_[l] & bit) == set);
+        return taken;
+    }
+
+    // Intel8080::add_() and adc_()
+    void add_(const Bytes& val, const bool carry, const Mask& m)
+    {
+        Bytes a {}, f {};
+        for (std::size_t l {0}; l < lanes; ++l) {
+            const unsigned res {unsigned(a_[l]) + val[l] + (carry ? f_[l] & carryBit : 0U)};
+            f[l] = zsp_(res) | ((a_[l] ^ val[l] ^ res) & auxiliaryBit) | (res >> 8U) | 0b10U;
+            a[l] = res;
+        }
+        select_(a_, a, m);
+        select_(f_, f, m);
+    }
+
+    // Intel8080::sub_(), sbb_() and cmp_()
+    void sub_(const Bytes& val, const bool carry, const bool store, const Mask& m)
+    {
+        Bytes a {}, f {};
+        for (std::size_t l {0}; l < lanes; ++l) {
+            const unsigned res {unsigned(a_[l]) - val[l] - (carry ? f_[l] & carryBit : 0U)}; // borrow wraps into bit 8
+            f[l] = zsp_(res) | (~(a_[l] ^ val[l] ^ res) & auxiliaryBit) | ((res >> 8U) & carryBit) | 0b10U;
+            a[l] = res;
+        }
+        if (store)
+            select_(a_, a, m);
+        select_(f_, f, m);
+    }
+
+    // Intel8080::ana_(), xra_() and ora_()
+    void logic_(const Bytes& val, const int kind, const Mask& m)
+    {
+        Bytes a {}, f {};
+        for (std::size_t l {0}; l < lanes; ++l) {
+            a[l] = kind == 0 ? a_[l] & val[l] : kind == 1 ? a_[l] ^ val[l] : a_[l] | val[l];
+            f[l] = zsp_(a[l]) | (kind == 0 ? ((a_[l] | val[l]) & 0b1000U) << 1U : 0U) | 0b10U;
+        }
+        select_(a_, a, m);
+        select_(f_, f, m);
+    }
+
+    // Intel8080::inr_() and dcr_(), returns the result
+    Bytes incDec_(const Bytes& val, const bool dec, const Mask& m)
+    {
+        Bytes res {}, f {};
+        for (std::size_t l {0}; l < lanes; ++l) {
+            res[l] = dec ? val[l] - 1U : val[l] + 1U;
+            f[l] = (f_[l] & carryBit) | (dec ? dcr_(res[l]) : inr_(res[l]));
+        }
+        select_(f_, f, m);
+        return res;
+    }
+
+    // the lanes of m that didn't take a conditional call or return skip the rest of it
+    void skip_(const Mask& m, const Mask& taken)
+    {
+        for (std::size_t l {0}; l < lanes; ++l)
+            cycles[l] -= m[l] & !taken[l] ? Intel8080::notTaken_ : 0U;
+    }
+
+    void execute_(std::uint8_t opcode, std::uint16_t at, const Mask& m);
+
+    std::vector<std::uint8_t> memory_ = std::vector<std::uint8_t>(0x10000 * lanes);
+    Bytes a_ {}, f_ {};
+    std::array<Words, 5> pair_ {};
+    Mask halted_ {};
+    // the lanes that haven't halted or used up their budget
+    Mask active_ {[] {
+        Mask active {};
+        active.fill(1U);
+        return active;
+    }()};
+    std::array<std::uint64_t, lanes> target_ {[] {
+        std::array<std::uint64_t, lanes> target {};
+        target.fill(~0ULL);
+        return target;
+    }()};
+};
+
+template<std::size_t lanes, class Policy>
+unsigned Intel8080Lockstep<lanes, Policy>::step()
+{
+    static_assert(sameFlags_(), "the flags worked out per lane have to match Intel8080's tables");
+
+    // the lowest pc goes next, so lanes that went different ways on a branch meet up again where the branches join
+    std::uint16_t at {0xFFFFU};
+    std::uint8_t any {0};
+    for (std::size_t l {0}; l < lanes; ++l) {
+        const std::uint16_t lanePc = pc[l] | static_cast<std::uint16_t>(active_[l] - 1U); // 0FFFFh if inactive
+        at = lanePc < at ? lanePc : at;
+        any |= active_[l];
+    }
+    if (!any)
+        return 0;
+
+    std::size_t lead {0};
+    while (!active_[lead] or pc[lead] != at)
+        ++lead;
+    const std::uint8_t* row {&memory_[at * lanes]};
+    const std::uint8_t opcode {row[lead]};
+    Mask m {};
+    unsigned count {0};
+    for (std::size_t l {0}; l < lanes; ++l) {
+        m[l] = active_[l] & (pc[l] == at) & (row[l] == opcode);
+        count += m[l];
+    }
+
+    execute_(opcode, at, m);
+    return count;
+}
+
+template<std::size_t lanes, class Policy>
+std::uint64_t Intel8080Lockstep<lanes, Policy>::run(const std::uint64_t cycleBudget)
+{
+    for (std::size_t l {0}; l < lanes; ++l)
+        target_[l] = cycles[l] + cycleBudget;
+    activate_();
+    std::uint64_t instructions {0};
+    while (const unsigned count {step()})
+        instructions += count;
+    target_.fill(~0ULL);
+    activate_();
+    return instructions;
+}
+
+template<std::size_t lanes, class Policy>
+void Intel8080Lockstep<lanes, Policy>::execute_(const std::uint8_t opcode, const std::uint16_t at, const Mask& m)
+{
+    using I = Intel8080;
+
+    const int instruction {I::opcode_[opcode]};
+    const int dst {opcode >> 3U & 7}, src {opcode & 7}, rp {opcode >> 4U & 3};
+    const auto next {static_cast<std::uint16_t>(at + I::length_[instruction])};
+
+    // the data bytes are at the same address in every lane, but each lane has its own
+    Words data {};
+    if (I::length_[instruction] > 1)
+        for (std::size_t l {0}; l < lanes; ++l)
+            data[l] = at_(static_cast<std::uint16_t>(at + 1), l);
+    if (I::length_[instruction] > 2)
+        for (std::size_t l {0}; l < lanes; ++l)
+            data[l] |= at_(static_cast<std::uint16_t>(at + 2), l) << 8U;
+
+    for (std::size_t l {0}; l < lanes; ++l)
+        pc[l] = m[l] ? next : pc[l];
+
+    auto& hl {pair_[I::HL]};
+    auto& wz {pair_[I::WZ]};
+    switch (instruction) {
+        case I::index_("MOV r1, r2"): setReg_(dst, reg_(src), m); break;
+        case I::index_("MOV r, M"): setReg_(dst, load_(hl, m), m); break;
+        case I::index_("MOV M, r"): store_(hl, reg_(src), m); break;
+        case I::index_("SPHL"): select_(pair_[I::SP], hl, m); break;
+        case I::index_("MVI r, data"): setReg_(dst, lo_(data), m); break;
+        case I::index_("MVI M, data"): store_(hl, lo_(data), m); break;
+        case I::index_("LXI rp, data"): select_(pair_[rp], data, m); break;
+        case I::index_("LDA addr"):
+            select_(wz, data, m);
+            select_(a_, load_(data, m), m);
+            break;
+        case I::index_("STA addr"):
+            select_(wz, data, m);
+            store_(data, a_, m);
+            break;
+        case I::index_("LHLD addr"): {
+            const Words high {plus_(data, 1)};
+            select_(wz, high, m);
+            setReg_(I::L, load_(data, m), m);
+            setReg_(I::H, load_(high, m), m);
+            break;
+        }
+        case I::index_("SHLD addr"): {
+            const Words high {plus_(data, 1)};
+            select_(wz, high, m);
+            store_(data, reg_(I::L), m);
+            store_(high, reg_(I::H), m);
+            break;
+        }
+        case I::index_("LDAX rp"): select_(a_, load_(pair_[rp], m), m); break;
+        case I::index_("STAX rp"): store_(pair_[rp], a_, m); break;
+        case I::index_("XCHG"): {
+            const Words de {pair_[I::DE]};
+            select_(pair_[I::DE], hl, m);
+            select_(hl, de, m);
+            break;
+        }
+        // ADD, ADC, SUB and SBB with r, M or data
+        case I::index_("ADD r"): case I::index_("ADD M"): case I::index_("ADI data"):
+        case I::index_("ADC r"): case I::index_("ADC M"): case I::index_("ACI data"):
+        case I::index_("SUB r"): case I::index_("SUB M"): case I::index_("SUI data"):
+        case I::index_("SBB r"): case I::index_("SBB M"): case I::index_("SBI data"): {
+            const int form {(instruction - I::index_("ADD r")) % 3};
+            const Bytes val {form == 0 ? reg_(src) : form == 1 ? load_(hl, m) : lo_(data)};
+            if (instruction < I::index_("SUB r"))
+                add_(val, instruction >= I::index_("ADC r"), m);
+            else
+                sub_(val, instruction >= I::index_("SBB r"), true, m);
+            break;
+        }
+        // INR r, DCR r
+        case I::index_("INR r"): case I::index_("DCR r"):
+            setReg_(dst, incDec_(reg_(dst), instruction == I::index_("DCR r"), m), m);
+            break;
+        // INR M, DCR M
+        case I::index_("INR M"): case I::index_("DCR M"):
+            store_(hl, incDec_(load_(hl, m), instruction == I::index_("DCR M"), m), m);
+            break;
+        // INX rp, DCX rp
+        case I::index_("INX rp"): select_(pair_[rp], plus_(pair_[rp], 1), m); break;
+        case I::index_("DCX rp"): select_(pair_[rp], plus_(pair_[rp], 0xFFFFU), m); break;
+        case I::index_("DAD rp"): {
+            Words sum {};
+            Bytes f {};
+            for (std::size_t l {0}; l < lanes; ++l) {
+                const unsigned res {unsigned(hl[l]) + pair_[rp][l]};
+                f[l] = (f_[l] & ~carryBit) | (res >> 16U);
+                sum[l] = res;
+            }
+            select_(f_, f, m);
+            select_(hl, sum, m);
+            break;
+        }
+        case I::index_("DAA"):
+            for (std::size_t l {0}; l < lanes; ++l) {
+                if (m[l]) {
+                    const std::uint16_t entry {I::daaTable_[(f_[l] & carryBit) << 9U | (f_[l] & auxiliaryBit) << 4U | a_[l]]};
+                    a_[l] = entry >> 8U;
+                    f_[l] = entry;
+                }
+            }
+            break;
+        // ANA, XRA, ORA and CMP with r, M or data
+        case I::index_("ANA r"): case I::index_("ANA M"): case I::index_("ANI data"):
+        case I::index_("XRA r"): case I::index_("XRA M"): case I::index_("XRI data"):
+        case I::index_("ORA r"): case I::index_("ORA M"): case I::index_("ORI data"):
+        case I::index_("CMP r"): case I::index_("CMP M"): case I::index_("CPI data"): {
+            const int form {(instruction - I::index_("ANA r")) % 3};
+            const Bytes val {form == 0 ? reg_(src) : form == 1 ? load_(hl, m) : lo_(data)};
+            if (instruction >= I::index_("CMP r"))
+                sub_(val, false, false, m);
+            else
+                logic_(val, (instruction - I::index_("ANA r")) / 3, m);
+            break;
+        }
+        // RLC, RRC, RAL, RAR
+        case I::index_("RLC"): case I::index_("RRC"): case I::index_("RAL"): case I::index_("RAR"): {
+            const bool left {instruction == I::index_("RLC") or instruction == I::index_("RAL")};
+            const bool rotate {instruction == I::index_("RLC") or instruction == I::index_("RRC")}; // not through carry
+            Bytes a {}, f {};
+            for (std::size_t l {0}; l < lanes; ++l) {
+                const std::uint8_t carry = f_[l] & carryBit;
+                const std::uint8_t out = left ? a_[l] >> 7U : a_[l] & 1U;
+                const std::uint8_t in = rotate ? out : carry;
+                a[l] = left ? a_[l] << 1U | in : a_[l] >> 1U | in << 7U;
+                f[l] = (f_[l] & ~carryBit) | out;
+            }
+            select_(a_, a, m);
+            select_(f_, f, m);
+            break;
+        }
+        // CMA, CMC, STC
+        case I::index_("CMA"):
+            for (std::size_t l {0}; l < lanes; ++l)
+                a_[l] = m[l] ? ~a_[l] : a_[l];
+            break;
+        case I::index_("CMC"):
+            for (std::size_t l {0}; l < lanes; ++l)
+                f_[l] = m[l] ? f_[l] ^ carryBit : f_[l];
+            break;
+        case I::index_("STC"):
+            for (std::size_t l {0}; l < lanes; ++l)
+                f_[l] = m[l] ? f_[l] | carryBit : f_[l];
+            break;
+        // JMP addr, J cond addr
+        case I::index_("JMP addr"):
+            select_(wz, data, m);
+            select_(pc, data, m);
+            break;
+        case I::index_("J cond addr"):
+            select_(wz, data, m);
+            select_(pc, data, ccc_(opcode, m));
+            break;
+        // CALL addr, C cond addr
+        case I::index_("CALL addr"): case I::index_("C cond addr"): {
+            const Mask taken {instruction == I::index_("CALL addr") ? m : ccc_(opcode, m)};
+            select_(wz, data, m);
+            Words ret {};
+            ret.fill(next);
+            push_(ret, taken);
+            select_(pc, data, taken);
+            skip_(m, taken);
+            break;
+        }
+        // RET, R cond
+        case I::index_("RET"): case I::index_("R cond addr"): {
+            const Mask taken {instruction == I::index_("RET") ? m : ccc_(opcode, m)};
+            select_(wz, pop_(taken), taken);
+            select_(pc, wz, taken);
+            skip_(m, taken);
+            break;
+        }
+        case I::index_("RST n"): {
+            Words ret {}, vector {};
+            ret.fill(next);
+            vector.fill(opcode & 0b111000U);
+            push_(ret, m);
+            select_(wz, vector, m);
+            select_(pc, vector, m);
+            break;
+        }
+        case I::index_("PCHL"): select_(pc, hl, m); break;
+        // PUSH rp, PUSH PSW
+        case I::index_("PUSH rp"): push_(pair_[rp], m); break;
+        case I::index_("PUSH PSW"): {
+            Words psw {};
+            for (std::size_t l {0}; l < lanes; ++l)
+                psw[l] = a_[l] << 8U | f_[l];
+            push_(psw, m);
+            break;
+        }
+        // POP rp, POP PSW
+        case I::index_("POP rp"): select_(pair_[rp], pop_(m), m); break;
+        case I::index_("POP PSW"): {
+            const Words psw {pop_(m)};
+            Bytes a {}, f {};
+            for (std::size_t l {0}; l < lanes; ++l) {
+                a[l] = psw[l] >> 8U;
+                f[l] = (psw[l] & 0b11010111U) | 0b10U; // bits 3 and 5 are always zero, bit 1 is always one
+            }
+            select_(a_, a, m);
+            select_(f_, f, m);
+            break;
+        }
+        case I::index_("XTHL"): {
+            auto& sp {pair_[I::SP]};
+            const Words high {plus_(sp, 1)};
+            const Bytes low {load_(sp, m)}, topHigh {load_(high, m)};
+            Words top {};
+            for (std::size_t l {0}; l < lanes; ++l)
+                top[l] = topHigh[l] << 8U | low[l];
+            select_(wz, top, m);
+            store_(high, reg_(I::H), m);
+            store_(sp, reg_(I::L), m);
+            select_(hl, top, m);
+            break;
+        }
+        // IN port, OUT port
+        case I::index_("IN port"):
+            select_(wz, data, m);
+            for (std::size_t l {0}; l < lanes; ++l)
+                if (m[l])
+                    a_[l] = bus.in(l, data[l]);
+            break;
+        case I::index_("OUT port"):
+            select_(wz, data, m);
+            for (std::size_t l {0}; l < lanes; ++l)
+                if (m[l])
+                    bus.out(l, data[l], a_[l]);
+            break;
+        // EI, DI (there are no interrupts)
+        case I::index_("EI"): case I::index_("DI"): break;
+        case I::index_("HLT"):
+            for (std::size_t l {0}; l < lanes; ++l) {
+                halted_[l] |= m[l];
+                active_[l] &= !m[l];
+            }
+            break;
+        // NOP
+        default: break;
+    }
+
+    const std::uint64_t states {I::cycles_[instruction]};
+    for (std::size_t l {0}; l < lanes; ++l)
+        cycles[l] += states & -std::uint64_t {m[l]};
+    for (std::size_t l {0}; l < lanes; ++l)
+        active_[l] &= cycles[l] < target_[l];
+}
+
+#endif //INTEL8080_INTEL8080LOCKSTEP_H
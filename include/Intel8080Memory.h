@@ -0,0 +1,103 @@
+#ifndef INTEL8080_INTEL8080MEMORY_H
+#define INTEL8080_INTEL8080MEMORY_H
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+/*
+ * 64K of memory made of 256-byte pages that copies share until one of them writes to a page, so a machine can be forked
+ * thousands of times over without copying all of its memory every time. Together with Intel8080::saveState() it makes a
+ * complete snapshot of a machine. For example,
+ *      struct Machine {
+ *          std::uint8_t read(std::uint16_t addr) const { return memory.read(addr); }
+ *          void write(std::uint16_t addr, std::uint8_t val) { memory.write(addr, val); }
+ *          ... in() and out() ...
+ *          Intel8080Memory memory {};
+ *      };
+ *      Intel8080Core<Machine> intel8080 {};
+ *      ... run the common prefix ...
+ *      Intel8080Core<Machine> whatIf {intel8080}; // copies the registers, shares the memory
+ *
+ * Each copy remembers which pages it made itself and writes only those in place, so it never has to ask a page how
+ * many copies share it. A copy that is only used by one thread at a time can be used while other copies sharing its
+ * pages are used by other threads. Copying one marks the pages of both as shared, so make copies on the thread using
+ * the original.
+ */
+class Intel8080Memory {
+public:
+    static constexpr std::size_t pageSize {0x100};
+    using Page = std::array<std::uint8_t, pageSize>;
+
+    // all zeroes, which every page shares until it's written to
+    Intel8080Memory() { pages_.fill(zeroPage_()); }
+
+    // the copy and the original write their own copies of every page from now on
+    Intel8080Memory(const Intel8080Memory& other) : pages_ {other.pages_} { other.owned_.reset(); }
+
+    Intel8080Memory& operator=(const Intel8080Memory& other)
+    {
+        if (this != &other) {
+            pages_ = other.pages_;
+            owned_.reset();
+            other.owned_.reset();
+        }
+        return *this;
+    }
+
+    Intel8080Memory(Intel8080Memory&&) noexcept = default;
+    Intel8080Memory& operator=(Intel8080Memory&&) noexcept = default;
+    ~Intel8080Memory() = default;
+
+    [[nodiscard]] std::uint8_t read(const std::uint16_t addr) const { return (*pages_[addr >> 8U])[addr & 0xFFU]; }
+
+    void write(const std::uint16_t addr, const std::uint8_t val)
+    {
+        if (!owned_[addr >> 8U])
+            unshare_(addr >> 8U);
+        (*pages_[addr >> 8U])[addr & 0xFFU] = val;
+    }
+
+    /**
+     * Copies data into memory.
+     * @param addr where the first byte goes
+     * @param data the bytes, which wrap around past 0xFFFF
+     */
+    void load(const std::uint16_t addr, const std::span<const std::uint8_t> data)
+    {
+        for (std::size_t i {0}; i < data.size(); ++i)
+            write(static_cast<std::uint16_t>(addr + i), data[i]);
+    }
+
+    /**
+     * @return a copy that shares every page with this one until either of them writes to it
+     */
+    [[nodiscard]] Intel8080Memory fork() const { return *this; }
+
+    /**
+     * @param page the high byte of the addresses in the page
+     * @return the page, which is the same object in every copy still sharing it
+     */
+    [[nodiscard]] const Page& page(const std::uint8_t page) const { return *pages_[page]; }
+private:
+    static std::shared_ptr<Page> zeroPage_()
+    {
+        static const std::shared_ptr<Page> zeroes {std::make_shared<Page>()};
+        return zeroes;
+    }
+
+    void unshare_(const std::size_t page)
+    {
+        pages_[page] = std::make_shared<Page>(*pages_[page]);
+        owned_.set(page);
+    }
+
+    std::array<std::shared_ptr<Page>, 0x10000 / pageSize> pages_ {};
+    // pages no other copy has ever shared. a copy clears it on both sides, which is why it's mutable
+    mutable std::bitset<0x10000 / pageSize> owned_ {};
+};
+
+#endif //INTEL8080_INTEL8080MEMORY_H
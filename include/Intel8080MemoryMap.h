@@ -0,0 +1,137 @@
+#ifndef INTEL8080_INTEL8080MEMORYMAP_H
+#define INTEL8080_INTEL8080MEMORYMAP_H
+
+#include "Intel8080.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/*
+ * Address decoding for the 64K address space, as a table of 256 pages of 256 bytes each. A page is RAM, ROM (reads come
+ * from it, writes are dropped), a memory mapped device, or nothing at all (reads return 0xFF, what a floating data bus
+ * would read, and writes are dropped). Reading RAM or ROM is a single lookup in the table, only devices get a call.
+ * For example,
+ *      struct Machine : Intel8080MemoryMap {
+ *          std::uint8_t in(std::uint8_t port);
+ *          void out(std::uint8_t port, std::uint8_t val);
+ *      };
+ *      Intel8080Core<Machine> intel8080 {};
+ *      intel8080.bus.mapRom(0x00, rom);          // 0000-1FFF, if rom is 8K
+ *      intel8080.bus.mapRam(0x20, ram);          // 2000-3FFF
+ *      intel8080.bus.mapRam(0x40, ram);          // and again at 4000-5FFF
+ *      intel8080.bus.mapDevice(0xF0, 1, video);  // F000-F0FF
+ * or with tick() and runUntil(), call access() at every read and write.
+ *
+ * Mapping a page only changes its entry in the table, so it can be done at any time, e.g. from a device's write() to
+ * switch banks (see Intel8080Banks.h). The memory and devices are only pointed to, they have to outlive the map.
+ * Intel8080BlockCache notices pages being mapped to something else whoever maps them, the program, the host, a
+ * scheduler callback or a device, and decodes them again, but Intel8080Jit needs flat memory instead.
+ */
+class Intel8080MemoryMap {
+public:
+    static constexpr std::size_t pageSize {0x100};
+    static constexpr std::size_t pages {0x10000 / pageSize};
+
+    // a memory mapped device, which gets the full address of every read and write of the pages it's mapped to
+    class Device {
+    public:
+        virtual ~Device() = default;
+        virtual std::uint8_t read(std::uint16_t addr) = 0;
+        virtual void write(std::uint16_t addr, std::uint8_t val) = 0;
+    };
+
+    [[nodiscard]] std::uint8_t read(const std::uint16_t addr) const
+    {
+        if (const std::uint8_t* page {reads_[addr >> 8U]}) [[likely]]
+            return page[addr & 0xFFU];
+        return devices_[addr >> 8U] ? devices_[addr >> 8U]->read(addr) : 0xFFU;
+    }
+
+    void write(const std::uint16_t addr, const std::uint8_t val)
+    {
+        if (std::uint8_t* page {writes_[addr >> 8U]}) [[likely]]
+            page[addr & 0xFFU] = val;
+        else if (devices_[addr >> 8U])
+            devices_[addr >> 8U]->write(addr, val);
+    }
+
+    /**
+     * Does the memory read or write the processor's pins ask for, if any.
+     * @return whether it was one, instead of I/O, an interrupt acknowledge or no cycle at all
+     */
+    bool access(Intel8080& cpu)
+    {
+        if (cpu.pins & Intel8080::DBIN and cpu.status & Intel8080::MEMR >> 16U) {
+            cpu.setDBus(std::uint_fast8_t {read(cpu.getABus())});
+            return true;
+        }
+        if (cpu.pins & Intel8080::WR and !(cpu.status & Intel8080::OUT >> 16U)) {
+            write(cpu.getABus(), cpu.getDBus());
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Maps RAM to as many pages as it fills, which wrap around past page 0xFF. A partial page at the end is left out.
+     * @param first the high byte of the first address
+     */
+    void mapRam(const std::uint8_t first, const std::span<std::uint8_t> ram)
+    {
+        for (std::size_t i {0}; i < ram.size() / pageSize; ++i)
+            set_(first + i, &ram[i * pageSize], &ram[i * pageSize], nullptr);
+    }
+
+    // same as mapRam(), but writes are dropped
+    void mapRom(const std::uint8_t first, const std::span<const std::uint8_t> rom)
+    {
+        for (std::size_t i {0}; i < rom.size() / pageSize; ++i)
+            set_(first + i, &rom[i * pageSize], nullptr, nullptr);
+    }
+
+    // sends every read and write of count pages to the device
+    void mapDevice(const std::uint8_t first, const std::size_t count, Device& device)
+    {
+        for (std::size_t i {0}; i < count; ++i)
+            set_(first + i, nullptr, nullptr, &device);
+    }
+
+    void unmap(const std::uint8_t first, const std::size_t count = 1)
+    {
+        for (std::size_t i {0}; i < count; ++i)
+            set_(first + i, nullptr, nullptr, nullptr);
+    }
+
+    /**
+     * @param page the high byte of the addresses in the page
+     * @return the page's bytes if it's RAM or ROM, otherwise nullptr
+     */
+    [[nodiscard]] const std::uint8_t* page(const std::uint8_t page) const { return reads_[page]; }
+
+    // goes up every time a page is mapped, so Intel8080BlockCache can tell when the memory under its blocks has changed
+    [[nodiscard]] std::uint64_t remaps() const { return remaps_; }
+
+    /**
+     * @param remap the value remaps() had just before the page was mapped, one of the last 256
+     * @return the page
+     */
+    [[nodiscard]] std::uint8_t remapped(const std::uint64_t remap) const { return remapped_[remap % pages]; }
+private:
+    void set_(const std::size_t page, const std::uint8_t* read, std::uint8_t* write, Device* device)
+    {
+        reads_[page % pages] = read;
+        writes_[page % pages] = write;
+        devices_[page % pages] = device;
+        remapped_[remaps_++ % pages] = static_cast<std::uint8_t>(page);
+    }
+
+    std::array<const std::uint8_t*, pages> reads_ {};
+    std::array<std::uint8_t*, pages> writes_ {};
+    std::array<Device*, pages> devices_ {};
+    std::array<std::uint8_t, pages> remapped_ {}; // the last pages mapped, by remaps_
+    std::uint64_t remaps_ {0};
+};
+
+#endif //INTEL8080_INTEL8080MEMORYMAP_H
@@ -0,0 +1,115 @@
+#ifndef INTEL8080_INTEL8080PROFILER_H
+#define INTEL8080_INTEL8080PROFILER_H
+
+#include "Intel8080.h"
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+ * Samples where the emulated program is, and how it got there, whenever the host asks, and writes the samples as folded
+ * stacks ("main;draw;plot 42" lines) for flamegraph.pl, speedscope and the like. It watches the pins like any other
+ * device, but only needs the stops at the reads and writes the host makes to move data anyway, and leaves the timing to
+ * the host, e.g. a sample every 10000 states from an Intel8080Scheduler event,
+ *      Intel8080Profiler profiler {};
+ *      std::ifstream map {"firmware.sym"};
+ *      profiler.loadSymbols(map);
+ *      scheduler.every(10000, 10000, [&profiler](std::uint64_t) { profiler.takeSample(); });
+ *      while (running) {
+ *          scheduler.runUntil(intel8080, Intel8080::DBIN | Intel8080::WR, 1000000);
+ *          profiler.update(intel8080);
+ *          ... memory and I/O ...
+ *      }
+ *      profiler.writeFolded(std::cout);
+ *
+ * The call stack is followed from the stack writes of CALL, conditional calls that are taken, RST and interrupts (a
+ * frame each) and the stack reads of RET and conditional returns that are taken (back to the frame the return address
+ * was pushed by). A frame is also dropped once POP takes its return address off the stack, or a call pushes over it, so
+ * code that resets SP or throws its own return address away doesn't leave the stack growing forever. Nothing else is
+ * looked at between samples, so following the stack costs the same however far apart they are.
+ *
+ * A sample goes to the next instruction fetched, or the HLT if the processor is halted. A halted processor makes no
+ * transfers, so that sample waits for the next stop the host makes for something else, e.g. the scheduler's next
+ * event or the interrupt acknowledge. Stops at SYNC are ignored, so a host that makes them for something else can pass
+ * them on too.
+ */
+class Intel8080Profiler {
+public:
+    /**
+     * Names the code from an address up to the next symbol.
+     */
+    void addSymbol(std::uint16_t addr, std::string name) { symbols_[addr] = std::move(name); }
+
+    /**
+     * Reads "address name" lines, with the address in hex (an optional 0x prefix or h suffix is fine). Anything else is
+     * skipped.
+     * @return the number of symbols read
+     */
+    std::size_t loadSymbols(std::istream& map);
+
+    /**
+     * Takes a sample at the next instruction the processor starts, e.g. from an Intel8080Scheduler event.
+     */
+    void takeSample()
+    {
+        ++due_;
+        watching_ = stack_ | m1_ | halt_;
+    }
+
+    /**
+     * Follows the processor, and takes the samples that are due if it's starting an instruction or halted.
+     * @param cpu the processor, just after tick() or runUntil()
+     */
+    void update(const Intel8080& cpu)
+    {
+        if (cpu.status & watching_) [[unlikely]]
+            look_(cpu);
+    }
+
+    [[nodiscard]] std::uint64_t samples() const { return samples_; }
+
+    /**
+     * Writes a line for every different stack that was sampled: the frames from the outermost in, separated by
+     * semicolons, then the number of samples. Frames are named after the symbol the routine starts in, or its address
+     * in hex, and with symbols loaded the last frame is the symbol of the instruction that was being executed.
+     */
+    void writeFolded(std::ostream& out) const;
+
+    // forgets the samples, but carries on following the call stack
+    void clear()
+    {
+        stacks_.clear();
+        samples_ = 0;
+    }
+private:
+    struct Frame {
+        std::uint16_t entry; // where it was called
+        std::uint16_t slot;  // where its return address is on the stack
+    };
+
+    // the status bits of a fetch (or interrupt acknowledge), a stack cycle and a halt
+    static constexpr std::uint8_t m1_ {Intel8080::M1 >> 16U};
+    static constexpr std::uint8_t stack_ {Intel8080::STACK >> 16U};
+    static constexpr std::uint8_t halt_ {Intel8080::HLTA >> 16U};
+
+    void look_(const Intel8080& cpu);
+    void stackCycle_(const Intel8080& cpu);
+    [[nodiscard]] std::string name_(std::uint16_t addr) const;
+
+    std::uint64_t due_ {0};
+    std::uint64_t samples_ {0};
+    std::uint8_t watching_ {stack_ | m1_}; // the status bits update() looks further at, a fetch first to see the root
+
+    std::vector<Frame> frames_ {};
+    bool started_ {false};
+    std::uint16_t root_ {0}; // where the program was first seen
+
+    std::map<std::uint16_t, std::string> symbols_ {};
+    std::map<std::vector<std::uint16_t>, std::uint64_t> stacks_ {}; // the entries of each frame, then the instruction
+};
+
+#endif //INTEL8080_INTEL8080PROFILER_H
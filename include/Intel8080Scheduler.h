@@ -0,0 +1,174 @@
+#ifndef INTEL8080_INTEL8080SCHEDULER_H
+#define INTEL8080_INTEL8080SCHEDULER_H
+
+#include "Intel8080.h"
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/*
+ * Times devices off Intel8080::clock() instead of having them polled every state or instruction. Timers, UARTs, video
+ * beam interrupts and the like put a callback at the cycle they're next due, and the processor runs straight to the
+ * earliest one. For example, a 60 Hz vertical blank on a 2 MHz 8080,
+ *      Intel8080Scheduler scheduler {};
+ *      scheduler.every(33333, 33333, [&](std::uint64_t) { intel8080.pins |= Intel8080::INT; });
+ *      while (running)
+ *          scheduler.run(intel8080, 1000000); // or scheduler.runUntil(cpu, mask, ...) and service the pins it stops on
+ *
+ * A callback for cycle c runs once the processor's clock() reaches c, before the next state: with runUntil() that's the
+ * exact state, so setting INT from it is the same as the host setting it between two calls of tick(), and the processor
+ * samples it at the start of the next one. run() can only stop between instructions, so there it runs at the first
+ * instruction boundary at or after c, like it would for a host that polls after every step(). Events due at the same
+ * cycle run in the order they were first scheduled, and a callback can schedule or cancel events itself.
+ */
+class Intel8080Scheduler {
+public:
+    // gets the cycle the event was scheduled for, which can be behind the processor's clock() with run()
+    using Callback = std::function<void(std::uint64_t cycle)>;
+
+    static constexpr std::uint64_t never {std::numeric_limits<std::uint64_t>::max()};
+
+    /**
+     * Schedules a callback to run once.
+     * @param cycle the value of clock() to run it at, or right away if it's already past
+     * @return its id, for cancel()
+     */
+    std::uint64_t at(const std::uint64_t cycle, Callback callback)
+    {
+        return push_(cycle, 0, std::move(callback));
+    }
+
+    /**
+     * Schedules a callback to run every period states, without drifting when run() is late for it.
+     * @param first the value of clock() to run it at the first time
+     * @return its id, for cancel()
+     */
+    std::uint64_t every(const std::uint64_t first, const std::uint64_t period, Callback callback)
+    {
+        return push_(first, std::max<std::uint64_t>(period, 1), std::move(callback));
+    }
+
+    // stops an event from running (again), which is safe to do for events that have already run
+    void cancel(const std::uint64_t id)
+    {
+        if (std::ranges::any_of(events_, [id](const Event& event) { return event.id == id; }))
+            cancelled_.insert(id);
+    }
+
+    // the cycle the earliest event is due at, or never
+    [[nodiscard]] std::uint64_t next()
+    {
+        discard_();
+        return events_.empty() ? never : events_.front().cycle;
+    }
+
+    [[nodiscard]] bool empty() { return next() == never; }
+
+    /**
+     * Runs every event due at or before a cycle, including the ones they schedule for it.
+     * @param now usually the processor's clock()
+     * @return how many ran
+     */
+    int dispatch(const std::uint64_t now)
+    {
+        int count {0};
+        while (next() <= now) {
+            std::ranges::pop_heap(events_, later_);
+            Event event {std::move(events_.back())};
+            events_.pop_back();
+            if (event.period) {
+                // put back before it runs, so it can cancel itself
+                events_.push_back({event.cycle + event.period, event.id, event.period, event.callback});
+                std::ranges::push_heap(events_, later_);
+            }
+            event.callback(event.cycle);
+            ++count;
+        }
+        return count;
+    }
+
+    /**
+     * Intel8080::runUntil() that also stops at every event and runs it. Events due when it's called run first, so the
+     * ones due on the state that raised a pin event run at the start of the next call, after the caller has seen to
+     * the pins.
+     * @param eventMask the pins to stop on
+     * @param maxCycles the most states to run for
+     * @return the number of states that elapsed
+     */
+    std::uint64_t runUntil(Intel8080& cpu, const std::uint_fast64_t eventMask, const std::uint64_t maxCycles)
+    {
+        std::uint64_t elapsed {0};
+        while (elapsed < maxCycles) {
+            dispatch(cpu.clock());
+            const std::uint64_t until {std::min(maxCycles - elapsed, next() - cpu.clock())};
+            const std::uint64_t ran {cpu.runUntil(eventMask, until)};
+            elapsed += ran;
+            if (ran < until or cpu.pins & eventMask)
+                break;
+        }
+        return elapsed;
+    }
+
+    /**
+     * run() of Intel8080Core that also stops at the first instruction boundary at or after every event and runs it. A
+     * halted processor waits right up to the next event, so an interrupt from it ends the halt on time. Like runUntil(),
+     * events due when it returns run at the start of the next call.
+     * @param cpu an Intel8080Core, or anything with its run(budget) and clock()
+     * @param cycleBudget the least number of states to run for
+     * @return the number of states that elapsed, which can go over the budget by the rest of the last instruction
+     */
+    template<class Processor>
+        requires requires(Processor& cpu, std::uint64_t budget) {
+            { cpu.run(budget) } -> std::convertible_to<std::uint64_t>;
+            { cpu.clock() } -> std::convertible_to<std::uint64_t>;
+        }
+    std::uint64_t run(Processor& cpu, const std::uint64_t cycleBudget)
+    {
+        std::uint64_t elapsed {0};
+        while (elapsed < cycleBudget) {
+            dispatch(cpu.clock());
+            elapsed += cpu.run(std::min(cycleBudget - elapsed, next() - cpu.clock()));
+        }
+        return elapsed;
+    }
+private:
+    struct Event {
+        std::uint64_t cycle;
+        std::uint64_t id;
+        std::uint64_t period; // 0 for events that only run once
+        Callback callback;
+    };
+
+    std::uint64_t push_(const std::uint64_t cycle, const std::uint64_t period, Callback callback)
+    {
+        events_.push_back({cycle, nextId_, period, std::move(callback)});
+        std::ranges::push_heap(events_, later_);
+        return nextId_++;
+    }
+
+    // drops cancelled events off the top of the heap, the ones further down wait until they get there
+    void discard_()
+    {
+        while (!events_.empty() and cancelled_.erase(events_.front().id)) {
+            std::ranges::pop_heap(events_, later_);
+            events_.pop_back();
+        }
+    }
+
+    // the heap puts the earliest cycle on top, and the earliest scheduled of those
+    static constexpr auto later_ {[](const Event& a, const Event& b) {
+        return std::pair {a.cycle, a.id} > std::pair {b.cycle, b.id};
+    }};
+
+    std::vector<Event> events_ {};
+    std::unordered_set<std::uint64_t> cancelled_ {};
+    std::uint64_t nextId_ {0};
+};
+
+#endif //INTEL8080_INTEL8080SCHEDULER_H
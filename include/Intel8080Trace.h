@@ -0,0 +1,221 @@
+#ifndef INTEL8080_INTEL8080TRACE_H
+#define INTEL8080_INTEL8080TRACE_H
+
+#include "Intel8080.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+ * Traces the processor an instruction at a time into a ring buffer, which a thread of its own encodes and writes out.
+ * Recording never allocates, locks or waits on the writer: if the buffer is full the record is dropped and counted
+ * instead, so make it big enough for the disk to keep up. The next record that does fit is written as a keyframe that
+ * says how many are missing before it. For example,
+ *      std::ofstream file {"rom.trace", std::ios::binary};
+ *      Intel8080Trace trace {file};
+ *      while (running) {
+ *          intel8080.tick();
+ *          ++cycle;
+ *          if (intel8080.pins & Intel8080::SYNC and intel8080.status == Intel8080::instructionFetch)
+ *              trace.record(intel8080, cycle, {memory[pc], memory[pc + 1], memory[pc + 2], memory[pc + 3]});
+ *          ...
+ *      }
+ * and Intel8080_trace rom.trace turns it into text afterwards. Only one thread may record at a time.
+ *
+ * A trace file is an 16 byte header ("8080TRC", a zero, then the version and the keyframe interval as 32 bit
+ * little-endian numbers), the records, and an index of the keyframes once the trace is closed. A record starts with a
+ * byte of flags:
+ *      0x80                 a keyframe: the cycle as 8 bytes, then pc, af, bc, de, hl and sp as 2 bytes each, then the
+ *                           4 bytes of code. Every keyframe interval-th record is one, starting with the first
+ *      0xC0                 a keyframe after a gap: the number of records dropped before it as a LEB128 number, then the
+ *                           same as a keyframe. It's only in the index if a keyframe was due there anyway
+ *      0x01 through 0x20    otherwise, which of pc, af, bc, de, hl and sp changed since the record before
+ *      0x40                 and whether the code did
+ * followed, when it isn't a keyframe, by the difference from the cycle before as a zigzag LEB128 number and then the
+ * fields that changed in the same order. Numbers are little-endian. The index is the record number and file offset of
+ * every keyframe as 8 bytes each, how many there are as 8 bytes, and "8080IDX" and a zero. A trace that was never
+ * closed has no index, but reads the same.
+ */
+class Intel8080Trace {
+public:
+    // the processor at the start of an instruction
+    struct Record {
+        std::uint64_t cycle;
+        std::uint16_t pc, af, bc, de, hl, sp;
+        std::array<std::uint8_t, 4> code; // the opcode at pc and the 3 bytes after it
+
+        bool operator==(const Record&) const = default;
+    };
+    static_assert(sizeof(Record) == 24);
+
+    // turns records into the bytes of a trace file
+    class Encoder {
+    public:
+        explicit Encoder(std::uint32_t keyframeInterval = 4096);
+
+        // appends the header
+        void begin(std::vector<std::uint8_t>& out);
+        // missing is how many records were dropped right before this one
+        void add(const Record& record, std::vector<std::uint8_t>& out, std::uint64_t missing = 0);
+        // appends the index
+        void end(std::vector<std::uint8_t>& out) const;
+    private:
+        std::uint32_t keyframeInterval_;
+        std::uint64_t records_ {0}, offset_ {0};
+        Record last_ {};
+        std::vector<std::uint64_t> keyframes_ {}; // record number and offset of each
+    };
+
+    /**
+     * Starts the thread writing to out, which has to be binary and outlive the trace.
+     * @param capacity how many records the buffer holds, rounded up to a power of 2
+     */
+    explicit Intel8080Trace(std::ostream& out, std::size_t capacity = 1U << 20U, std::uint32_t keyframeInterval = 4096);
+
+    // writes out whatever is left in the buffer and the index, then stops the thread
+    ~Intel8080Trace();
+
+    Intel8080Trace(const Intel8080Trace&) = delete;
+    Intel8080Trace& operator=(const Intel8080Trace&) = delete;
+
+    void record(const Intel8080& cpu, const std::uint64_t cycle, const std::array<std::uint8_t, 4> code) noexcept
+    {
+        const std::uint64_t head {head_.load(std::memory_order_relaxed)};
+        if (head - tail_ == mask_ + 1) {
+            // only look at how far the writer has got once the buffer seems full, it's on another core's cache line
+            tail_ = written_.load(std::memory_order_acquire);
+            if (head - tail_ == mask_ + 1) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                ++missing_;
+                return;
+            }
+        }
+        buffer_[head & mask_] = {
+                {cycle, cpu.pc, static_cast<std::uint16_t>(cpu.getReg(Intel8080::A) << 8U | cpu.getReg(Intel8080::F)),
+                 cpu.getPair(Intel8080::BC), cpu.getPair(Intel8080::DE), cpu.getPair(Intel8080::HL),
+                 cpu.getPair(Intel8080::SP), code},
+                missing_};
+        missing_ = 0;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    // the records that didn't fit in the buffer
+    [[nodiscard]] std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    /**
+     * @return the record as a line of text (without the newline), e.g.
+     * "PC: 0100, AF: 0002, BC: 0000, DE: 0000, HL: 0000, SP: 0000, CYC: 0	(C3 B2 01 4D) - jmp $"
+     */
+    static std::string render(const Record& record);
+
+    /**
+     * Reads a line written by render(), which is also what Intel8080_test -debug used to print.
+     * @return false if it isn't one, e.g. the output of the program or of -v
+     */
+    static bool parse(std::string_view line, Record& record);
+
+    // e.g. "mov a,M", or "ill" for the opcodes that aren't documented
+    static const std::string& disassemble(std::uint8_t opcode);
+private:
+    struct Slot {
+        Record record;
+        std::uint64_t missing; // dropped right before it
+    };
+
+    void write_(const std::stop_token& stop);
+
+    std::ostream& out_;
+    const std::uint64_t mask_;
+    const std::unique_ptr<Slot[]> buffer_;
+    Encoder encoder_;
+
+    // the recording side and the writing side each have a cache line to themselves
+    alignas(64) std::atomic<std::uint64_t> head_ {0};
+    std::uint64_t tail_ {0};    // the last value of written_ the recording side saw
+    std::uint64_t missing_ {0}; // dropped since the last record that fit
+    alignas(64) std::atomic<std::uint64_t> written_ {0};
+    alignas(64) std::atomic<std::uint64_t> dropped_ {0};
+
+    std::jthread writer_; // last, so it starts once everything above is ready
+};
+
+/*
+ * Reads a trace file by mapping it into memory, so only the parts that are read are ever loaded. For example,
+ *      Intel8080TraceReader reader {};
+ *      if (reader.open("rom.trace"))
+ *          for (Intel8080Trace::Record record {}; reader.next(record);)
+ *              ...
+ */
+class Intel8080TraceReader {
+public:
+    struct Keyframe {
+        std::uint64_t record;
+        std::uint64_t offset;
+    };
+
+    Intel8080TraceReader() = default;
+    ~Intel8080TraceReader() { close(); }
+
+    Intel8080TraceReader(const Intel8080TraceReader&) = delete;
+    Intel8080TraceReader& operator=(const Intel8080TraceReader&) = delete;
+
+    /**
+     * @return false if the file can't be mapped or isn't a trace
+     */
+    bool open(const std::string& path);
+
+    /**
+     * Reads a trace that's already in memory, which has to outlive the reader.
+     * @return false if it isn't a trace
+     */
+    bool open(std::span<const std::uint8_t> bytes);
+
+    void close();
+
+    /**
+     * Decodes the next record.
+     * @return false at the end of the trace, or where a trace that was cut short stops making sense
+     */
+    bool next(Intel8080Trace::Record& record);
+
+    /**
+     * Carries on from the last keyframe at or before a record, so the next few calls to next() skip up to it. Without an
+     * index it starts again from the beginning.
+     */
+    void seek(std::uint64_t record);
+
+    // how many records have been read
+    [[nodiscard]] std::uint64_t position() const { return records_; }
+
+    // how many records were dropped right before the one next() last read, 0 unless the trace has a gap there
+    [[nodiscard]] std::uint64_t gap() const { return gap_; }
+
+    // from the index, empty if there isn't one
+    [[nodiscard]] std::span<const Keyframe> keyframes() const { return keyframes_; }
+
+    // the encoded records, from the one at a file offset up to the index
+    [[nodiscard]] std::span<const std::uint8_t> bytes(std::uint64_t offset) const { return data_.subspan(offset); }
+    [[nodiscard]] std::uint64_t offset() const { return offset_; }
+private:
+    bool index_();
+
+    std::span<const std::uint8_t> data_ {}; // the header and records, without the index
+    std::span<const std::uint8_t> mapped_ {};
+    void* mapping_ {nullptr};                // the handle of the mapping on Windows
+    std::vector<Keyframe> keyframes_ {};
+
+    std::uint64_t offset_ {0}, records_ {0}, gap_ {0};
+    std::uint32_t keyframeInterval_ {0};
+    Intel8080Trace::Record last_ {};
+};
+
+#endif //INTEL8080_INTEL8080TRACE_H
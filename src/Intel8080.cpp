@@ -1,104 +1,114 @@
-#include "../include/Intel8080.h"
+#include "../include/Intel8080Core.h"
 
 #include <vector>
-#include <bit>
-
-constexpr int mnemonic[72] {
-        3, // MOV r1, r2
-        5, // MOV r, M
-        9, // MOV M, r
-        13, // SPHL
-        15, // MVI r, data
-        19, // MVI M, data
-        26, // LXI rp, data
-        33, // LDA addr
-        43, // STA addr
-        53, // LHLD addr
-        66, // SHLD addr
-        79, // LDAX rp
-        83, // STAX rp
-        87, // XCHG
-        88, // ADD r
-        89, // ADD M
-        93, // ADI data
-        97, // ADC r
-        98, // ADC M
-        102, // ACI data
-        106, // SUB r
-        107, // SUB M
-        111, // SUI data
-        115, // SBB r
-        116, // SBB M
-        120, // SBI data
-        124, // INR r
-        126, // INR M
-        133, // DCR r
-        135, // DCR M
-        142, // INX rp
-        144, // DCX rp
-        146, // DAD rp
-        153, // DAA
-        154, // ANA r
-        155, // ANA M
-        159, // ANI data
-        163, // XRA r
-        164, // XRA M
-        168, // XRI data
-        172, // ORA r
-        173, // ORA M
-        177, // ORI data
-        181, // CMP r
-        182, // CMP M
-        186, // CPI data
-        190, // RLC
-        191, // RRC
-        192, // RAL
-        193, // RAR
-        194, // CMA
-        195, // CMC
-        196, // STC
-        197, // JMP addr
-        204, // J cond addr
-        211, // CALL addr
-        225, // C cond addr
-        239, // RET
-        246, // R cond addr
-        254, // RST n
-        262, // PCHL
-        264, // PUSH rp
-        272, // PUSH PSW
-        280, // POP rp
-        287, // POP PSW
-        294, // XTHL
-        309, // IN port
-        316, // OUT port
-        323, // EI
-        324, // DI
-        325, // HLT
-        328, // NOP
-};
-
-constexpr int opcode[256] {
-        71, 6, 12, 30, 26, 28, 4, 46, 71, 32, 11, 31, 26, 28, 4, 47,
-        71, 6, 12, 30, 26, 28, 4, 48, 71, 32, 11, 31, 26, 28, 4, 49,
-        71, 6, 10, 30, 26, 28, 4, 33, 71, 32, 9, 31, 26, 28, 4, 50,
-        71, 6, 8, 30, 27, 29, 5, 52, 71, 32, 7, 31, 26, 28, 4, 51,
-        0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0,
-        0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0,
-        0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0,
-        2, 2, 2, 2, 2, 2, 70, 2, 0, 0, 0, 0, 0, 0, 1, 0,
-        14, 14, 14, 14, 14, 14, 15, 14, 17, 17, 17, 17, 17, 17, 18, 17,
-        20, 20, 20, 20, 20, 20, 21, 20, 23, 23, 23, 23, 23, 23, 24, 23,
-        34, 34, 34, 34, 34, 34, 35, 34, 37, 37, 37, 37, 37, 37, 38, 37,
-        40, 40, 40, 40, 40, 40, 41, 40, 43, 43, 43, 43, 43, 43, 44, 43,
-        58, 63, 54, 53, 56, 61, 16, 59, 58, 57, 54, 53, 56, 55, 19, 59,
-        58, 63, 54, 67, 56, 61, 22, 59, 58, 57, 54, 66, 56, 55, 25, 59,
-        58, 63, 54, 65, 56, 61, 36, 59, 58, 60, 54, 13, 56, 55, 39, 59,
-        58, 64, 54, 69, 56, 62, 42, 59, 58, 3, 54, 68, 56, 55, 45, 59,
-};
 
-void Intel8080::tick()
+#if defined(__GNUC__) and !defined(INTEL8080_SWITCH_DISPATCH)
+#define INTEL8080_COMPUTED_GOTO 1
+#endif
+
+#ifdef INTEL8080_COUNTERS
+#define COUNT(statement) statement
+#else
+#define COUNT(statement)
+#endif
+
+#ifdef INTEL8080_COMPUTED_GOTO
+// in a batch, every state jumps straight to the next one through its own indirect jump, which the branch predictor
+// handles much better than the single one the switch turns into. the switch is the portable fallback
+#define STATE(n) case n: state##n
+#define THREAD_STATE                                   \
+    if (elapsed < maxCycles and !(pins & eventMask)) { \
+        ++elapsed;                                     \
+        if (pins & INT and pins & INTE)                \
+            intreq_ = true;                            \
+        goto *states[step_];                           \
+    }                                                  \
+    return elapsed
+#define NEXT_STATE             \
+    do {                       \
+        if constexpr (batch) { \
+            ++step_;           \
+            THREAD_STATE;      \
+        } else {               \
+            goto next;         \
+        }                      \
+    } while (false)
+#define WAIT_STATE                             \
+    do {                                       \
+        if constexpr (batch) {                 \
+            COUNT(++counters_.waitStates);     \
+            if (pins & READY)                  \
+                pins &= ~WAIT;                 \
+            THREAD_STATE;                      \
+        } else {                               \
+            goto wait;                         \
+        }                                      \
+    } while (false)
+#else
+#define STATE(n) case n
+#define NEXT_STATE goto next
+#define WAIT_STATE goto wait
+#endif
+
+#ifdef INTEL8080_COMPUTED_GOTO
+// tick() leaves the states' labels unused
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-label"
+#endif
+template<bool batch>
+std::uint64_t Intel8080::tick_(const std::uint_fast64_t eventMask, const std::uint64_t maxCycles)
 {
+#ifdef INTEL8080_COMPUTED_GOTO
+    // only taking the addresses of the states when they are needed leaves tick() as fast as the switch
+    [[maybe_unused]] void* const* states {nullptr};
+    if constexpr (batch) {
+        static void* const table[] {
+                &&state0, &&state1, &&state2, &&state3, &&state4, &&state5, &&state6, &&state7, &&state8,
+                &&state9, &&state10, &&state11, &&state12, &&state13, &&state14, &&state15, &&state16, &&state17,
+                &&state18, &&state19, &&state20, &&state21, &&state22, &&state23, &&state24, &&state25, &&state26,
+                &&state27, &&state28, &&state29, &&state30, &&state31, &&state32, &&state33, &&state34, &&state35,
+                &&state36, &&state37, &&state38, &&state39, &&state40, &&state41, &&state42, &&state43, &&state44,
+                &&state45, &&state46, &&state47, &&state48, &&state49, &&state50, &&state51, &&state52, &&state53,
+                &&state54, &&state55, &&state56, &&state57, &&state58, &&state59, &&state60, &&state61, &&state62,
+                &&state63, &&state64, &&state65, &&state66, &&state67, &&state68, &&state69, &&state70, &&state71,
+                &&state72, &&state73, &&state74, &&state75, &&state76, &&state77, &&state78, &&state79, &&state80,
+                &&state81, &&state82, &&state83, &&state84, &&state85, &&state86, &&state87, &&state88, &&state89,
+                &&state90, &&state91, &&state92, &&state93, &&state94, &&state95, &&state96, &&state97, &&state98,
+                &&state99, &&state100, &&state101, &&state102, &&state103, &&state104, &&state105, &&state106, &&state107,
+                &&state108, &&state109, &&state110, &&state111, &&state112, &&state113, &&state114, &&state115, &&state116,
+                &&state117, &&state118, &&state119, &&state120, &&state121, &&state122, &&state123, &&state124, &&state125,
+                &&state126, &&state127, &&state128, &&state129, &&state130, &&state131, &&state132, &&state133, &&state134,
+                &&state135, &&state136, &&state137, &&state138, &&state139, &&state140, &&state141, &&state142, &&state143,
+                &&state144, &&state145, &&state146, &&state147, &&state148, &&state149, &&state150, &&state151, &&state152,
+                &&state153, &&state154, &&state155, &&state156, &&state157, &&state158, &&state159, &&state160, &&state161,
+                &&state162, &&state163, &&state164, &&state165, &&state166, &&state167, &&state168, &&state169, &&state170,
+                &&state171, &&state172, &&state173, &&state174, &&state175, &&state176, &&state177, &&state178, &&state179,
+                &&state180, &&state181, &&state182, &&state183, &&state184, &&state185, &&state186, &&state187, &&state188,
+                &&state189, &&state190, &&state191, &&state192, &&state193, &&state194, &&state195, &&state196, &&state197,
+                &&state198, &&state199, &&state200, &&state201, &&state202, &&state203, &&state204, &&state205, &&state206,
+                &&state207, &&state208, &&state209, &&state210, &&state211, &&state212, &&state213, &&state214, &&state215,
+                &&state216, &&state217, &&state218, &&state219, &&state220, &&state221, &&state222, &&state223, &&state224,
+                &&state225, &&state226, &&state227, &&state228, &&state229, &&state230, &&state231, &&state232, &&state233,
+                &&state234, &&state235, &&state236, &&state237, &&state238, &&state239, &&state240, &&state241, &&state242,
+                &&state243, &&state244, &&state245, &&state246, &&state247, &&state248, &&state249, &&state250, &&state251,
+                &&state252, &&state253, &&state254, &&state255, &&state256, &&state257, &&state258, &&state259, &&state260,
+                &&state261, &&state262, &&state263, &&state264, &&state265, &&state266, &&state267, &&state268, &&state269,
+                &&state270, &&state271, &&state272, &&state273, &&state274, &&state275, &&state276, &&state277, &&state278,
+                &&state279, &&state280, &&state281, &&state282, &&state283, &&state284, &&state285, &&state286, &&state287,
+                &&state288, &&state289, &&state290, &&state291, &&state292, &&state293, &&state294, &&state295, &&state296,
+                &&state297, &&state298, &&state299, &&state300, &&state301, &&state302, &&state303, &&state304, &&state305,
+                &&state306, &&state307, &&state308, &&state309, &&state310, &&state311, &&state312, &&state313, &&state314,
+                &&state315, &&state316, &&state317, &&state318, &&state319, &&state320, &&state321, &&state322, &&state323,
+                &&state324, &&state325, &&state326, &&state327, &&state328
+        };
+        static_assert(std::size(table) == stateCount_, "a label for every state of the instructions");
+        states = table;
+    }
+#endif
+    // including the current one
+    std::uint64_t elapsed {1};
+
+start:
     if (pins & INT and pins & INTE) {
         intreq_ = true;
     }
@@ -111,13 +121,22 @@ void Intel8080::tick()
             intWhileHalt_ = true;
         }
     }
-    if (stopped_) return;
+    if (stopped_) {
+        COUNT(++counters_.states[ir_]);
+        goto ticked;
+    }
 
+#ifdef INTEL8080_COMPUTED_GOTO
+    if constexpr (batch)
+        goto *states[step_];
+#endif
     switch (step_) {
         // instruction fetch
-        case 0:
+        STATE(0):
+            COUNT(begun_ = clock_ + elapsed - 1);
             setABus_(pc);
             if (intff_) {
+                COUNT(++counters_.interrupts);
                 setDBus(INTA|WO|M1);
                 if (intWhileHalt_) {
                     intWhileHalt_ = false;
@@ -128,393 +147,394 @@ void Intel8080::tick()
                 setDBus(WO|M1|MEMR);
             }
             t1_();
-            goto next;
-        case 1:
+            NEXT_STATE;
+        STATE(1):
             readT2_();
             intff_ ? intff_ = false : ++pc;
-            goto next;
-        case 2:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(2):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 ir_ = getDBus();
-                step_ = mnemonic[opcode[ir_]];
-                return;
+                COUNT(++counters_.executed[ir_]);
+                step_ = mnemonic_[opcode_[ir_]];
+                goto ticked;
             }
 
-        // MOV r1, r2
-        case 3: goto next;
-        case 4:
+        static_assert(first_("MOV r1, r2") == 3);
+        STATE(3): NEXT_STATE;
+        STATE(4):
             setReg_(dst_(), getReg(src_()));
             goto done;
 
-        // MOV r, M
-        case 5: goto next;
-        case 6:
+        static_assert(first_("MOV r, M") == 5);
+        STATE(5): NEXT_STATE;
+        STATE(6):
             readT1_(pair_[HL]);
-            goto next;
-        case 7:
+            NEXT_STATE;
+        STATE(7):
             readT2_();
-            goto next;
-        case 8:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(8):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setReg_(dst_(), getDBus());
                 goto done;
             }
 
-        // MOV M, r
-        case 9: goto next;
-        case 10:
+        static_assert(first_("MOV M, r") == 9);
+        STATE(9): NEXT_STATE;
+        STATE(10):
             writeT1_(pair_[HL]);
-            goto next;
-        case 11:
+            NEXT_STATE;
+        STATE(11):
             writeT2_(getReg(src_()));
-            goto next;
-        case 12:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(12):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
                 goto done;
             }
 
-        // SPHL
-        case 13: goto next;
-        case 14:
+        static_assert(first_("SPHL") == 13);
+        STATE(13): NEXT_STATE;
+        STATE(14):
             pair_[SP] = pair_[HL];
             goto done;
 
-        // MVI r, data
-        case 15: goto next;
-        case 16:
+        static_assert(first_("MVI r, data") == 15);
+        STATE(15): NEXT_STATE;
+        STATE(16):
             readT1_(pc);
-            goto next;
-        case 17:
+            NEXT_STATE;
+        STATE(17):
             readT2_();
             ++pc;
-            goto next;
-        case 18:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(18):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setReg_(dst_(), getDBus());
                 goto done;
             }
 
-        // MVI M, data
-        case 19: goto next;
-        case 20:
+        static_assert(first_("MVI M, data") == 19);
+        STATE(19): NEXT_STATE;
+        STATE(20):
             readT1_(pc);
-            goto next;
-        case 21:
+            NEXT_STATE;
+        STATE(21):
             readT2_();
             ++pc;
-            goto next;
-        case 22:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(22):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
-                goto next;
+                NEXT_STATE;
             }
-        case 23:
+        STATE(23):
             writeT1_(pair_[HL]);
-            goto next;
-        case 24:
+            NEXT_STATE;
+        STATE(24):
             writeT2_(tmp_);
-            goto next;
-        case 25:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(25):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
                 goto done;
             }
 
-        // LXI rp, data
-        case 26: goto next;
-        case 27:
+        static_assert(first_("LXI rp, data") == 26);
+        STATE(26): NEXT_STATE;
+        STATE(27):
             readT1_(pc);
-            goto next;
-        case 28:
+            NEXT_STATE;
+        STATE(28):
             readT2_();
             ++pc;
-            goto next;
-        case 29:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(29):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setLo_(rp_(), getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 30:
+        STATE(30):
             readT1_(pc);
-            goto next;
-        case 31:
+            NEXT_STATE;
+        STATE(31):
             readT2_();
             ++pc;
-            goto next;
-        case 32:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(32):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setHi_(rp_(), getDBus());
                 goto done;
             }
 
-        // LDA addr
-        case 33: goto next;
-        case 34:
+        static_assert(first_("LDA addr") == 33);
+        STATE(33): NEXT_STATE;
+        STATE(34):
             readT1_(pc);
-            goto next;
-        case 35:
+            NEXT_STATE;
+        STATE(35):
             readT2_();
             ++pc;
-            goto next;
-        case 36:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(36):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setLo_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 37:
+        STATE(37):
             readT1_(pc);
-            goto next;
-        case 38:
+            NEXT_STATE;
+        STATE(38):
             readT2_();
             ++pc;
-            goto next;
-        case 39:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(39):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setHi_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 40:
+        STATE(40):
             readT1_(pair_[WZ]);
-            goto next;
-        case 41:
+            NEXT_STATE;
+        STATE(41):
             readT2_();
-            goto next;
-        case 42:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(42):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
-                a_ = getDBus();
+                a_() = getDBus();
                 goto done;
             }
 
-        // STA addr
-        case 43: goto next;
-        case 44:
+        static_assert(first_("STA addr") == 43);
+        STATE(43): NEXT_STATE;
+        STATE(44):
             readT1_(pc);
-            goto next;
-        case 45:
+            NEXT_STATE;
+        STATE(45):
             readT2_();
             ++pc;
-            goto next;
-        case 46:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(46):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setLo_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 47:
+        STATE(47):
             readT1_(pc);
-            goto next;
-        case 48:
+            NEXT_STATE;
+        STATE(48):
             readT2_();
             ++pc;
-            goto next;
-        case 49:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(49):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setHi_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 50:
+        STATE(50):
             writeT1_(pair_[WZ]);
-            goto next;
-        case 51:
-            writeT2_(a_);
-            goto next;
-        case 52:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(51):
+            writeT2_(a_());
+            NEXT_STATE;
+        STATE(52):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
                 goto done;
             }
 
-        // LHLD addr
-        case 53: goto next;
-        case 54:
+        static_assert(first_("LHLD addr") == 53);
+        STATE(53): NEXT_STATE;
+        STATE(54):
             readT1_(pc);
-            goto next;
-        case 55:
+            NEXT_STATE;
+        STATE(55):
             readT2_();
             ++pc;
-            goto next;
-        case 56:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(56):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setLo_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 57:
+        STATE(57):
             readT1_(pc);
-            goto next;
-        case 58:
+            NEXT_STATE;
+        STATE(58):
             readT2_();
             ++pc;
-            goto next;
-        case 59:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(59):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setHi_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 60:
+        STATE(60):
             readT1_(pair_[WZ]);
-            goto next;
-        case 61:
+            NEXT_STATE;
+        STATE(61):
             readT2_();
             ++pair_[WZ];
-            goto next;
-        case 62:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(62):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setLo_(HL, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 63:
+        STATE(63):
             readT1_(pair_[WZ]);
-            goto next;
-        case 64:
+            NEXT_STATE;
+        STATE(64):
             readT2_();
-            goto next;
-        case 65:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(65):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setHi_(HL, getDBus());
                 goto done;
             }
 
-        // SHLD addr
-        case 66: goto next;
-        case 67:
+        static_assert(first_("SHLD addr") == 66);
+        STATE(66): NEXT_STATE;
+        STATE(67):
             readT1_(pc);
-            goto next;
-        case 68:
+            NEXT_STATE;
+        STATE(68):
             readT2_();
             ++pc;
-            goto next;
-        case 69:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(69):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setLo_(WZ,getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 70:
+        STATE(70):
             readT1_(pc);
-            goto next;
-        case 71:
+            NEXT_STATE;
+        STATE(71):
             readT2_();
             ++pc;
-            goto next;
-        case 72:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(72):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setHi_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 73:
+        STATE(73):
             writeT1_(pair_[WZ]);
-            goto next;
-        case 74:
+            NEXT_STATE;
+        STATE(74):
             writeT2_(lo_(pair_[HL]));
             ++pair_[WZ];
-            goto next;
-        case 75:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(75):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
-                goto next;
+                NEXT_STATE;
             }
-        case 76:
+        STATE(76):
             writeT1_(pair_[WZ]);
-            goto next;
-        case 77:
+            NEXT_STATE;
+        STATE(77):
             writeT2_(hi_(pair_[HL]));
-            goto next;
-        case 78:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(78):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
                 goto done;
             }
 
-        // LDAX rp
-        case 79: goto next;
-        case 80:
+        static_assert(first_("LDAX rp") == 79);
+        STATE(79): NEXT_STATE;
+        STATE(80):
             readT1_(pair_[rp_()]);
-            goto next;
-        case 81:
+            NEXT_STATE;
+        STATE(81):
             readT2_();
-            goto next;
-        case 82:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(82):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
-                a_ = getDBus();
+                a_() = getDBus();
                 goto done;
             }
 
-        // STAX rp
-        case 83: goto next;
-        case 84:
+        static_assert(first_("STAX rp") == 83);
+        STATE(83): NEXT_STATE;
+        STATE(84):
             writeT1_(pair_[rp_()]);
-            goto next;
-        case 85:
-            writeT2_(a_);
-            goto next;
-        case 86:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(85):
+            writeT2_(a_());
+            NEXT_STATE;
+        STATE(86):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
                 goto done;
             }
 
-        // XCHG
-        case 87: {
+        static_assert(first_("XCHG") == 87);
+        STATE(87): {
             std::swap(pair_[HL], pair_[DE]);
             goto done;
         }
 
-        // ADD r
-        case 88:
+        static_assert(first_("ADD r") == 88);
+        STATE(88):
             add_(getReg(src_()));
             goto done;
 
-        // ADD M
-        case 89: goto next;
-        case 90:
+        static_assert(first_("ADD M") == 89);
+        STATE(89): NEXT_STATE;
+        STATE(90):
             readT1_(pair_[HL]);
-            goto next;
-        case 91:
+            NEXT_STATE;
+        STATE(91):
             readT2_();
-            goto next;
-        case 92:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(92):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -522,17 +542,17 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // ADI data
-        case 93: goto next;
-        case 94:
+        static_assert(first_("ADI data") == 93);
+        STATE(93): NEXT_STATE;
+        STATE(94):
             readT1_(pc);
-            goto next;
-        case 95:
+            NEXT_STATE;
+        STATE(95):
             readT2_();
             ++pc;
-            goto next;
-        case 96:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(96):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -540,21 +560,21 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // ADC r
-        case 97:
+        static_assert(first_("ADC r") == 97);
+        STATE(97):
             adc_(getReg(src_()));
             goto done;
 
-        // ADC M
-        case 98: goto next;
-        case 99:
+        static_assert(first_("ADC M") == 98);
+        STATE(98): NEXT_STATE;
+        STATE(99):
             readT1_(pair_[HL]);
-            goto next;
-        case 100:
+            NEXT_STATE;
+        STATE(100):
             readT2_();
-            goto next;
-        case 101:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(101):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -562,17 +582,17 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // ACI data
-        case 102: goto next;
-        case 103:
+        static_assert(first_("ACI data") == 102);
+        STATE(102): NEXT_STATE;
+        STATE(103):
             readT1_(pc);
-            goto next;
-        case 104:
+            NEXT_STATE;
+        STATE(104):
             readT2_();
             ++pc;
-            goto next;
-        case 105:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(105):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -580,21 +600,21 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // SUB r
-        case 106:
+        static_assert(first_("SUB r") == 106);
+        STATE(106):
             sub_(getReg(src_()));
             goto done;
 
-        // SUB M
-        case 107: goto next;
-        case 108:
+        static_assert(first_("SUB M") == 107);
+        STATE(107): NEXT_STATE;
+        STATE(108):
             readT1_(pair_[HL]);
-            goto next;
-        case 109:
+            NEXT_STATE;
+        STATE(109):
             readT2_();
-            goto next;
-        case 110:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(110):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -602,17 +622,17 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // SUI data
-        case 111: goto next;
-        case 112:
+        static_assert(first_("SUI data") == 111);
+        STATE(111): NEXT_STATE;
+        STATE(112):
             readT1_(pc);
-            goto next;
-        case 113:
+            NEXT_STATE;
+        STATE(113):
             readT2_();
             ++pc;
-            goto next;
-        case 114:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(114):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -620,21 +640,21 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // SBB r
-        case 115:
+        static_assert(first_("SBB r") == 115);
+        STATE(115):
             sbb_(getReg(src_()));
             goto done;
 
-        // SBB M
-        case 116: goto next;
-        case 117:
+        static_assert(first_("SBB M") == 116);
+        STATE(116): NEXT_STATE;
+        STATE(117):
             readT1_(pair_[HL]);
-            goto next;
-        case 118:
+            NEXT_STATE;
+        STATE(118):
             readT2_();
-            goto next;
-        case 119:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(119):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -642,17 +662,17 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // SBI data
-        case 120: goto next;
-        case 121:
+        static_assert(first_("SBI data") == 120);
+        STATE(120): NEXT_STATE;
+        STATE(121):
             readT1_(pc);
-            goto next;
-        case 122:
+            NEXT_STATE;
+        STATE(122):
             readT2_();
             ++pc;
-            goto next;
-        case 123:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(123):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -660,128 +680,112 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // INR r
-        case 124: goto next;
-        case 125:
+        static_assert(first_("INR r") == 124);
+        STATE(124): NEXT_STATE;
+        STATE(125):
             setReg_(dst_(), inr_(getReg(dst_())));
             goto done;
 
-        // INR M
-        case 126: goto next;
-        case 127:
+        static_assert(first_("INR M") == 126);
+        STATE(126): NEXT_STATE;
+        STATE(127):
             readT1_(pair_[HL]);
-            goto next;
-        case 128:
+            NEXT_STATE;
+        STATE(128):
             readT2_();
-            goto next;
-        case 129:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(129):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
-                goto next;
+                NEXT_STATE;
             }
-        case 130:
+        STATE(130):
             writeT1_(pair_[HL]);
-            goto next;
-        case 131:
+            NEXT_STATE;
+        STATE(131):
             writeT2_(inr_(tmp_));
-            goto next;
-        case 132:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(132):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
                 goto done;
             }
 
-        // DCR r
-        case 133: goto next;
-        case 134:
+        static_assert(first_("DCR r") == 133);
+        STATE(133): NEXT_STATE;
+        STATE(134):
             setReg_(dst_(), dcr_(getReg(dst_())));
             goto done;
 
-        // DCR M
-        case 135: goto next;
-        case 136:
+        static_assert(first_("DCR M") == 135);
+        STATE(135): NEXT_STATE;
+        STATE(136):
             readT1_(pair_[HL]);
-            goto next;
-        case 137:
+            NEXT_STATE;
+        STATE(137):
             readT2_();
-            goto next;
-        case 138:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(138):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
-                goto next;
+                NEXT_STATE;
             }
-        case 139:
+        STATE(139):
             writeT1_(pair_[HL]);
-            goto next;
-        case 140:
+            NEXT_STATE;
+        STATE(140):
             writeT2_(dcr_(tmp_));
-            goto next;
-        case 141:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(141):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
                 goto done;
             }
 
-        // INX rp
-        case 142: goto next;
-        case 143:
+        static_assert(first_("INX rp") == 142);
+        STATE(142): NEXT_STATE;
+        STATE(143):
             ++pair_[rp_()];
             goto done;
 
-        // DCX rp
-        case 144: goto next;
-        case 145:
+        static_assert(first_("DCX rp") == 144);
+        STATE(144): NEXT_STATE;
+        STATE(145):
             --pair_[rp_()];
             goto done;
 
-        // DAD
-        case 146: case 147: case 148: case 149: case 150: case 151: goto next;
-        case 152: {
-            setCarryFlag_(pair_[HL] + pair_[rp_()] > 0xFFFF);
-            pair_[HL] = pair_[HL] + pair_[rp_()];
+        static_assert(first_("DAD rp") == 146);
+        STATE(146): STATE(147): STATE(148): STATE(149): STATE(150): STATE(151): NEXT_STATE;
+        STATE(152):
+            dad_(pair_[rp_()]);
             goto done;
-        }
-
-        // DAA
-        case 153: {
-            std::uint8_t addend {0};
-            std::uint8_t msb {static_cast<uint8_t>(a_ & 0xF0)}, lsb {static_cast<uint8_t>(a_ & 0xF)};
-
-            if (lsb > 9 or ac())
-                addend = 6U;
-            setAuxCarryFlag_(lsb + addend > 0xF);
-
-            if (msb > 0x90 or cy() or (msb >= 0x90 and lsb > 9)) {
-                addend += 0x60U;
-                setCarryFlag_(true);
-            }
 
-            a_ += addend;
-            zspFlags_(a_);
+        static_assert(first_("DAA") == 153);
+        STATE(153):
+            daa_();
             goto done;
-        }
 
-        // ANA r
-        case 154:
+        static_assert(first_("ANA r") == 154);
+        STATE(154):
             ana_(getReg(src_()));
             goto done;
 
-        // ANA M
-        case 155: goto next;
-        case 156:
+        static_assert(first_("ANA M") == 155);
+        STATE(155): NEXT_STATE;
+        STATE(156):
             readT1_(pair_[HL]);
-            goto next;
-        case 157:
+            NEXT_STATE;
+        STATE(157):
             readT2_();
-            goto next;
-        case 158:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(158):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -789,17 +793,17 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // ANI data
-        case 159: goto next;
-        case 160:
+        static_assert(first_("ANI data") == 159);
+        STATE(159): NEXT_STATE;
+        STATE(160):
             readT1_(pc);
-            goto next;
-        case 161:
+            NEXT_STATE;
+        STATE(161):
             readT2_();
             ++pc;
-            goto next;
-        case 162:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(162):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -807,21 +811,21 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // XRA data
-        case 163:
+        static_assert(first_("XRA r") == 163);
+        STATE(163):
             xra_(getReg(src_()));
             goto done;
 
-        // XRA M
-        case 164: goto next;
-        case 165:
+        static_assert(first_("XRA M") == 164);
+        STATE(164): NEXT_STATE;
+        STATE(165):
             readT1_(pair_[HL]);
-            goto next;
-        case 166:
+            NEXT_STATE;
+        STATE(166):
             readT2_();
-            goto next;
-        case 167:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(167):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -829,17 +833,17 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // XRI data
-        case 168: goto next;
-        case 169:
+        static_assert(first_("XRI data") == 168);
+        STATE(168): NEXT_STATE;
+        STATE(169):
             readT1_(pc);
-            goto next;
-        case 170:
+            NEXT_STATE;
+        STATE(170):
             readT2_();
             ++pc;
-            goto next;
-        case 171:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(171):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -847,21 +851,21 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // ORA r
-        case 172:
+        static_assert(first_("ORA r") == 172);
+        STATE(172):
             ora_(getReg(src_()));
             goto done;
 
-        // ORA M
-        case 173: goto next;
-        case 174:
+        static_assert(first_("ORA M") == 173);
+        STATE(173): NEXT_STATE;
+        STATE(174):
             readT1_(pair_[HL]);
-            goto next;
-        case 175:
+            NEXT_STATE;
+        STATE(175):
             readT2_();
-            goto next;
-        case 176:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(176):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -869,17 +873,17 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // ORI data
-        case 177: goto next;
-        case 178:
+        static_assert(first_("ORI data") == 177);
+        STATE(177): NEXT_STATE;
+        STATE(178):
             readT1_(pc);
-            goto next;
-        case 179:
+            NEXT_STATE;
+        STATE(179):
             readT2_();
             ++pc;
-            goto next;
-        case 180:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(180):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -887,21 +891,21 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // CMP r
-        case 181:
+        static_assert(first_("CMP r") == 181);
+        STATE(181):
             cmp_(getReg(src_()));
             goto done;
 
-        // CMP M
-        case 182: goto next;
-        case 183:
+        static_assert(first_("CMP M") == 182);
+        STATE(182): NEXT_STATE;
+        STATE(183):
             readT1_(pair_[HL]);
-            goto next;
-        case 184:
+            NEXT_STATE;
+        STATE(184):
             readT2_();
-            goto next;
-        case 185:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(185):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -909,17 +913,17 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // CPI data
-        case 186: goto next;
-        case 187:
+        static_assert(first_("CPI data") == 186);
+        STATE(186): NEXT_STATE;
+        STATE(187):
             readT1_(pc);
-            goto next;
-        case 188:
+            NEXT_STATE;
+        STATE(188):
             readT2_();
             ++pc;
-            goto next;
-        case 189:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(189):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 tmp_ = getDBus();
@@ -927,74 +931,66 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // RLC
-        case 190:
-            setCarryFlag_(a_ & 0x80);
-            a_ = (a_ << 1U) | cy();
+        static_assert(first_("RLC") == 190);
+        STATE(190):
+            rlc_();
             goto done;
 
-        // RRC
-        case 191:
-            setCarryFlag_(a_ & 0x01);
-            a_ = (a_ >> 1U) | (cy() << 7U);
+        static_assert(first_("RRC") == 191);
+        STATE(191):
+            rrc_();
             goto done;
 
-        // RAL
-        case 192: {
-            const std::uint8_t carry {cy()};
-            setCarryFlag_(a_ & 0x80);
-            a_ = (a_ << 1U) | carry;
+        static_assert(first_("RAL") == 192);
+        STATE(192):
+            ral_();
             goto done;
-        }
 
-        // RAR
-        case 193: {
-            const std::uint8_t carry {cy()};
-            setCarryFlag_(a_ & 0x01);
-            a_ = (a_ >> 1U) | (carry << 7U);
+        static_assert(first_("RAR") == 193);
+        STATE(193):
+            rar_();
             goto done;
-        }
 
-        // CMA
-        case 194:
-            a_ = ~a_;
+        static_assert(first_("CMA") == 194);
+        STATE(194):
+            a_() = ~a_();
             goto done;
 
-        // CMC
-        case 195:
-            setCarryFlag_(!cy());
+        static_assert(first_("CMC") == 195);
+        STATE(195):
+            f_() ^= carryBit;
             goto done;
 
-        // STC
-        case 196:
-            setCarryFlag_(true);
+        static_assert(first_("STC") == 196);
+        STATE(196):
+            f_() |= carryBit;
             goto done;
 
-        // JMP addr
-        case 197: goto next;
-        case 198:
+        static_assert(first_("JMP addr") == 197);
+        STATE(197): NEXT_STATE;
+        STATE(198):
             readT1_(pc);
-            goto next;
-        case 199:
+            NEXT_STATE;
+        STATE(199):
             readT2_();
             ++pc;
-            goto next;
-        case 200:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(200):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setLo_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 201:
+        STATE(201):
             readT1_(pc);
-            goto next;
-        case 202:
+            NEXT_STATE;
+        STATE(202):
             readT2_();
             ++pc;
-            goto next;
-        case 203:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(203):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setHi_(WZ, getDBus());
@@ -1002,187 +998,187 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // J cond addr
-        case 204: goto next;
-        case 205:
+        static_assert(first_("J cond addr") == 204);
+        STATE(204): NEXT_STATE;
+        STATE(205):
             readT1_(pc);
-            goto next;
-        case 206:
+            NEXT_STATE;
+        STATE(206):
             readT2_();
             ++pc;
-            goto next;
-        case 207:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(207):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setLo_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 208:
+        STATE(208):
             readT1_(pc);
-            goto next;
-        case 209:
+            NEXT_STATE;
+        STATE(209):
             readT2_();
             ++pc;
-            goto next;
-        case 210:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(210):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setHi_(WZ, getDBus());
-                if (ccc_())
+                if (branch_(ccc_()))
                     pc = pair_[WZ];
                 goto done;
             }
 
-        // CALL addr
-        case 211: goto next;
-        case 212:
+        static_assert(first_("CALL addr") == 211);
+        STATE(211): NEXT_STATE;
+        STATE(212):
             --pair_[SP];
-            goto next;
-        case 213:
+            NEXT_STATE;
+        STATE(213):
             readT1_(pc);
-            goto next;
-        case 214:
+            NEXT_STATE;
+        STATE(214):
             readT2_();
             ++pc;
-            goto next;
-        case 215:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(215):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setLo_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 216:
+        STATE(216):
             readT1_(pc);
-            goto next;
-        case 217:
+            NEXT_STATE;
+        STATE(217):
             readT2_();
             ++pc;
-            goto next;
-        case 218:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(218):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setHi_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 219:
+        STATE(219):
             stackWriteT1_();
-            goto next;
-        case 220:
+            NEXT_STATE;
+        STATE(220):
             writeT2_(hi_(pc));
             --pair_[SP];
-            goto next;
-        case 221:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(221):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
-                goto next;
+                NEXT_STATE;
             }
-        case 222:
+        STATE(222):
             stackWriteT1_();
-            goto next;
-        case 223:
+            NEXT_STATE;
+        STATE(223):
             writeT2_(lo_(pc));
-            goto next;
-        case 224:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(224):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
                 pc = pair_[WZ];
                 goto done;
             }
 
-        // CALL cond addr
-        case 225: goto next;
-        case 226:
+        static_assert(first_("C cond addr") == 225);
+        STATE(225): NEXT_STATE;
+        STATE(226):
             if (ccc_())
                 --pair_[SP];
-            goto next;
-        case 227:
+            NEXT_STATE;
+        STATE(227):
             readT1_(pc);
-            goto next;
-        case 228:
+            NEXT_STATE;
+        STATE(228):
             readT2_();
             ++pc;
-            goto next;
-        case 229:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(229):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setLo_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 230:
+        STATE(230):
             readT1_(pc);
-            goto next;
-        case 231:
+            NEXT_STATE;
+        STATE(231):
             readT2_();
             ++pc;
-            goto next;
-        case 232:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(232):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setHi_(WZ, getDBus());
-                if (ccc_())
-                    goto next;
+                if (branch_(ccc_()))
+                    NEXT_STATE;
                 goto done;
             }
-        case 233:
+        STATE(233):
             stackWriteT1_();
-            goto next;
-        case 234:
+            NEXT_STATE;
+        STATE(234):
             writeT2_(hi_(pc));
             --pair_[SP];
-            goto next;
-        case 235:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(235):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
-                goto next;
+                NEXT_STATE;
             }
-        case 236:
+        STATE(236):
             stackWriteT1_();
-            goto next;
-        case 237:
+            NEXT_STATE;
+        STATE(237):
             writeT2_(lo_(pc));
-            goto next;
-        case 238:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(238):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
                 pc = pair_[WZ];
                 goto done;
             }
 
-        // RET
-        case 239: goto next;
-        case 240:
+        static_assert(first_("RET") == 239);
+        STATE(239): NEXT_STATE;
+        STATE(240):
             stackReadT1_();
-            goto next;
-        case 241:
+            NEXT_STATE;
+        STATE(241):
             readT2_();
             ++pair_[SP];
-            goto next;
-        case 242:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(242):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setLo_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 243:
+        STATE(243):
             stackReadT1_();
-            goto next;
-        case 244:
+            NEXT_STATE;
+        STATE(244):
             readT2_();
             ++pair_[SP];
-            goto next;
-        case 245:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(245):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setHi_(WZ, getDBus());
@@ -1190,35 +1186,35 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // R cond addr
-        case 246: goto next;
-        case 247:
-            if (ccc_())
-                goto next;
+        static_assert(first_("R cond addr") == 246);
+        STATE(246): NEXT_STATE;
+        STATE(247):
+            if (branch_(ccc_()))
+                NEXT_STATE;
             goto done;
-        case 248:
+        STATE(248):
             stackReadT1_();
-            goto next;
-        case 249:
+            NEXT_STATE;
+        STATE(249):
             readT2_();
             ++pair_[SP];
-            goto next;
-        case 250:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(250):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setLo_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 251:
+        STATE(251):
             stackReadT1_();
-            goto next;
-        case 252:
+            NEXT_STATE;
+        STATE(252):
             readT2_();
             ++pair_[SP];
-            goto next;
-        case 253:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(253):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setHi_(WZ, getDBus());
@@ -1226,32 +1222,32 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // RST n
-        case 254: goto next;
-        case 255:
+        static_assert(first_("RST n") == 254);
+        STATE(254): NEXT_STATE;
+        STATE(255):
             --pair_[SP];
-            goto next;
-        case 256:
+            NEXT_STATE;
+        STATE(256):
             stackWriteT1_();
-            goto next;
-        case 257:
+            NEXT_STATE;
+        STATE(257):
             writeT2_(hi_(pc));
             --pair_[SP];
-            goto next;
-        case 258:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(258):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
-                goto next;
+                NEXT_STATE;
             }
-        case 259:
+        STATE(259):
             stackWriteT1_();
-            goto next;
-        case 260:
+            NEXT_STATE;
+        STATE(260):
             writeT2_(lo_(pc));
-            goto next;
-        case 261:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(261):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
                 pair_[WZ] = nnn_();
@@ -1259,338 +1255,333 @@ void Intel8080::tick()
                 goto done;
             }
 
-        // PCHL
-        case 262: goto next;
-        case 263:
+        static_assert(first_("PCHL") == 262);
+        STATE(262): NEXT_STATE;
+        STATE(263):
             pc = pair_[HL];
             goto done;
 
-        // PUSH rp
-        case 264: goto next;
-        case 265:
+        static_assert(first_("PUSH rp") == 264);
+        STATE(264): NEXT_STATE;
+        STATE(265):
             --pair_[SP];
-            goto next;
-        case 266:
+            NEXT_STATE;
+        STATE(266):
             stackWriteT1_();
-            goto next;
-        case 267:
+            NEXT_STATE;
+        STATE(267):
             --pair_[SP];
             writeT2_(hi_(pair_[rp_()]));
-            goto next;
-        case 268:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(268):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
-                goto next;
+                NEXT_STATE;
             }
-        case 269:
+        STATE(269):
             stackWriteT1_();
-            goto next;
-        case 270:
+            NEXT_STATE;
+        STATE(270):
             writeT2_(lo_(pair_[rp_()]));
-            goto next;
-        case 271:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(271):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
                 goto done;
             }
 
-        // PUSH PSW
-        case 272: goto next;
-        case 273:
+        static_assert(first_("PUSH PSW") == 272);
+        STATE(272): NEXT_STATE;
+        STATE(273):
             --pair_[SP];
-            goto next;
-        case 274:
+            NEXT_STATE;
+        STATE(274):
             stackWriteT1_();
-            goto next;
-        case 275:
+            NEXT_STATE;
+        STATE(275):
             --pair_[SP];
-            writeT2_(a_);
-            goto next;
-        case 276:
-            if (waiting_()) goto wait;
+            writeT2_(a_());
+            NEXT_STATE;
+        STATE(276):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
-                goto next;
+                NEXT_STATE;
             }
-        case 277:
+        STATE(277):
             stackWriteT1_();
-            goto next;
-        case 278:
+            NEXT_STATE;
+        STATE(278):
             writeT2_(psw_());
-            goto next;
-        case 279:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(279):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
                 goto done;
             }
 
-        // POP rp
-        case 280: goto next;
-        case 281:
+        static_assert(first_("POP rp") == 280);
+        STATE(280): NEXT_STATE;
+        STATE(281):
             stackReadT1_();
-            goto next;
-        case 282:
+            NEXT_STATE;
+        STATE(282):
             ++pair_[SP];
             readT2_();
-            goto next;
-        case 283:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(283):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setLo_(rp_(), getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 284:
+        STATE(284):
             stackReadT1_();
-            goto next;
-        case 285:
+            NEXT_STATE;
+        STATE(285):
             ++pair_[SP];
             readT2_();
-            goto next;
-        case 286:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(286):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setHi_(rp_(), getDBus());
                 goto done;
             }
 
-        // POP psw
-        case 287: goto next;
-        case 288:
+        static_assert(first_("POP PSW") == 287);
+        STATE(287): NEXT_STATE;
+        STATE(288):
             stackReadT1_();
-            goto next;
-        case 289:
+            NEXT_STATE;
+        STATE(289):
             ++pair_[SP];
             readT2_();
-            goto next;
-        case 290:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(290):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
-                f_ = getDBus() & 0b11010111 | 0b10; // bits 3 and 5 are always zero, bit 2 is always one
-                goto next;
+                f_() = getDBus() & 0b11010111 | 0b10; // bits 3 and 5 are always zero, bit 2 is always one
+                result_ = settled_;
+                NEXT_STATE;
             }
-        case 291:
+        STATE(291):
             stackReadT1_();
-            goto next;
-        case 292:
+            NEXT_STATE;
+        STATE(292):
             ++pair_[SP];
             readT2_();
-            goto next;
-        case 293:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(293):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
-                a_ = getDBus();
+                a_() = getDBus();
                 goto done;
             }
 
-        // XTHL
-        case 294: goto next;
-        case 295:
+        static_assert(first_("XTHL") == 294);
+        STATE(294): NEXT_STATE;
+        STATE(295):
             stackReadT1_(pair_[SP]);
-            goto next;
-        case 296:
+            NEXT_STATE;
+        STATE(296):
             readT2_();
-            goto next;
-        case 297:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(297):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setLo_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 298:
+        STATE(298):
             stackReadT1_(pair_[SP] + 1);
-            goto next;
-        case 299:
+            NEXT_STATE;
+        STATE(299):
             readT2_();
-            goto next;
-        case 300:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(300):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 setHi_(WZ, getDBus());
-                goto next;
+                NEXT_STATE;
             }
-        case 301:
+        STATE(301):
             stackWriteT1_(pair_[SP] + 1);
-            goto next;
-        case 302:
+            NEXT_STATE;
+        STATE(302):
             writeT2_(hi_(pair_[HL]));
-            goto next;
-        case 303:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(303):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
-                goto next;
+                NEXT_STATE;
             }
-        case 304:
+        STATE(304):
             stackWriteT1_(pair_[SP]);
-            goto next;
-        case 305:
+            NEXT_STATE;
+        STATE(305):
             writeT2_(lo_(pair_[HL]));
-            goto next;
-        case 306:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(306):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
-                goto next;
+                NEXT_STATE;
             }
-        case 307: goto next;
-        case 308:
+        STATE(307): NEXT_STATE;
+        STATE(308):
             pair_[HL] = pair_[WZ];
             goto done;
 
-        // IN port
-        case 309: goto next;
-        case 310:
+        static_assert(first_("IN port") == 309);
+        STATE(309): NEXT_STATE;
+        STATE(310):
             readT1_(pc);
-            goto next;
-        case 311:
+            NEXT_STATE;
+        STATE(311):
             readT2_();
             ++pc;
-            goto next;
-        case 312:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(312):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 pair_[WZ] = getDBus();
-                goto next;
+                NEXT_STATE;
             }
-        case 313:
+        STATE(313):
             inputReadT1_();
-            goto next;
-        case 314:
+            NEXT_STATE;
+        STATE(314):
             readT2_();
-            goto next;
-        case 315:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(315):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
-                a_ = getDBus();
+                a_() = getDBus();
                 goto done;
             }
 
-        // OUT port
-        case 316: goto next;
-        case 317:
+        static_assert(first_("OUT port") == 316);
+        STATE(316): NEXT_STATE;
+        STATE(317):
             readT1_(pc);
-            goto next;
-        case 318:
+            NEXT_STATE;
+        STATE(318):
             readT2_();
             ++pc;
-            goto next;
-        case 319:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(319):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataIn_();
                 pair_[WZ] = getDBus();
-                goto next;
+                NEXT_STATE;
             }
-        case 320:
+        STATE(320):
             outputWriteT1_();
-            goto next;
-        case 321:
-            writeT2_(a_);
-            goto next;
-        case 322:
-            if (waiting_()) goto wait;
+            NEXT_STATE;
+        STATE(321):
+            writeT2_(a_());
+            NEXT_STATE;
+        STATE(322):
+            if (waiting_()) WAIT_STATE;
             else {
                 stopDataOut_();
                 goto done;
             }
 
-        // EI
-        case 323:
+        static_assert(first_("EI") == 323);
+        STATE(323):
             pins |= INTE;
             goto done;
 
-        // DI
-        case 324:
+        static_assert(first_("DI") == 324);
+        STATE(324):
             pins &= ~INTE;
             goto done;
 
-        // HLT
-        case 325: goto next;
-        case 326:
+        static_assert(first_("HLT") == 325);
+        STATE(325): NEXT_STATE;
+        STATE(326):
             setABus_(pc);
             setDBus(WO|HLTA|MEMR);
             status = getDBus();
-            goto next;
-        case 327:
+            NEXT_STATE;
+        STATE(327):
             stopped_ = true;
             goto done;
 
-        // NOP
-        case 328: goto done;
+        static_assert(first_("NOP") == 328);
+        STATE(328): goto done;
     }
 
+
     // see (https://floooh.github.io/2021/12/17/cycle-stepped-z80.html)
     wait:
+        COUNT(++counters_.waitStates);
         if (pins & READY)
             pins &= ~WAIT;
-        return;
+        goto ticked;
     next:
         ++step_;
-        return;
+        goto ticked;
     done:
+        COUNT(counters_.states[ir_] += clock_ + elapsed - begun_);
         step_ = 0;
-        return;
+    ticked:
+        if (batch and elapsed < maxCycles and !(pins & eventMask)) {
+            ++elapsed;
+            goto start;
+        }
+        return elapsed;
 }
+#ifdef INTEL8080_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
 
-bool Intel8080::ccc_() const {
-    switch (ir_ >> 3U & 7U) {
-        // NZ - not zero (Z = 0)
-        case 0b000: return (z()) == 0;
-        // Z - zero (Z = 1)
-        case 0b001: return (z()) != 0;
-        // NC - no carry (CY = 0)
-        case 0b010: return (cy()) == 0;
-        // C - carry (CY = 1)
-        case 0b011: return (cy()) != 0;
-        // PO - parity odd (P = 0)
-        case 0b100: return (p()) == 0;
-        // PE - parity even (P = 1)
-        case 0b101: return (p()) != 0;
-        // P - plus (S = 0)
-        case 0b110: return (s()) == 0;
-        // M - minus (S = 1)
-        case 0b111: return (s()) != 0;
-        default: return false;
-    }
+#undef STATE
+#undef THREAD_STATE
+#undef NEXT_STATE
+#undef WAIT_STATE
+#undef COUNT
+
+void Intel8080::tick()
+{
+    tick_<false>(0, 1);
+    ++clock_;
 }
 
-void Intel8080::setReg_(const std::uint8_t r, const std::uint8_t val) {
-    switch (r) {
-        case B: setHi_(BC, val); break;
-        case C: setLo_(BC, val); break;
-        case D: setHi_(DE, val); break;
-        case E: setLo_(DE, val); break;
-        case H: setHi_(HL, val); break;
-        case L: setLo_(HL, val); break;
-        case A: a_ = val; break;
-        case F: f_ = val; break;
-        default: break;
-    }
+std::uint64_t Intel8080::runUntil(const std::uint_fast64_t eventMask, const std::uint64_t maxCycles)
+{
+    const std::uint64_t elapsed {maxCycles == 0 ? 0 : tick_<true>(eventMask, maxCycles)};
+    clock_ += elapsed;
+    return elapsed;
 }
 
-std::uint8_t Intel8080::getReg(const std::uint8_t r) const {
-    switch (r) {
-        case B: return hi_(pair_[BC]);
-        case C: return lo_(pair_[BC]);
-        case D: return hi_(pair_[DE]);
-        case E: return lo_(pair_[DE]);
-        case H: return hi_(pair_[HL]);
-        case L: return lo_(pair_[HL]);
-        case A: return a_;
-        case F: return f_;
-        default: return -1;
-    }
+unsigned Intel8080::step(Bus& bus)
+{
+    const unsigned states {execute_(bus)};
+    clock_ += states;
+    return states;
+}
+
+std::uint64_t Intel8080::run(Bus& bus, const std::uint64_t cycleBudget)
+{
+    const std::uint64_t elapsed {run_(bus, cycleBudget)};
+    clock_ += elapsed;
+    return elapsed;
 }
 
 inline void Intel8080::t1_()
@@ -1675,115 +1666,3 @@ inline void Intel8080::writeT2_(const std::uint8_t r)
     pins |= WR;
     setDBus(r);
 }
-
-inline void Intel8080::add_(const std::uint8_t addend)
-{
-    carryFlagsAdd_(addend);
-    a_ += addend;
-    zspFlags_(a_);
-}
-
-inline void Intel8080::adc_(const std::uint8_t addend)
-{
-    std::uint8_t carry {cy()}; // need temp because carry is updated before accumulator
-    carryFlagsAdd_(addend, carry);
-    a_ += addend + carry;
-    zspFlags_(a_);
-}
-
-inline void Intel8080::sub_(const std::uint8_t subtrahend)
-{
-    carryFlagsSub_(subtrahend);
-    a_ -= subtrahend;
-    zspFlags_(a_);
-}
-
-inline void Intel8080::sbb_(const std::uint8_t subtrahend)
-{
-    std::uint8_t carry {cy()}; // need temp because carry is updated before accumulator
-    carryFlagsSub_(subtrahend, carry);
-    a_ = a_ - subtrahend - carry;
-    zspFlags_(a_);
-}
-
-inline std::uint8_t Intel8080::inr_(std::uint8_t operand)
-{
-    ++operand;
-    setAuxCarryFlag_((operand & 0xFU) == 0); // only case for half carry is 01111 + 1 = 10000
-    zspFlags_(operand);
-    return operand;
-}
-
-inline std::uint8_t Intel8080::dcr_(std::uint8_t operand)
-{
-    --operand;
-    setAuxCarryFlag_((operand & 0xFU) != 0xF); // only case for half borrow is 10000 - 1 = 01111
-    zspFlags_(operand);
-    return operand;
-}
-
-inline void Intel8080::ana_(const std::uint8_t operand)
-{
-    carryFlagsAnd_(operand);
-    a_ &= operand;
-    zspFlags_(a_);
-}
-
-inline void Intel8080::ani_(const std::uint8_t operand)
-{
-    carryFlagsAnd_(operand);
-    a_ &= operand;
-    zspFlags_(a_);
-}
-
-inline void Intel8080::xra_(const std::uint8_t operand)
-{
-    carryFlagsAlg_();
-    a_ ^= operand;
-    zspFlags_(a_);
-}
-
-inline void Intel8080::ora_(const std::uint8_t operand)
-{
-    carryFlagsAlg_();
-    a_ |= operand;
-    zspFlags_(a_);
-}
-
-inline void Intel8080::cmp_(const std::uint8_t operand)
-{
-    carryFlagsSub_(operand);
-    zspFlags_(a_ - operand);
-}
-
-inline void Intel8080::carryFlagsAlg_() {
-    setAuxCarryFlag_(false);
-    setCarryFlag_(false);
-}
-
-inline void Intel8080::carryFlagsAnd_(const std::uint8_t operand)
-{
-    setAuxCarryFlag_((a_ | operand) & 0b1000U);
-    setCarryFlag_(false);
-}
-
-inline void Intel8080::carryFlagsAdd_(const std::uint8_t addend, std::uint8_t cy)
-{
-    std::uint16_t res {static_cast<uint16_t>(a_ + addend + cy)};
-    setAuxCarryFlag_((a_ ^ addend ^ res) & 0x10U);
-    setCarryFlag_(res > 0xFF);
-}
-
-inline void Intel8080::carryFlagsSub_(const std::uint8_t subtrahend, std::uint8_t cy)
-{
-    std::uint16_t res {static_cast<uint16_t>(a_ - subtrahend - cy)};
-    setAuxCarryFlag_(~(a_ ^ subtrahend ^ res) & 0x10U);
-    setCarryFlag_(a_ < subtrahend + cy);
-}
-
-inline void Intel8080::zspFlags_(const std::uint8_t val)
-{
-    setZeroFlag_(val == 0);
-    setSignFlag_(val & 0x80U);
-    setParityFlag_(std::popcount(val) % 2 == 0);
-}
\ No newline at end of file
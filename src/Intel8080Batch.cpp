@@ -0,0 +1,146 @@
+#include "../include/Intel8080Batch.h"
+#include "../include/Intel8080Core.h"
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// memory and I/O of a worker, pointed at the job it's running
+struct Bus {
+    std::uint8_t read(const std::uint16_t addr) const { return (*memory)[addr]; }
+    void write(const std::uint16_t addr, const std::uint8_t val) const { (*memory)[addr] = val; }
+    std::uint8_t in(const std::uint8_t port) const { return job->in ? job->in(*machine, port) : 0U; }
+
+    void out(const std::uint8_t port, const std::uint8_t val) const
+    {
+        if (job->out)
+            job->out(*machine, port, val);
+    }
+
+    Intel8080Batch::Memory* memory {nullptr};
+    const Intel8080Batch::Job* job {nullptr};
+    Intel8080Batch::Machine* machine {nullptr};
+};
+
+// a processor and its memory, reused for one job after another
+class Worker {
+public:
+    Intel8080Batch::Result run(const Intel8080Batch::Job& job)
+    {
+        Intel8080Batch::Memory& memory {*memory_};
+        memory.fill(0U);
+        const std::size_t size {std::min(job.image.size(), memory.size() - job.loadAddress)};
+        std::copy_n(job.image.begin(), size, memory.begin() + job.loadAddress);
+        for (const auto& [addr, val] : job.patches)
+            memory[addr] = val;
+
+        // the processor as it comes out of power-on for every job, so nothing is left over from the one before
+        cpu_.loadState(Intel8080 {}.saveState());
+        cpu_.pc = job.entry;
+        Intel8080Batch::Machine machine {cpu_, memory};
+        cpu_.bus = {&memory, &job, &machine};
+
+        Intel8080Batch::Result result {};
+        while (true) {
+            if (result.cycles >= job.cycleBudget) {
+                result.exit = Intel8080Batch::Exit::budget;
+                break;
+            }
+            result.cycles += cpu_.step();
+            ++result.instructions;
+            if (!machine.running) {
+                result.exit = Intel8080Batch::Exit::stopped;
+                break;
+            }
+            if (cpu_.ir == 0x76U) {
+                result.exit = Intel8080Batch::Exit::halted;
+                break;
+            }
+        }
+        result.output = std::move(machine.output);
+        return result;
+    }
+private:
+    std::unique_ptr<Intel8080Batch::Memory> memory_ {std::make_unique<Intel8080Batch::Memory>()};
+    Intel8080Core<Bus> cpu_ {};
+};
+
+// jobs waiting for one thread, which takes them from the back while other threads steal from the front
+struct alignas(64) Queue {
+    std::mutex mutex;
+    std::deque<std::size_t> jobs;
+};
+
+bool take(std::vector<Queue>& queues, const std::size_t self, std::size_t& job)
+{
+    for (std::size_t i {0}; i < queues.size(); ++i) {
+        Queue& queue {queues[(self + i) % queues.size()]};
+        const std::scoped_lock lock {queue.mutex};
+        if (queue.jobs.empty())
+            continue;
+        if (i == 0) {
+            job = queue.jobs.back();
+            queue.jobs.pop_back();
+        } else {
+            job = queue.jobs.front();
+            queue.jobs.pop_front();
+        }
+        return true;
+    }
+    // nothing ever gets added once the jobs are dealt out, so there is nothing left to do
+    return false;
+}
+
+} // namespace
+
+Intel8080Batch::Intel8080Batch(const unsigned threads)
+    : threads_ {threads != 0 ? threads : std::max(1U, std::thread::hardware_concurrency())} {}
+
+std::vector<Intel8080Batch::Result> Intel8080Batch::run(const std::vector<Job>& jobs) const
+{
+    std::vector<Result> results(jobs.size());
+    const std::size_t threads {std::min<std::size_t>(threads_, jobs.size())};
+    if (threads == 0)
+        return results;
+
+    std::vector<Queue> queues(threads);
+    for (std::size_t i {0}; i < jobs.size(); ++i)
+        queues[i % threads].jobs.push_back(i);
+
+    std::mutex errorMutex {};
+    std::exception_ptr error {};
+    const auto work {[&](const std::size_t self) {
+        Worker worker {};
+        for (std::size_t job {0}; take(queues, self, job);) {
+            try {
+                results[job] = worker.run(jobs[job]);
+            } catch (...) {
+                const std::scoped_lock lock {errorMutex};
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    }};
+
+    {
+        // the calling thread is one of the workers
+        std::vector<std::jthread> pool {};
+        for (std::size_t i {1}; i < threads; ++i)
+            pool.emplace_back(work, i);
+        work(0);
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+    return results;
+}
+
+Intel8080Batch::Result Intel8080Batch::run(const Job& job)
+{
+    return Worker {}.run(job);
+}
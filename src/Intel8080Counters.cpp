@@ -0,0 +1,31 @@
+#include "../include/Intel8080Counters.h"
+#include "../include/Intel8080.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include <string_view>
+
+std::string Intel8080Counters::report(const std::size_t top) const
+{
+    std::array<int, 256> order {};
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](const int a, const int b) { return states[a] > states[b]; });
+    const std::uint64_t total {std::accumulate(states.begin(), states.end(), std::uint64_t {0})};
+
+    std::ostringstream out {};
+    out << "opcode  instruction         executed          states   share\n";
+    for (std::size_t i {0}; i < std::min<std::size_t>(top, order.size()) and executed[order[i]] + states[order[i]] != 0; ++i) {
+        const int opcode {order[i]};
+        const std::string_view mnemonic {Intel8080::instructions_[Intel8080::opcode_[opcode]].mnemonic};
+        out << "    " << std::hex << std::uppercase << std::setw(2) << std::setfill('0') << opcode << std::dec
+            << std::setfill(' ') << "  " << std::left << std::setw(12) << mnemonic << std::right
+            << std::setw(16) << executed[opcode] << std::setw(16) << states[opcode] << std::setw(7) << std::fixed
+            << std::setprecision(2) << (total == 0 ? 0.0 : 100.0 * states[opcode] / total) << "%\n";
+    }
+    out << "total states: " << total << ", of which waiting: " << waitStates << '\n'
+        << "conditional jumps, calls and returns: " << taken << " taken, " << notTaken << " not taken\n"
+        << "interrupts acknowledged: " << interrupts << '\n';
+    return out.str();
+}
@@ -0,0 +1,919 @@
+#include "../include/Intel8080Jit.h"
+
+#include <cstddef>
+#include <vector>
+
+#if defined(__x86_64__) or defined(_M_X64)
+#define INTEL8080_JIT_X64 1
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+#ifdef INTEL8080_JIT_X64
+namespace {
+
+// x86-64 general purpose registers
+enum Reg : int { rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi, r8, r9, r10, r11, r12, r13, r14, r15 };
+
+// what the translated code keeps in which register for the whole block
+constexpr Reg state {r13};
+constexpr Reg memory {r12};
+constexpr Reg code {r15};
+constexpr Reg generation {rbx};
+constexpr Reg mmio {r14};
+constexpr Reg dirty {r10};   // non-zero once the block wrote to code
+constexpr Reg table {r11};
+
+// condition codes (the low nibble of jcc)
+enum : std::uint8_t { je = 0x4, jne = 0x5 };
+
+// [base + index * (1 << scale) + disp]
+struct Mem {
+    int base;
+    int index {-1};
+    int scale {0};
+    std::int32_t disp {0};
+};
+
+// just the instructions the translator needs, in the encodings it needs them
+class Assembler {
+public:
+    explicit Assembler(std::uint8_t* at) : begin_ {at}, at_ {at} {}
+
+    [[nodiscard]] std::uint8_t* begin() const { return begin_; }
+    [[nodiscard]] std::size_t size() const { return at_ - begin_; }
+
+    // movzx r32, byte [m]
+    void load8(const Reg r, const Mem m) { op_(false, r, m, {0x0F, 0xB6}); }
+    // movzx r32, word [m]
+    void load16(const Reg r, const Mem m) { op_(false, r, m, {0x0F, 0xB7}); }
+    // mov r64, [m]
+    void load64(const Reg r, const Mem m) { op_(true, r, m, {0x8B}); }
+    // mov byte [m], r8 (only al, cl, dl, bl and r8b-r15b)
+    void store8(const Mem m, const Reg r) { op_(false, r, m, {0x88}); }
+    // mov word [m], r16
+    void store16(const Mem m, const Reg r) { byte_(0x66); op_(false, r, m, {0x89}); }
+    // mov byte [m], imm8
+    void store8(const Mem m, const std::uint8_t imm) { op_(false, 0, m, {0xC6}); byte_(imm); }
+    // mov word [m], imm16
+    void store16(const Mem m, const std::uint16_t imm)
+    {
+        byte_(0x66);
+        op_(false, 0, m, {0xC7});
+        byte_(imm);
+        byte_(imm >> 8U);
+    }
+    // mov r32, imm32
+    void mov(const Reg r, const std::uint32_t imm)
+    {
+        rex_(false, 0, -1, r);
+        byte_(0xB8 + (r & 7));
+        dword_(imm);
+    }
+    // mov r64, imm64
+    void mov64(const Reg r, const void* imm)
+    {
+        rex_(true, 0, -1, r);
+        byte_(0xB8 + (r & 7));
+        const auto val {reinterpret_cast<std::uintptr_t>(imm)};
+        dword_(val);
+        dword_(val >> 32U);
+    }
+    // mov r32, r32 and mov r64, r64
+    void movr(const Reg dst, const Reg src) { rr_(0x89, dst, src); }
+    void movq(const Reg dst, const Reg src)
+    {
+        rex_(true, src, -1, dst);
+        byte_(0x89);
+        byte_(0xC0 | (src & 7) << 3 | (dst & 7));
+    }
+    // op r32, r32 (add, or, and, sub, xor)
+    void add(const Reg dst, const Reg src) { rr_(0x01, dst, src); }
+    void or_(const Reg dst, const Reg src) { rr_(0x09, dst, src); }
+    void and_(const Reg dst, const Reg src) { rr_(0x21, dst, src); }
+    void sub(const Reg dst, const Reg src) { rr_(0x29, dst, src); }
+    void xor_(const Reg dst, const Reg src) { rr_(0x31, dst, src); }
+    void test(const Reg dst, const Reg src) { rr_(0x85, dst, src); }
+    // op r32, imm32
+    void add(const Reg r, const std::uint32_t imm) { ri_(0, r, imm); }
+    void or_(const Reg r, const std::uint32_t imm) { ri_(1, r, imm); }
+    void and_(const Reg r, const std::uint32_t imm) { ri_(4, r, imm); }
+    void sub(const Reg r, const std::uint32_t imm) { ri_(5, r, imm); }
+    void xor_(const Reg r, const std::uint32_t imm) { ri_(6, r, imm); }
+    // shl/shr r32, imm8
+    void shl(const Reg r, const std::uint8_t imm) { shift_(4, r, imm); }
+    void shr(const Reg r, const std::uint8_t imm) { shift_(5, r, imm); }
+    // op byte [m], imm8 (or, xor, cmp)
+    void or8(const Mem m, const std::uint8_t imm) { op_(false, 1, m, {0x80}); byte_(imm); }
+    void xor8(const Mem m, const std::uint8_t imm) { op_(false, 6, m, {0x80}); byte_(imm); }
+    void cmp8(const Mem m, const std::uint8_t imm) { op_(false, 7, m, {0x80}); byte_(imm); }
+    // test byte [m], imm8
+    void test8(const Mem m, const std::uint8_t imm) { op_(false, 0, m, {0xF6}); byte_(imm); }
+    // add word [m], imm8 (sign extended)
+    void add16(const Mem m, const std::int8_t imm) { byte_(0x66); op_(false, 0, m, {0x83}); byte_(imm); }
+    // inc qword [m]
+    void inc64(const Mem m) { op_(true, 0, m, {0xFF}); }
+    void push(const Reg r) { rex_(false, 0, -1, r); byte_(0x50 + (r & 7)); }
+    void pop(const Reg r) { rex_(false, 0, -1, r); byte_(0x58 + (r & 7)); }
+    void ret() { byte_(0xC3); }
+
+    // jcc/jmp rel32 to somewhere not known yet, returns what to give bind()
+    std::uint8_t* jcc(const std::uint8_t cc) { byte_(0x0F); byte_(0x80 | cc); dword_(0); return at_; }
+    std::uint8_t* jmp() { byte_(0xE9); dword_(0); return at_; }
+    // points the jump at the current position
+    void bind(std::uint8_t* jump) const { bind(jump, at_); }
+    static void bind(std::uint8_t* jump, const std::uint8_t* target)
+    {
+        const auto rel {static_cast<std::uint32_t>(target - jump)};
+        for (int i {0}; i < 4; ++i)
+            jump[i - 4] = rel >> (8 * i);
+    }
+private:
+    void byte_(const std::uint8_t val) { *at_++ = val; }
+    void dword_(const std::uint32_t val) { for (int i {0}; i < 4; ++i) byte_(val >> (8 * i)); }
+
+    void rex_(const bool w, const int reg, const int index, const int base)
+    {
+        const std::uint8_t rex = (w ? 8 : 0) | (reg & 8 ? 4 : 0) | (index >= 0 and index & 8 ? 2 : 0) | (base & 8 ? 1 : 0);
+        if (rex)
+            byte_(0x40 | rex);
+    }
+
+    void op_(const bool w, const int reg, const Mem m, const std::initializer_list<std::uint8_t> opcode)
+    {
+        rex_(w, reg, m.index, m.base);
+        for (const std::uint8_t b : opcode)
+            byte_(b);
+
+        const int rm {m.base & 7};
+        const bool sib {m.index >= 0 or rm == 4};
+        const int mod {m.disp == 0 and rm != 5 ? 0 : (m.disp >= -128 and m.disp < 128 ? 1 : 2)};
+        byte_(mod << 6 | (reg & 7) << 3 | (sib ? 4 : rm));
+        if (sib)
+            byte_(m.scale << 6 | ((m.index >= 0 ? m.index : 4) & 7) << 3 | rm);
+        if (mod == 1)
+            byte_(m.disp);
+        else if (mod == 2)
+            dword_(m.disp);
+    }
+
+    void rr_(const std::uint8_t opcode, const int dst, const int src)
+    {
+        rex_(false, src, -1, dst);
+        byte_(opcode);
+        byte_(0xC0 | (src & 7) << 3 | (dst & 7));
+    }
+
+    void ri_(const int ext, const int r, const std::uint32_t imm)
+    {
+        rex_(false, 0, -1, r);
+        byte_(0x81);
+        byte_(0xC0 | ext << 3 | (r & 7));
+        dword_(imm);
+    }
+
+    void shift_(const int ext, const int r, const std::uint8_t imm)
+    {
+        rex_(false, 0, -1, r);
+        byte_(0xC1);
+        byte_(0xC0 | ext << 3 | (r & 7));
+        byte_(imm);
+    }
+
+    std::uint8_t* begin_;
+    std::uint8_t* at_;
+};
+
+using State = Intel8080Translator::State;
+
+// where each part of the state is, relative to the state register
+Mem field(const std::size_t offset) { return {state, -1, 0, static_cast<std::int32_t>(offset)}; }
+const Mem A {field(offsetof(State, a))};
+const Mem F {field(offsetof(State, f))};
+const Mem PC {field(offsetof(State, pc))};
+const Mem IR {field(offsetof(State, ir))};
+const Mem INTERPRET {field(offsetof(State, interpret))};
+Mem pair(const int rp) { return field(offsetof(State, pair) + 2 * rp); }
+
+// the 8-bit register an opcode field refers to (not M)
+Mem reg(const int r)
+{
+    constexpr int offset[8] {1, 0, 3, 2, 5, 4, -1, -1}; // B, C, D, E, H, L, M, A
+    return r == 7 ? A : field(offsetof(State, pair) + offset[r]);
+}
+
+constexpr std::uint8_t carryBit {0b00000001U};
+constexpr std::uint8_t auxiliaryBit {0b00010000U};
+
+// the flag tables of Intel8080, which only Intel8080Translator can get at
+struct Tables {
+    const std::uint8_t* zsp;
+    const std::uint8_t* inr;
+    const std::uint8_t* dcr;
+    const std::uint16_t* daa;
+};
+
+// code generation shared by several instructions, and the bookkeeping for leaving the block
+class Translation {
+public:
+    Translation(Assembler& as, const Tables& tables, const bool checkMmio)
+        : as_ {as}, tables_ {tables}, checkMmio_ {checkMmio} {}
+
+    // leaves the block through the epilogue
+    void exit(const std::uint16_t pc, const std::uint8_t ir, const unsigned states)
+    {
+        as_.store16(PC, pc);
+        as_.store8(IR, ir);
+        as_.mov(rax, states);
+        epilogue_.push_back(as_.jmp());
+    }
+
+    // same, for a pc that is in ecx
+    void exitTo(const std::uint8_t ir, const unsigned states)
+    {
+        as_.store16(PC, rcx);
+        as_.store8(IR, ir);
+        as_.mov(rax, states);
+        epilogue_.push_back(as_.jmp());
+    }
+
+    // leaves the block in front of the current instruction if the address in r is on an MMIO page
+    void checkMmio(const Reg r)
+    {
+        if (!checkMmio_)
+            return;
+        as_.movr(r9, r);
+        as_.shr(r9, 8);
+        as_.cmp8({mmio, r9}, 0);
+        interpret_.push_back(as_.jcc(jne));
+    }
+
+    // reads the byte at the address in addr into r
+    void read(const Reg r, const Reg addr) { as_.load8(r, {memory, addr}); }
+
+    // writes the byte in r to the address in addr, and bumps the page's generation if it has been decoded as code
+    void write(const Reg addr, const Reg r)
+    {
+        as_.store8({memory, addr}, r);
+        as_.cmp8({code, addr}, 0);
+        std::uint8_t* data {as_.jcc(je)};
+        as_.movr(r9, addr);
+        as_.shr(r9, 8);
+        as_.inc64({generation, r9, 3});
+        as_.mov(dirty, 1);
+        as_.bind(data);
+        wrote_ = true;
+    }
+
+    // the address (sp + offset) & 0xFFFF in r
+    void stack(const Reg r, const int offset)
+    {
+        as_.load16(r, pair(3));
+        if (offset)
+            as_.add(r, static_cast<std::uint32_t>(offset));
+        as_.and_(r, 0xFFFFU);
+    }
+
+    // pushes the word in r (pushing the pc onto the stack)
+    void push(const Reg r)
+    {
+        stack(rcx, -1);
+        stack(rdx, -2);
+        checkMmio(rcx);
+        checkMmio(rdx);
+        as_.movr(r8, r);
+        as_.shr(r8, 8);
+        write(rcx, r8);
+        write(rdx, r);
+        as_.store16(pair(3), rdx);
+    }
+
+    // pops a word into ecx
+    void pop()
+    {
+        stack(rdx, 0);
+        stack(r8, 1);
+        checkMmio(rdx);
+        checkMmio(r8);
+        read(rcx, rdx);
+        read(rax, r8);
+        as_.shl(rax, 8);
+        as_.or_(rcx, rax);
+        as_.store16(pair(3), r8);
+        as_.add16(pair(3), 1);
+    }
+
+    // jumps to the returned position unless the condition of a J/C/R cond opcode is true
+    std::uint8_t* unless(const std::uint8_t opcode)
+    {
+        constexpr std::uint8_t mask[4] {0b01000000U, 0b00000001U, 0b00000100U, 0b10000000U}; // Z, CY, P, S
+        as_.test8(F, mask[opcode >> 4U & 3U]);
+        // odd conditions are true when the flag is set
+        return as_.jcc(opcode >> 3U & 1U ? je : jne);
+    }
+
+    // r = the operand of an ALU instruction, form 0 is a register, 1 is M and 2 is immediate data
+    void operand(const Reg r, const Intel8080Translator::Instruction& in, const int form)
+    {
+        if (form == 0) {
+            as_.load8(r, reg(in.opcode & 7U));
+        } else if (form == 1) {
+            as_.load16(rcx, pair(2));
+            checkMmio(rcx);
+            read(r, rcx);
+        } else {
+            as_.mov(r, in.data & 0xFFU);
+        }
+    }
+
+    // F = zsp[res & 0xFF] | ac | cy | 0b10, where ac and cy are already in ecx, and res in eax
+    void zsp(const Reg flags)
+    {
+        as_.movr(r8, rax);
+        as_.and_(r8, 0xFFU);
+        as_.mov64(table, tables_.zsp);
+        as_.load8(r8, {table, r8});
+        as_.or_(flags, r8);
+        as_.or_(flags, 0b10U);
+        as_.store8(F, flags);
+    }
+
+    // add_/adc_ with the operand in edx
+    void add(const bool carry)
+    {
+        as_.load8(rax, A);
+        as_.movr(rcx, rax);
+        as_.add(rax, rdx);
+        if (carry) {
+            as_.load8(r8, F);
+            as_.and_(r8, carryBit);
+            as_.add(rax, r8);
+        }
+        as_.xor_(rcx, rdx);
+        as_.xor_(rcx, rax);
+        as_.and_(rcx, auxiliaryBit);
+        as_.movr(r8, rax);
+        as_.shr(r8, 8);
+        as_.or_(rcx, r8);
+        zsp(rcx);
+        as_.store8(A, rax);
+    }
+
+    // sub_/sbb_/cmp_ with the operand in edx
+    void sub(const bool carry, const bool store)
+    {
+        as_.load8(rax, A);
+        as_.movr(rcx, rax);
+        as_.sub(rax, rdx);
+        if (carry) {
+            as_.load8(r8, F);
+            as_.and_(r8, carryBit);
+            as_.sub(rax, r8);
+        }
+        as_.xor_(rcx, rdx);
+        as_.xor_(rcx, rax);
+        as_.and_(rcx, auxiliaryBit);
+        as_.xor_(rcx, auxiliaryBit);
+        as_.movr(r8, rax);
+        as_.shr(r8, 8);
+        as_.and_(r8, carryBit);
+        as_.or_(rcx, r8);
+        zsp(rcx);
+        if (store)
+            as_.store8(A, rax);
+    }
+
+    // ana_/xra_/ora_ with the operand in edx
+    void logic(const int kind)
+    {
+        as_.load8(rax, A);
+        as_.mov(rcx, 0);
+        if (kind == 0) {
+            as_.movr(rcx, rax);
+            as_.or_(rcx, rdx);
+            as_.and_(rcx, 0b1000U);
+            as_.shl(rcx, 1);
+            as_.and_(rax, rdx);
+        } else if (kind == 1) {
+            as_.xor_(rax, rdx);
+        } else {
+            as_.or_(rax, rdx);
+        }
+        zsp(rcx);
+        as_.store8(A, rax);
+    }
+
+    // inr_/dcr_ of the byte in eax, leaves ecx alone
+    void incDec(const bool dec)
+    {
+        if (dec)
+            as_.sub(rax, 1);
+        else
+            as_.add(rax, 1);
+        as_.and_(rax, 0xFFU);
+        as_.mov64(table, dec ? tables_.dcr : tables_.inr);
+        as_.load8(r8, {table, rax});
+        as_.load8(rdx, F);
+        as_.and_(rdx, carryBit);
+        as_.or_(r8, rdx);
+        as_.store8(F, r8);
+    }
+
+    // f_ = (f_ & ~carryBit) | carry, where carry is in r
+    void setCarry(const Reg r)
+    {
+        as_.load8(rdx, F);
+        as_.and_(rdx, static_cast<std::uint8_t>(~carryBit));
+        as_.or_(rdx, r);
+        as_.store8(F, rdx);
+    }
+
+    // starts a new instruction, side exits in front of it use these
+    void begin(const std::uint16_t pc, const unsigned states)
+    {
+        flushInterpret_();
+        pc_ = pc;
+        states_ = states;
+        wrote_ = false;
+    }
+
+    // leaves the block after the current instruction if it wrote to code
+    void end(const std::uint16_t next, const std::uint8_t ir, const unsigned states)
+    {
+        if (!wrote_)
+            return;
+        as_.test(dirty, dirty);
+        dirty_.push_back({as_.jcc(jne), next, ir, states});
+    }
+
+    // side exits are emitted after the block, followed by the epilogue
+    void finish()
+    {
+        flushInterpret_();
+        for (const auto& exit : dirty_) {
+            as_.bind(exit.jump);
+            this->exit(exit.pc, exit.ir, exit.states);
+        }
+        for (const auto& exit : interpretAt_) {
+            for (std::uint8_t* jump : exit.jumps)
+                as_.bind(jump);
+            as_.store8(INTERPRET, 1);
+            as_.store16(PC, exit.pc);
+            as_.mov(rax, exit.states);
+            epilogue_.push_back(as_.jmp());
+        }
+        for (std::uint8_t* jump : epilogue_)
+            as_.bind(jump);
+        for (const Reg r : {r15, r14, r13, r12, rbx})
+            as_.pop(r);
+        as_.ret();
+    }
+
+private:
+    struct Exit {
+        std::uint8_t* jump;
+        std::uint16_t pc;
+        std::uint8_t ir;
+        unsigned states;
+    };
+
+    struct Interpret {
+        std::vector<std::uint8_t*> jumps;
+        std::uint16_t pc;
+        unsigned states;
+    };
+
+    void flushInterpret_()
+    {
+        if (!interpret_.empty())
+            interpretAt_.push_back({interpret_, pc_, states_});
+        interpret_.clear();
+    }
+
+    Assembler& as_;
+    const Tables& tables_;
+    bool checkMmio_;
+    bool wrote_ {false};
+    std::uint16_t pc_ {0};
+    unsigned states_ {0};
+    std::vector<std::uint8_t*> epilogue_ {};
+    std::vector<std::uint8_t*> interpret_ {};
+    std::vector<Interpret> interpretAt_ {};
+    std::vector<Exit> dirty_ {};
+};
+
+} // namespace
+#endif
+
+Intel8080Translator::~Intel8080Translator()
+{
+#ifdef INTEL8080_JIT_X64
+    if (buffer_) {
+#ifdef _WIN32
+        VirtualFree(buffer_, 0, MEM_RELEASE);
+#else
+        munmap(buffer_, capacity_);
+#endif
+    }
+#endif
+}
+
+Intel8080Translator& Intel8080Translator::operator=(const Intel8080Translator&)
+{
+    clear();
+    return *this;
+}
+
+bool Intel8080Translator::available()
+{
+#ifdef INTEL8080_JIT_X64
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Intel8080Translator::clear()
+{
+    used_ = 0;
+    ++epoch_;
+}
+
+Intel8080Translator::Code Intel8080Translator::translate(const Instruction* code, const int size, const bool mmio, unsigned& budget)
+{
+#ifdef INTEL8080_JIT_X64
+    // more than a block of maxInstructions can ever take
+    constexpr std::size_t maxSize {1U << 14U};
+
+    if (!buffer_) {
+#ifdef _WIN32
+        buffer_ = static_cast<std::uint8_t*>(VirtualAlloc(nullptr, capacity_, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE));
+#else
+        void* buffer {mmap(nullptr, capacity_, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+        buffer_ = buffer == MAP_FAILED ? nullptr : static_cast<std::uint8_t*>(buffer);
+#endif
+        if (!buffer_)
+            return nullptr;
+    }
+    if (capacity_ - used_ < maxSize)
+        clear();
+
+    static constexpr Tables tables {Intel8080::zspTable_.data(), Intel8080::inrTable_.data(), Intel8080::dcrTable_.data(),
+                                    Intel8080::daaTable_.data()};
+    Assembler as {buffer_ + used_};
+    Translation t {as, tables, mmio};
+
+    for (const Reg r : {rbx, r12, r13, r14, r15})
+        as.push(r);
+#ifdef _WIN32
+    as.movq(state, rcx);
+#else
+    as.movq(state, rdi);
+#endif
+    as.load64(memory, field(offsetof(State, memory)));
+    as.load64(::code, field(offsetof(State, code)));
+    as.load64(generation, field(offsetof(State, generation)));
+    as.load64(::mmio, field(offsetof(State, mmio)));
+    as.mov(dirty, 0);
+
+    unsigned states {0};
+    bool left {false};
+    int i {0};
+    for (; i < size and !left; ++i) {
+        const Instruction& in {code[i]};
+        const int instruction {Intel8080::opcode_[in.opcode]};
+        // IN, OUT, EI, DI and HLT are left to the interpreter
+        if (instruction >= Intel8080::index_("IN port") and instruction <= Intel8080::index_("HLT"))
+            break;
+
+        const std::uint8_t op {in.opcode};
+        const int dst {op >> 3U & 7}, src {op & 7}, rp {op >> 4U & 3};
+        const auto next {static_cast<std::uint16_t>(in.pc + Intel8080::length_[instruction])};
+        const auto data1 {static_cast<std::uint16_t>(in.data + 1)};
+        unsigned after {states + Intel8080::cycles_[instruction]};
+        std::uint8_t* skip {nullptr};
+
+        budget = states;
+        t.begin(in.pc, states);
+        switch (instruction) {
+            case Intel8080::index_("MOV r1, r2"):
+                as.load8(rax, reg(src));
+                as.store8(reg(dst), rax);
+                break;
+            case Intel8080::index_("MOV r, M"):
+                as.load16(rcx, pair(Intel8080::HL));
+                t.checkMmio(rcx);
+                t.read(rax, rcx);
+                as.store8(reg(dst), rax);
+                break;
+            case Intel8080::index_("MOV M, r"):
+                as.load16(rcx, pair(Intel8080::HL));
+                t.checkMmio(rcx);
+                as.load8(rax, reg(src));
+                t.write(rcx, rax);
+                break;
+            case Intel8080::index_("SPHL"):
+                as.load16(rax, pair(Intel8080::HL));
+                as.store16(pair(Intel8080::SP), rax);
+                break;
+            case Intel8080::index_("MVI r, data"): as.store8(reg(dst), static_cast<std::uint8_t>(in.data)); break;
+            case Intel8080::index_("MVI M, data"):
+                as.load16(rcx, pair(Intel8080::HL));
+                t.checkMmio(rcx);
+                as.mov(rax, in.data);
+                t.write(rcx, rax);
+                break;
+            case Intel8080::index_("LXI rp, data"): as.store16(pair(rp), in.data); break;
+            case Intel8080::index_("LDA addr"):
+                as.mov(rcx, in.data);
+                t.checkMmio(rcx);
+                as.store16(pair(Intel8080::WZ), in.data);
+                t.read(rax, rcx);
+                as.store8(A, rax);
+                break;
+            case Intel8080::index_("STA addr"):
+                as.mov(rcx, in.data);
+                t.checkMmio(rcx);
+                as.store16(pair(Intel8080::WZ), in.data);
+                as.load8(rax, A);
+                t.write(rcx, rax);
+                break;
+            case Intel8080::index_("LHLD addr"):
+                as.mov(rcx, in.data);
+                as.mov(rdx, data1);
+                t.checkMmio(rcx);
+                t.checkMmio(rdx);
+                as.store16(pair(Intel8080::WZ), data1);
+                t.read(rax, rcx);
+                as.store8(reg(Intel8080::L), rax);
+                t.read(rax, rdx);
+                as.store8(reg(Intel8080::H), rax);
+                break;
+            case Intel8080::index_("SHLD addr"):
+                as.mov(rcx, in.data);
+                as.mov(rdx, data1);
+                t.checkMmio(rcx);
+                t.checkMmio(rdx);
+                as.store16(pair(Intel8080::WZ), data1);
+                as.load8(rax, reg(Intel8080::L));
+                t.write(rcx, rax);
+                as.load8(rax, reg(Intel8080::H));
+                t.write(rdx, rax);
+                break;
+            case Intel8080::index_("LDAX rp"):
+                as.load16(rcx, pair(rp));
+                t.checkMmio(rcx);
+                t.read(rax, rcx);
+                as.store8(A, rax);
+                break;
+            case Intel8080::index_("STAX rp"):
+                as.load16(rcx, pair(rp));
+                t.checkMmio(rcx);
+                as.load8(rax, A);
+                t.write(rcx, rax);
+                break;
+            case Intel8080::index_("XCHG"):
+                as.load16(rax, pair(Intel8080::HL));
+                as.load16(rcx, pair(Intel8080::DE));
+                as.store16(pair(Intel8080::HL), rcx);
+                as.store16(pair(Intel8080::DE), rax);
+                break;
+            // ADD, ADC, SUB and SBB with r, M or data
+            case Intel8080::index_("ADD r"): case Intel8080::index_("ADD M"): case Intel8080::index_("ADI data"):
+            case Intel8080::index_("ADC r"): case Intel8080::index_("ADC M"): case Intel8080::index_("ACI data"):
+            case Intel8080::index_("SUB r"): case Intel8080::index_("SUB M"): case Intel8080::index_("SUI data"):
+            case Intel8080::index_("SBB r"): case Intel8080::index_("SBB M"): case Intel8080::index_("SBI data"):
+                t.operand(rdx, in, (instruction - Intel8080::index_("ADD r")) % 3);
+                if (instruction < Intel8080::index_("SUB r"))
+                    t.add(instruction >= Intel8080::index_("ADC r"));
+                else
+                    t.sub(instruction >= Intel8080::index_("SBB r"), true);
+                break;
+            // INR r, INR M, DCR r, DCR M
+            case Intel8080::index_("INR r"): case Intel8080::index_("DCR r"):
+                as.load8(rax, reg(dst));
+                t.incDec(instruction == Intel8080::index_("DCR r"));
+                as.store8(reg(dst), rax);
+                break;
+            case Intel8080::index_("INR M"): case Intel8080::index_("DCR M"):
+                as.load16(rcx, pair(Intel8080::HL));
+                t.checkMmio(rcx);
+                t.read(rax, rcx);
+                t.incDec(instruction == Intel8080::index_("DCR M"));
+                t.write(rcx, rax);
+                break;
+            // INX rp, DCX rp, DAD rp
+            case Intel8080::index_("INX rp"): as.add16(pair(rp), 1); break;
+            case Intel8080::index_("DCX rp"): as.add16(pair(rp), -1); break;
+            case Intel8080::index_("DAD rp"):
+                as.load16(rax, pair(Intel8080::HL));
+                as.load16(rcx, pair(rp));
+                as.add(rax, rcx);
+                as.store16(pair(Intel8080::HL), rax);
+                as.shr(rax, 16);
+                t.setCarry(rax);
+                break;
+            case Intel8080::index_("DAA"):
+                as.load8(rcx, F);
+                as.movr(rax, rcx);
+                as.and_(rax, carryBit);
+                as.shl(rax, 9);
+                as.and_(rcx, auxiliaryBit);
+                as.shl(rcx, 4);
+                as.or_(rax, rcx);
+                as.load8(rcx, A);
+                as.or_(rax, rcx);
+                as.mov64(table, tables.daa);
+                as.load16(rax, {table, rax, 1});
+                as.store8(F, rax);
+                as.shr(rax, 8);
+                as.store8(A, rax);
+                break;
+            // ANA, XRA, ORA and CMP with r, M or data
+            case Intel8080::index_("ANA r"): case Intel8080::index_("ANA M"): case Intel8080::index_("ANI data"):
+            case Intel8080::index_("XRA r"): case Intel8080::index_("XRA M"): case Intel8080::index_("XRI data"):
+            case Intel8080::index_("ORA r"): case Intel8080::index_("ORA M"): case Intel8080::index_("ORI data"):
+            case Intel8080::index_("CMP r"): case Intel8080::index_("CMP M"): case Intel8080::index_("CPI data"):
+                t.operand(rdx, in, (instruction - Intel8080::index_("ANA r")) % 3);
+                if (instruction >= Intel8080::index_("CMP r"))
+                    t.sub(false, false);
+                else
+                    t.logic((instruction - Intel8080::index_("ANA r")) / 3);
+                break;
+            // RLC, RRC, RAL, RAR
+            case Intel8080::index_("RLC"):
+                as.load8(rax, A);
+                as.movr(rcx, rax);
+                as.shr(rcx, 7);
+                t.setCarry(rcx);
+                as.add(rax, rax);
+                as.or_(rax, rcx);
+                as.store8(A, rax);
+                break;
+            case Intel8080::index_("RRC"):
+                as.load8(rax, A);
+                as.movr(rcx, rax);
+                as.and_(rcx, carryBit);
+                t.setCarry(rcx);
+                as.movr(r8, rax);
+                as.shl(r8, 7);
+                as.shr(rax, 1);
+                as.or_(rax, r8);
+                as.store8(A, rax);
+                break;
+            case Intel8080::index_("RAL"):
+                as.load8(rax, A);
+                as.load8(r8, F);
+                as.and_(r8, carryBit);
+                as.movr(rcx, rax);
+                as.shr(rcx, 7);
+                t.setCarry(rcx);
+                as.add(rax, rax);
+                as.or_(rax, r8);
+                as.store8(A, rax);
+                break;
+            case Intel8080::index_("RAR"):
+                as.load8(rax, A);
+                as.load8(r8, F);
+                as.and_(r8, carryBit);
+                as.shl(r8, 7);
+                as.movr(rcx, rax);
+                as.and_(rcx, carryBit);
+                t.setCarry(rcx);
+                as.shr(rax, 1);
+                as.or_(rax, r8);
+                as.store8(A, rax);
+                break;
+            // CMA, CMC, STC
+            case Intel8080::index_("CMA"): as.xor8(A, 0xFFU); break;
+            case Intel8080::index_("CMC"): as.xor8(F, carryBit); break;
+            case Intel8080::index_("STC"): as.or8(F, carryBit); break;
+            case Intel8080::index_("JMP addr"):
+                as.store16(pair(Intel8080::WZ), in.data);
+                t.exit(in.data, op, after);
+                left = true;
+                break;
+            case Intel8080::index_("J cond addr"):
+                as.store16(pair(Intel8080::WZ), in.data);
+                skip = t.unless(op);
+                t.exit(in.data, op, after);
+                as.bind(skip);
+                break;
+            case Intel8080::index_("CALL addr"):
+                as.store16(pair(Intel8080::WZ), in.data);
+                as.mov(rax, next);
+                t.push(rax);
+                t.exit(in.data, op, after);
+                left = true;
+                break;
+            case Intel8080::index_("C cond addr"):
+                as.store16(pair(Intel8080::WZ), in.data);
+                skip = t.unless(op);
+                as.mov(rax, next);
+                t.push(rax);
+                t.exit(in.data, op, after);
+                as.bind(skip);
+                after -= Intel8080::notTaken_;
+                break;
+            case Intel8080::index_("RET"):
+                t.pop();
+                as.store16(pair(Intel8080::WZ), rcx);
+                t.exitTo(op, after);
+                left = true;
+                break;
+            // R cond
+            case Intel8080::index_("R cond addr"):
+                skip = t.unless(op);
+                t.pop();
+                as.store16(pair(Intel8080::WZ), rcx);
+                t.exitTo(op, after);
+                as.bind(skip);
+                after -= Intel8080::notTaken_;
+                break;
+            case Intel8080::index_("RST n"):
+                as.mov(rax, next);
+                t.push(rax);
+                as.store16(pair(Intel8080::WZ), static_cast<std::uint16_t>(op & 0b111000U));
+                t.exit(op & 0b111000U, op, after);
+                left = true;
+                break;
+            case Intel8080::index_("PCHL"):
+                as.load16(rcx, pair(Intel8080::HL));
+                t.exitTo(op, after);
+                left = true;
+                break;
+            // PUSH rp, PUSH PSW
+            case Intel8080::index_("PUSH rp"):
+                as.load16(rax, pair(rp));
+                t.push(rax);
+                break;
+            case Intel8080::index_("PUSH PSW"):
+                as.load8(rax, A);
+                as.shl(rax, 8);
+                as.load8(r9, F);
+                as.or_(rax, r9);
+                t.push(rax);
+                break;
+            // POP rp, POP PSW
+            case Intel8080::index_("POP rp"):
+                t.pop();
+                as.store16(pair(rp), rcx);
+                break;
+            case Intel8080::index_("POP PSW"):
+                t.pop();
+                as.movr(rax, rcx);
+                as.and_(rax, 0b11010111U); // bits 3 and 5 are always zero, bit 1 is always one
+                as.or_(rax, 0b10U);
+                as.store8(F, rax);
+                as.shr(rcx, 8);
+                as.store8(A, rcx);
+                break;
+            case Intel8080::index_("XTHL"):
+                t.stack(rcx, 0);
+                t.stack(rdx, 1);
+                t.checkMmio(rcx);
+                t.checkMmio(rdx);
+                t.read(rax, rcx);
+                t.read(r8, rdx);
+                as.shl(r8, 8);
+                as.or_(rax, r8);
+                as.store16(pair(Intel8080::WZ), rax);
+                as.load8(r8, reg(Intel8080::H));
+                t.write(rdx, r8);
+                as.load8(r8, reg(Intel8080::L));
+                t.write(rcx, r8);
+                as.store16(pair(Intel8080::HL), rax);
+                break;
+            // NOP
+            default: break;
+        }
+        if (!left)
+            t.end(next, op, after);
+        states = after;
+        if (!left and i + 1 == size)
+            t.exit(next, op, states);
+    }
+
+    if (i == 0)
+        return nullptr;
+    if (!left and i < size) {
+        // stopped in front of an instruction for the interpreter
+        const Instruction& last {code[i - 1]};
+        t.exit(code[i].pc, last.opcode, states);
+    }
+    t.finish();
+
+    const auto translated {reinterpret_cast<Code>(as.begin())};
+    used_ += as.size();
+    return translated;
+#else
+    (void)code;
+    (void)size;
+    (void)mmio;
+    (void)budget;
+    return nullptr;
+#endif
+}
@@ -0,0 +1,122 @@
+#include "../include/Intel8080Profiler.h"
+
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+std::size_t Intel8080Profiler::loadSymbols(std::istream& map)
+{
+    std::size_t loaded {0};
+    for (std::string line {}; std::getline(map, line);) {
+        std::istringstream fields {line};
+        std::string addr {}, name {};
+        if (!(fields >> addr >> name))
+            continue;
+        if (addr.starts_with("0x") or addr.starts_with("0X"))
+            addr.erase(0, 2);
+        if (addr.ends_with('h') or addr.ends_with('H'))
+            addr.pop_back();
+        if (addr.empty() or addr.size() > 4 or addr.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+            continue;
+        addSymbol(static_cast<std::uint16_t>(std::stoul(addr, nullptr, 16)), name);
+        ++loaded;
+    }
+    return loaded;
+}
+
+// the low byte of a return address is written last, at the new SP, and the first byte read back is at the old one
+void Intel8080Profiler::stackCycle_(const Intel8080& cpu)
+{
+    const int instruction {Intel8080::opcode_[cpu.ir]};
+    constexpr int call {Intel8080::index_("CALL addr")}, callIf {Intel8080::index_("C cond addr")};
+    constexpr int rst {Intel8080::index_("RST n")}, ret {Intel8080::index_("RET")};
+    constexpr int retIf {Intel8080::index_("R cond addr")}, pop {Intel8080::index_("POP rp")};
+    constexpr int popPsw {Intel8080::index_("POP PSW")};
+    const std::uint16_t slot {cpu.getABus()};
+    const auto drop {[this](const std::uint16_t top) {
+        while (!frames_.empty() and frames_.back().slot <= top)
+            frames_.pop_back();
+    }};
+    // CALL, C cond (when taken), RST and interrupts push the return address. RET and R cond (when taken) pop it, and
+    // so does POP when a routine throws its return address away
+    if (cpu.pins & Intel8080::WR) {
+        const bool pushed {instruction == call or instruction == callIf or instruction == rst};
+        if (pushed and slot == cpu.getPair(Intel8080::SP)) {
+            drop(slot);
+            // an interrupt puts the instruction the device answered the acknowledge with in ir, usually an RST
+            const std::uint16_t entry {instruction == rst ? static_cast<std::uint16_t>(cpu.ir & 0x38U)
+                                                          : cpu.getPair(Intel8080::WZ)};
+            frames_.push_back({entry, slot});
+        }
+    } else if (instruction == ret or instruction == retIf or instruction == pop or instruction == popPsw) {
+        drop(slot);
+    }
+}
+
+void Intel8080Profiler::look_(const Intel8080& cpu)
+{
+    // the status stays the same for the whole machine cycle, so the transfer tells a stack cycle apart from the stop at
+    // its SYNC
+    if (cpu.status & stack_) {
+        if (cpu.pins & (Intel8080::DBIN | Intel8080::WR))
+            stackCycle_(cpu);
+        return;
+    }
+
+    // pc has already moved past the instruction being fetched or the HLT. anywhere else the samples wait for the next
+    // fetch
+    std::uint16_t current {};
+    if (cpu.status == Intel8080::interruptAckWhileHalt)
+        current = cpu.getABus() - 1U;
+    else if (cpu.status & m1_ and cpu.pins & Intel8080::DBIN)
+        current = cpu.getABus();
+    else if (cpu.status == Intel8080::haltAck)
+        current = cpu.pc - 1U;
+    else
+        return;
+
+    if (!started_) {
+        started_ = true;
+        root_ = current;
+    }
+    if (due_ != 0) {
+        std::vector<std::uint16_t> stack {};
+        stack.reserve(frames_.size() + 1);
+        for (const Frame& frame : frames_)
+            stack.push_back(frame.entry);
+        stack.push_back(current);
+        stacks_[stack] += due_;
+        samples_ += due_;
+        due_ = 0;
+    }
+    watching_ = stack_;
+}
+
+std::string Intel8080Profiler::name_(const std::uint16_t addr) const
+{
+    const auto symbol {symbols_.upper_bound(addr)};
+    if (symbol != symbols_.begin())
+        return std::prev(symbol)->second;
+    std::ostringstream hex {};
+    hex << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << addr;
+    return hex.str();
+}
+
+void Intel8080Profiler::writeFolded(std::ostream& out) const
+{
+    // different stacks can have the same names, e.g. different addresses in the same routine
+    std::map<std::string, std::uint64_t> folded {};
+    for (const auto& [stack, count] : stacks_) {
+        std::string last {name_(root_)}, line {last};
+        for (std::size_t i {0}; i + 1 < stack.size(); ++i) {
+            last = name_(stack[i]);
+            line += ';' + last;
+        }
+        // the instruction is only worth a frame of its own when it says more than the routine it was called in
+        if (const std::string leaf {name_(stack.back())}; !symbols_.empty() and leaf != last)
+            line += ';' + leaf;
+        folded[line] += count;
+    }
+    for (const auto& [line, count] : folded)
+        out << line << ' ' << count << '\n';
+}
@@ -0,0 +1,402 @@
+#include "../include/Intel8080Trace.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const std::string mnemonics[256] {
+            "nop", "lxi b,#", "stax b", "inx b",
+            "inr_ b", "dcr_ b", "mvi b,#", "rlc", "ill", "dad b", "ldax b", "dcx b",
+            "inr_ c", "dcr_ c", "mvi c,#", "rrc", "ill", "lxi d,#", "stax d", "inx d",
+            "inr_ d", "dcr_ d", "mvi d,#", "ral", "ill", "dad d", "ldax d", "dcx d",
+            "inr_ e", "dcr_ e", "mvi e,#", "rar", "ill", "lxi h,#", "shld", "inx h",
+            "inr_ h", "dcr_ h", "mvi h,#", "daa", "ill", "dad h", "lhld", "dcx h",
+            "inr_ l", "dcr_ l", "mvi l,#", "cma", "ill", "lxi sp,#", "sta $", "inx sp",
+            "inr_ M", "dcr_ M", "mvi M,#", "stc", "ill", "dad sp", "lda $", "dcx sp",
+            "inr_ a", "dcr_ a", "mvi a,#", "cmc", "mov b,b", "mov b,c", "mov b,d",
+            "mov b,e", "mov b,h", "mov b,l", "mov b,M", "mov b,a", "mov c,b", "mov c,c",
+            "mov c,d", "mov c,e", "mov c,h", "mov c,l", "mov c,M", "mov c,a", "mov d,b",
+            "mov d,c", "mov d,d", "mov d,e", "mov d,h", "mov d,l", "mov d,M", "mov d,a",
+            "mov e,b", "mov e,c", "mov e,d", "mov e,e", "mov e,h", "mov e,l", "mov e,M",
+            "mov e,a", "mov h,b", "mov h,c", "mov h,d", "mov h,e", "mov h,h", "mov h,l",
+            "mov h,M", "mov h,a", "mov l,b", "mov l,c", "mov l,d", "mov l,e", "mov l,h",
+            "mov l,l", "mov l,M", "mov l,a", "mov M,b", "mov M,c", "mov M,d", "mov M,e",
+            "mov M,h", "mov M,l", "hlt", "mov M,a", "mov a,b", "mov a,c", "mov a,d",
+            "mov a,e", "mov a,h", "mov a,l", "mov a,M", "mov a,a", "add_ b", "add_ c",
+            "add_ d", "add_ e", "add_ h", "add_ l", "add_ M", "add_ a", "adc_ b", "adc_ c",
+            "adc_ d", "adc_ e", "adc_ h", "adc_ l", "adc_ M", "adc_ a", "sub_ b", "sub_ c",
+            "sub_ d", "sub_ e", "sub_ h", "sub_ l", "sub_ M", "sub_ a", "sbb_ b", "sbb_ c",
+            "sbb_ d", "sbb_ e", "sbb_ h", "sbb_ l", "sbb_ M", "sbb_ a", "ana_ b", "ana_ c",
+            "ana_ d", "ana_ e", "ana_ h", "ana_ l", "ana_ M", "ana_ a", "xra_ b", "xra_ c",
+            "xra_ d", "xra_ e", "xra_ h", "xra_ l", "xra_ M", "xra_ a", "ora_ b", "ora_ c",
+            "ora_ d", "ora_ e", "ora_ h", "ora_ l", "ora_ M", "ora_ a", "cmp_ b", "cmp_ c",
+            "cmp_ d", "cmp_ e", "cmp_ h", "cmp_ l", "cmp_ M", "cmp_ a", "rnz", "pop b",
+            "jnz $", "jmp $", "cnz $", "push b", "adi #", "rst 0", "rz", "ret", "jz $",
+            "ill", "cz $", "call $", "aci #", "rst 1", "rnc", "pop d", "jnc $", "out p",
+            "cnc $", "push d", "sui #", "rst 2", "rc", "ill", "jc $", "in p", "cc $",
+            "ill", "sbi #", "rst 3", "rpo", "pop h", "jpo $", "xthl", "cpo $", "push h",
+            "ani_ #", "rst 4", "rpe", "pchl", "jpe $", "xchg", "cpe $", "ill", "xri #",
+            "rst 5", "rp", "pop psw", "jp $", "di", "cp $", "push psw", "ori #",
+            "rst 6", "rm", "sphl", "jm $", "ei", "cm $", "ill", "cpi #", "rst 7"};
+
+    constexpr std::array<std::uint8_t, 8> magic {'8', '0', '8', '0', 'T', 'R', 'C', 0};
+    constexpr std::array<std::uint8_t, 8> indexMagic {'8', '0', '8', '0', 'I', 'D', 'X', 0};
+    // 1 had no gaps, and reads the same
+    constexpr std::uint32_t version {2};
+    constexpr std::size_t headerSize {16};
+
+    constexpr std::uint8_t keyframe {0x80};
+    constexpr std::uint8_t codeChanged {0x40};
+    constexpr std::uint8_t afterGap {0x40}; // with keyframe
+
+    void put(std::vector<std::uint8_t>& out, std::uint64_t val, const int bytes)
+    {
+        for (int i {0}; i < bytes; ++i, val >>= 8U)
+            out.push_back(static_cast<std::uint8_t>(val));
+    }
+
+    std::uint64_t get(const std::uint8_t* in, const int bytes)
+    {
+        std::uint64_t val {0};
+        for (int i {bytes - 1}; i >= 0; --i)
+            val = val << 8U | in[i];
+        return val;
+    }
+
+    void putLeb128(std::vector<std::uint8_t>& out, std::uint64_t val)
+    {
+        for (; val >= 0x80; val >>= 7U)
+            out.push_back(static_cast<std::uint8_t>(val | 0x80U));
+        out.push_back(static_cast<std::uint8_t>(val));
+    }
+
+    // reads a LEB128 number at in[size], moving size past it
+    bool getLeb128(const std::uint8_t* in, const std::size_t left, std::size_t& size, std::uint64_t& val)
+    {
+        val = 0;
+        for (int shift {0};; shift += 7) {
+            if (size == left or shift > 63)
+                return false;
+            const std::uint8_t byte {in[size++]};
+            val |= static_cast<std::uint64_t>(byte & 0x7FU) << shift;
+            if (!(byte & 0x80U))
+                return true;
+        }
+    }
+
+    // the registers of a record in the order of their flags
+    std::array<std::uint16_t*, 6> fields(Intel8080Trace::Record& record)
+    {
+        return {&record.pc, &record.af, &record.bc, &record.de, &record.hl, &record.sp};
+    }
+}
+
+Intel8080Trace::Encoder::Encoder(const std::uint32_t keyframeInterval) : keyframeInterval_ {std::max(keyframeInterval, 1U)}
+{
+}
+
+void Intel8080Trace::Encoder::begin(std::vector<std::uint8_t>& out)
+{
+    out.insert(out.end(), magic.begin(), magic.end());
+    put(out, version, 4);
+    put(out, keyframeInterval_, 4);
+    offset_ += headerSize;
+}
+
+void Intel8080Trace::Encoder::add(const Record& record, std::vector<std::uint8_t>& out, const std::uint64_t missing)
+{
+    const std::size_t size {out.size()};
+    // after a gap the record before isn't the one the differences would be from
+    if (records_ % keyframeInterval_ == 0 or missing != 0) {
+        if (records_ % keyframeInterval_ == 0) {
+            keyframes_.push_back(records_);
+            keyframes_.push_back(offset_);
+        }
+        if (missing != 0) {
+            out.push_back(keyframe | afterGap);
+            putLeb128(out, missing);
+        } else {
+            out.push_back(keyframe);
+        }
+        put(out, record.cycle, 8);
+        Record copy {record};
+        for (const std::uint16_t* field : fields(copy))
+            put(out, *field, 2);
+        out.insert(out.end(), record.code.begin(), record.code.end());
+    } else {
+        Record copy {record};
+        const std::array<std::uint16_t*, 6> now {fields(copy)}, before {fields(last_)};
+        std::uint8_t flags {record.code != last_.code ? codeChanged : std::uint8_t {0}};
+        for (int i {0}; i < 6; ++i)
+            flags |= *now[i] != *before[i] ? 1U << i : 0U;
+        out.push_back(flags);
+
+        // zigzag, so the cycle going back to 0 (a new test) is as short as any other small difference
+        const auto delta {static_cast<std::int64_t>(record.cycle - last_.cycle)};
+        putLeb128(out, static_cast<std::uint64_t>(delta) << 1U ^ static_cast<std::uint64_t>(delta >> 63U));
+
+        for (int i {0}; i < 6; ++i)
+            if (flags & 1U << i)
+                put(out, *now[i], 2);
+        if (flags & codeChanged)
+            out.insert(out.end(), record.code.begin(), record.code.end());
+    }
+    last_ = record;
+    ++records_;
+    offset_ += out.size() - size;
+}
+
+void Intel8080Trace::Encoder::end(std::vector<std::uint8_t>& out) const
+{
+    for (const std::uint64_t val : keyframes_)
+        put(out, val, 8);
+    put(out, keyframes_.size() / 2, 8);
+    out.insert(out.end(), indexMagic.begin(), indexMagic.end());
+}
+
+Intel8080Trace::Intel8080Trace(std::ostream& out, const std::size_t capacity, const std::uint32_t keyframeInterval)
+    : out_ {out}, mask_ {std::bit_ceil(std::max<std::size_t>(capacity, 1)) - 1}, buffer_ {new Slot[mask_ + 1]},
+      encoder_ {keyframeInterval}, writer_ {[this](const std::stop_token& stop) { write_(stop); }}
+{
+}
+
+Intel8080Trace::~Intel8080Trace()
+{
+    writer_.request_stop();
+    writer_.join();
+    out_.flush();
+}
+
+// encodes everything recorded so far, a chunk at a time, and naps when there's nothing to write. once asked to stop, it
+// makes one last pass to get what was recorded before then and adds the index
+void Intel8080Trace::write_(const std::stop_token& stop)
+{
+    constexpr std::uint64_t chunk {4096};
+
+    std::vector<std::uint8_t> bytes {};
+    bytes.reserve(chunk * sizeof(Record));
+    encoder_.begin(bytes);
+
+    std::uint64_t written {0};
+    for (bool stopping {false}; !stopping;) {
+        stopping = stop.stop_requested();
+        const std::uint64_t head {head_.load(std::memory_order_acquire)};
+        if (head == written and !stopping) {
+            std::this_thread::sleep_for(std::chrono::milliseconds {1});
+            continue;
+        }
+        while (written != head) {
+            const std::uint64_t count {std::min(head - written, chunk)};
+            for (std::uint64_t i {written}; i < written + count; ++i)
+                encoder_.add(buffer_[i & mask_].record, bytes, buffer_[i & mask_].missing);
+            written += count;
+            written_.store(written, std::memory_order_release); // the records are copied, their slots can be reused
+            out_.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            bytes.clear();
+        }
+    }
+    encoder_.end(bytes);
+    out_.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+std::string Intel8080Trace::render(const Record& record)
+{
+    char line[128];
+    std::snprintf(line, sizeof(line),
+                  "PC: %04X, AF: %04X, BC: %04X, DE: %04X, HL: %04X, SP: %04X, CYC: %llu\t(%02X %02X %02X %02X) - %s",
+                  record.pc, record.af, record.bc, record.de, record.hl, record.sp,
+                  static_cast<unsigned long long>(record.cycle), record.code[0], record.code[1], record.code[2],
+                  record.code[3], mnemonics[record.code[0]].c_str());
+    return line;
+}
+
+bool Intel8080Trace::parse(const std::string_view line, Record& record)
+{
+    if (!line.starts_with("PC: "))
+        return false;
+    const std::string text {line};
+    unsigned pc, af, bc, de, hl, sp, code[4];
+    unsigned long long cycle;
+    if (std::sscanf(text.c_str(), "PC: %x, AF: %x, BC: %x, DE: %x, HL: %x, SP: %x, CYC: %llu (%x %x %x %x)", &pc, &af,
+                    &bc, &de, &hl, &sp, &cycle, &code[0], &code[1], &code[2], &code[3]) != 11)
+        return false;
+    record = {cycle, static_cast<std::uint16_t>(pc), static_cast<std::uint16_t>(af), static_cast<std::uint16_t>(bc),
+              static_cast<std::uint16_t>(de), static_cast<std::uint16_t>(hl), static_cast<std::uint16_t>(sp),
+              {static_cast<std::uint8_t>(code[0]), static_cast<std::uint8_t>(code[1]),
+               static_cast<std::uint8_t>(code[2]), static_cast<std::uint8_t>(code[3])}};
+    return true;
+}
+
+const std::string& Intel8080Trace::disassemble(const std::uint8_t opcode)
+{
+    return mnemonics[opcode];
+}
+
+bool Intel8080TraceReader::open(const std::string& path)
+{
+    close();
+#ifdef _WIN32
+    const HANDLE file {CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                   FILE_ATTRIBUTE_NORMAL, nullptr)};
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size {};
+    const HANDLE mapping {GetFileSizeEx(file, &size) and size.QuadPart != 0
+                          ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr};
+    CloseHandle(file);
+    if (!mapping)
+        return false;
+    const void* view {MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)};
+    if (!view) {
+        CloseHandle(mapping);
+        return false;
+    }
+    mapping_ = mapping;
+    mapped_ = {static_cast<const std::uint8_t*>(view), static_cast<std::size_t>(size.QuadPart)};
+#else
+    const int file {::open(path.c_str(), O_RDONLY)};
+    if (file < 0)
+        return false;
+    struct stat status {};
+    void* view {fstat(file, &status) == 0 and status.st_size != 0
+                ? mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED};
+    ::close(file);
+    if (view == MAP_FAILED)
+        return false;
+    madvise(view, status.st_size, MADV_SEQUENTIAL);
+    mapped_ = {static_cast<const std::uint8_t*>(view), static_cast<std::size_t>(status.st_size)};
+#endif
+    if (!open(mapped_)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool Intel8080TraceReader::open(const std::span<const std::uint8_t> bytes)
+{
+    if (bytes.data() != mapped_.data())
+        close();
+    if (bytes.size() < headerSize or !std::equal(magic.begin(), magic.end(), bytes.begin())
+        or get(&bytes[8], 4) == 0 or get(&bytes[8], 4) > version)
+        return false;
+    data_ = bytes;
+    keyframeInterval_ = static_cast<std::uint32_t>(get(&bytes[12], 4));
+    keyframes_.clear();
+    if (!index_())
+        keyframes_.clear();
+    seek(0);
+    return true;
+}
+
+// takes the index off the end of the data, if it's there and makes sense
+bool Intel8080TraceReader::index_()
+{
+    if (data_.size() < headerSize + 16 or !std::equal(indexMagic.begin(), indexMagic.end(), data_.end() - 8))
+        return false;
+    const std::uint64_t count {get(&data_[data_.size() - 16], 8)};
+    if (count > (data_.size() - headerSize - 16) / 16)
+        return false;
+    const std::size_t end {data_.size() - 16 - count * 16};
+    for (std::uint64_t i {0}; i < count; ++i) {
+        const Keyframe keyframe {get(&data_[end + i * 16], 8), get(&data_[end + i * 16 + 8], 8)};
+        if (keyframe.offset < headerSize or keyframe.offset >= end)
+            return false;
+        keyframes_.push_back(keyframe);
+    }
+    data_ = data_.first(end);
+    return true;
+}
+
+void Intel8080TraceReader::close()
+{
+    if (!mapped_.empty()) {
+#ifdef _WIN32
+        UnmapViewOfFile(mapped_.data());
+        CloseHandle(mapping_);
+#else
+        munmap(const_cast<std::uint8_t*>(mapped_.data()), mapped_.size());
+#endif
+    }
+    mapped_ = data_ = {};
+    mapping_ = nullptr;
+    keyframes_.clear();
+    offset_ = records_ = gap_ = 0;
+}
+
+void Intel8080TraceReader::seek(const std::uint64_t record)
+{
+    const auto after {std::upper_bound(keyframes_.begin(), keyframes_.end(), record,
+                                       [](const std::uint64_t n, const Keyframe& keyframe) { return n < keyframe.record; })};
+    if (after == keyframes_.begin()) {
+        offset_ = headerSize;
+        records_ = 0;
+    } else {
+        offset_ = std::prev(after)->offset;
+        records_ = std::prev(after)->record;
+    }
+    gap_ = 0;
+}
+
+bool Intel8080TraceReader::next(Intel8080Trace::Record& record)
+{
+    if (offset_ >= data_.size())
+        return false;
+    const std::uint8_t* in {&data_[offset_]};
+    const std::size_t left {data_.size() - offset_};
+    const std::uint8_t flags {in[0]};
+    std::size_t size {1};
+
+    gap_ = 0;
+    if (flags == (keyframe | afterGap) and (!getLeb128(in, left, size, gap_) or gap_ == 0))
+        return false;
+    if (flags == keyframe or flags == (keyframe | afterGap)) {
+        if (left < size + 8 + 12 + 4)
+            return false;
+        last_.cycle = get(in + size, 8);
+        size += 8;
+        for (std::uint16_t* field : fields(last_)) {
+            *field = static_cast<std::uint16_t>(get(in + size, 2));
+            size += 2;
+        }
+        std::copy(in + size, in + size + 4, last_.code.begin());
+        size += 4;
+    } else if (records_ % std::max(keyframeInterval_, 1U) == 0 or flags & keyframe) {
+        return false; // a keyframe should be here
+    } else {
+        std::uint64_t zigzag {0};
+        if (!getLeb128(in, left, size, zigzag))
+            return false;
+        last_.cycle += zigzag >> 1U ^ (~(zigzag & 1U) + 1);
+        const int changed {std::popcount(static_cast<unsigned>(flags & 0x3FU))};
+        if (left < size + changed * 2 + (flags & codeChanged ? 4 : 0))
+            return false;
+        const std::array<std::uint16_t*, 6> now {fields(last_)};
+        for (int i {0}; i < 6; ++i) {
+            if (flags & 1U << i) {
+                *now[i] = static_cast<std::uint16_t>(get(in + size, 2));
+                size += 2;
+            }
+        }
+        if (flags & codeChanged) {
+            std::copy(in + size, in + size + 4, last_.code.begin());
+            size += 4;
+        }
+    }
+    offset_ += size;
+    ++records_;
+    record = last_;
+    return true;
+}
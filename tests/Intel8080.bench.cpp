@@ -0,0 +1,436 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Intel8080BlockCache.h"
+#include "Intel8080Core.h"
+#include "Intel8080Jit.h"
+#include "Intel8080Profiler.h"
+
+// Measures states and instructions per second of every engine on:
+//  - a generated stream of each class of instruction (the groups of Intel8080::mnemonic_[])
+//  - the diagnostics, with their output thrown away
+//  - a program that spends its time halted and in an interrupt handler
+//  - a diagnostic on slow memory, with wait states added to every machine cycle (tick() and runUntil() only)
+// and writes the results as JSON, with the mean, variance, min and max over the repetitions. The profiled engine is the
+// runUntil() loop again with an Intel8080Profiler sampling every so many states, to compare against the bare one.
+//
+// Usage: Intel8080_bench [-reps N] [-states N] [-sample N] [-filter text] [-exm] [-o file.json]
+
+using Memory = std::array<std::uint8_t, 0x10000>;
+
+static constexpr std::string testDirectory {"tests/binaries/"};
+
+// memory and I/O of the instruction-stepped engines. "out 0" ends a program, "out 10h" acknowledges an interrupt and
+// everything else is thrown away
+struct Bench {
+    std::uint8_t read(const std::uint16_t addr) const { return (*ram)[addr]; }
+    void write(const std::uint16_t addr, const std::uint8_t val) const { (*ram)[addr] = val; }
+    static std::uint8_t in(std::uint8_t) { return 0U; }
+
+    void out(const std::uint8_t port, std::uint8_t)
+    {
+        if (port == 0)
+            *running = false;
+        else if (port == 0x10)
+            intel8080->pins &= ~Intel8080::INT;
+    }
+
+    std::uint8_t* memory() const { return ram->data(); }
+
+    Memory* ram;
+    bool* running;
+    Intel8080* intel8080;
+};
+
+struct Case {
+    std::string name;
+    std::string kind;            // "opcode", "program", "interrupts" or "waitStates"
+    std::unique_ptr<Memory> memory {std::make_unique<Memory>()};
+    std::uint64_t budget {~0ULL}; // states to run for, or until "out 0"
+    unsigned interruptEvery {0};  // INT goes high every this many states
+    unsigned waitStates {0};      // added to every machine cycle
+};
+
+enum class Engine { tick, runUntil, profiled, step, blockCache, jit };
+constexpr std::string_view engineNames[] {"tick", "runUntil", "profiled", "step", "blockCache", "jit"};
+
+struct Sample {
+    std::uint64_t states {0};
+    std::uint64_t instructions {0};
+    double seconds {0.0};
+};
+
+// what the pins are asking for after a state of tick() or runUntil()
+struct Pins {
+    void operator()(Intel8080& intel8080)
+    {
+        const std::uint_fast64_t pins {intel8080.pins};
+        if (pins & Intel8080::SYNC) {
+            if (intel8080.status == Intel8080::instructionFetch)
+                ++instructions;
+            if (waitStates != 0) {
+                intel8080.pins &= ~Intel8080::READY;
+                waiting = waitStates;
+            }
+        } else if (pins & Intel8080::WAIT) {
+            if (--waiting == 0)
+                intel8080.pins |= Intel8080::READY;
+        } else if (pins & Intel8080::DBIN) {
+            if (intel8080.status == Intel8080::inputRead)
+                intel8080.setDBus(std::uint_fast8_t {0});
+            else if (intel8080.status == Intel8080::interruptAck
+                     or intel8080.status == Intel8080::interruptAckWhileHalt)
+                intel8080.setDBus(std::uint_fast8_t {0xFF}); // RST 7
+            else
+                intel8080.setDBus(std::uint_fast8_t {bus.read(intel8080.getABus())});
+        } else if (pins & Intel8080::WR) {
+            if (intel8080.status == Intel8080::outputWrite)
+                bus.out(intel8080.getABus() & 0xFFU, intel8080.getDBus());
+            else
+                bus.write(intel8080.getABus(), intel8080.getDBus());
+        }
+    }
+
+    Bench bus;
+    unsigned waitStates;
+    unsigned waiting {0};
+    std::uint64_t instructions {0};
+};
+
+template<class Policy>
+std::uint64_t runCore(Intel8080Core<Policy>& intel8080, const Case& test, const bool& running)
+{
+    std::uint64_t elapsed {0};
+    const std::uint64_t slice {test.interruptEvery != 0 ? test.interruptEvery : 10000U};
+    while (running and elapsed < test.budget) {
+        elapsed += intel8080.run(std::min(slice, test.budget - elapsed));
+        if (test.interruptEvery != 0)
+            intel8080.pins |= Intel8080::INT;
+    }
+    return elapsed;
+}
+
+// sampleEvery is the states between samples of the profiled engine
+Sample run(const Engine engine, const Case& test, const std::uint64_t sampleEvery)
+{
+    auto memory {std::make_unique<Memory>(*test.memory)};
+    bool running {true};
+    Sample sample {};
+    const auto begin {std::chrono::steady_clock::now()};
+
+    if (engine == Engine::tick or engine == Engine::runUntil or engine == Engine::profiled) {
+        Intel8080 intel8080 {};
+        Intel8080Profiler profiler {};
+        intel8080.reset();
+        intel8080.pc = 0x100;
+        Pins pins {Bench {memory.get(), &running, &intel8080}, test.waitStates};
+        constexpr std::uint_fast64_t events {Intel8080::SYNC | Intel8080::DBIN | Intel8080::WR | Intel8080::WAIT};
+        while (running and sample.states < test.budget) {
+            if (engine == Engine::tick) {
+                intel8080.tick();
+                ++sample.states;
+            } else {
+                std::uint64_t most {test.budget - sample.states};
+                if (test.interruptEvery != 0)
+                    most = std::min<std::uint64_t>(most, test.interruptEvery - sample.states % test.interruptEvery);
+                if (engine == Engine::profiled)
+                    most = std::min<std::uint64_t>(most, sampleEvery - sample.states % sampleEvery);
+                sample.states += intel8080.runUntil(events, most);
+            }
+            if (engine == Engine::profiled) {
+                if (sample.states % sampleEvery == 0)
+                    profiler.takeSample();
+                profiler.update(intel8080);
+            }
+            pins(intel8080);
+            if (test.interruptEvery != 0 and sample.states % test.interruptEvery == 0)
+                intel8080.pins |= Intel8080::INT;
+        }
+        // like Intel8080.test.cpp, finish the machine cycle of the "out 0"
+        if (!running) {
+            intel8080.tick();
+            ++sample.states;
+        }
+        sample.instructions = pins.instructions;
+    } else if (engine == Engine::step) {
+        Intel8080Core<Bench> intel8080 {};
+        intel8080.bus = {memory.get(), &running, &intel8080};
+        intel8080.reset();
+        intel8080.pc = 0x100;
+        sample.states = runCore(intel8080, test, running);
+    } else if (engine == Engine::blockCache) {
+        auto intel8080 {std::make_unique<Intel8080Core<Intel8080BlockCache<Bench>>>()};
+        intel8080->bus.policy = {memory.get(), &running, intel8080.get()};
+        intel8080->reset();
+        intel8080->pc = 0x100;
+        sample.states = runCore(*intel8080, test, running);
+    } else {
+        auto intel8080 {std::make_unique<Intel8080Core<Intel8080Jit<Bench>>>()};
+        intel8080->bus.policy = {memory.get(), &running, intel8080.get()};
+        intel8080->reset();
+        intel8080->pc = 0x100;
+        sample.states = runCore(*intel8080, test, running);
+    }
+
+    sample.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return sample;
+}
+
+// one class of instruction: the opcode with the fields that get filled in at random
+struct Stream {
+    std::string_view name;
+    std::uint8_t opcode;
+    enum Fields { none = 0, dst = 1, src = 2, rp = 4, bd = 8, ccc = 16, nnn = 32, pushPop = 64 } fields;
+};
+
+constexpr Stream streams[] {
+        {"MOV r1, r2", 0x40, Stream::Fields(Stream::dst | Stream::src)}, {"MOV r, M", 0x46, Stream::dst},
+        {"MOV M, r", 0x70, Stream::src}, {"SPHL", 0xF9, Stream::none}, {"MVI r, data", 0x06, Stream::dst},
+        {"MVI M, data", 0x36, Stream::none}, {"LXI rp, data", 0x01, Stream::rp}, {"LDA addr", 0x3A, Stream::none},
+        {"STA addr", 0x32, Stream::none}, {"LHLD addr", 0x2A, Stream::none}, {"SHLD addr", 0x22, Stream::none},
+        {"LDAX rp", 0x0A, Stream::bd}, {"STAX rp", 0x02, Stream::bd}, {"XCHG", 0xEB, Stream::none},
+        {"ADD r", 0x80, Stream::src}, {"ADD M", 0x86, Stream::none}, {"ADI data", 0xC6, Stream::none},
+        {"ADC r", 0x88, Stream::src}, {"ADC M", 0x8E, Stream::none}, {"ACI data", 0xCE, Stream::none},
+        {"SUB r", 0x90, Stream::src}, {"SUB M", 0x96, Stream::none}, {"SUI data", 0xD6, Stream::none},
+        {"SBB r", 0x98, Stream::src}, {"SBB M", 0x9E, Stream::none}, {"SBI data", 0xDE, Stream::none},
+        {"INR r", 0x04, Stream::dst}, {"INR M", 0x34, Stream::none}, {"DCR r", 0x05, Stream::dst},
+        {"DCR M", 0x35, Stream::none}, {"INX rp", 0x03, Stream::rp}, {"DCX rp", 0x0B, Stream::rp},
+        {"DAD rp", 0x09, Stream::rp}, {"DAA", 0x27, Stream::none}, {"ANA r", 0xA0, Stream::src},
+        {"ANA M", 0xA6, Stream::none}, {"ANI data", 0xE6, Stream::none}, {"XRA r", 0xA8, Stream::src},
+        {"XRA M", 0xAE, Stream::none}, {"XRI data", 0xEE, Stream::none}, {"ORA r", 0xB0, Stream::src},
+        {"ORA M", 0xB6, Stream::none}, {"ORI data", 0xF6, Stream::none}, {"CMP r", 0xB8, Stream::src},
+        {"CMP M", 0xBE, Stream::none}, {"CPI data", 0xFE, Stream::none}, {"RLC", 0x07, Stream::none},
+        {"RRC", 0x0F, Stream::none}, {"RAL", 0x17, Stream::none}, {"RAR", 0x1F, Stream::none},
+        {"CMA", 0x2F, Stream::none}, {"CMC", 0x3F, Stream::none}, {"STC", 0x37, Stream::none},
+        {"JMP addr", 0xC3, Stream::none}, {"J cond addr", 0xC2, Stream::ccc}, {"CALL addr", 0xCD, Stream::none},
+        {"C cond addr", 0xC4, Stream::ccc}, {"RET", 0xC9, Stream::none}, {"R cond addr", 0xC0, Stream::ccc},
+        {"RST n", 0xC7, Stream::nnn}, {"PCHL", 0xE9, Stream::none}, {"PUSH rp", 0xC5, Stream::pushPop},
+        {"PUSH PSW", 0xF5, Stream::none}, {"POP rp", 0xC1, Stream::pushPop}, {"POP PSW", 0xF1, Stream::none},
+        {"XTHL", 0xE3, Stream::none}, {"IN port", 0xDB, Stream::none}, {"OUT port", 0xD3, Stream::none},
+        {"EI", 0xFB, Stream::none}, {"DI", 0xF3, Stream::none}, {"NOP", 0x00, Stream::none},
+};
+
+/*
+ * LXI SP, 0F000h; LXI H, 0E000h; LXI B, 0E000h; LXI D, 0E002h; XRA A, then 1024 instructions of the class and a JMP
+ * back to the start, which is under 1% of the states. XRA A leaves Z and P set and S and CY clear, so it's known which
+ * conditions are met: their jumps and calls go to the next instruction either way, and the returns that are taken find
+ * the address of the next instruction on the stack. The vectors of RST n hold a RET, and PCHL jumps to itself.
+ */
+void generate(const Stream& stream, Memory& memory)
+{
+    constexpr std::uint16_t start {0x100}, stack {0xF000}, data {0xE000};
+    std::uint16_t pc {start};
+    const auto emit {[&](const std::initializer_list<std::uint8_t> bytes) {
+        for (const std::uint8_t byte : bytes)
+            memory[pc++] = byte;
+    }};
+    emit({0x31, stack & 0xFF, stack >> 8, 0x21, data & 0xFF, data >> 8, 0x01, data & 0xFF, data >> 8, 0x11, 0x02,
+        data >> 8, 0xAF});
+    if (stream.opcode == 0xE9) // PCHL
+        emit({0x21, static_cast<std::uint8_t>((pc + 3) & 0xFF), static_cast<std::uint8_t>((pc + 3) >> 8)});
+    for (int n {0}; n < 8; ++n)
+        memory[n * 8] = 0xC9;
+
+    std::uint32_t seed {stream.opcode};
+    std::uint16_t returns {stack};
+    for (int i {0}; i < 1024; ++i) {
+        seed = seed * 1103515245U + 12345U;
+        const unsigned random {seed >> 16U};
+        std::uint8_t opcode {stream.opcode};
+        if (stream.fields & Stream::dst)
+            opcode |= (random % 7 == 6 ? 7 : random % 7) << 3U; // not M
+        if (stream.fields & Stream::src)
+            opcode |= (random / 7 % 7 == 6 ? 7 : random / 7 % 7);
+        if (stream.fields & Stream::rp)
+            opcode |= (random & 3U) << 4U;
+        if (stream.fields & Stream::bd)
+            opcode |= (random & 1U) << 4U;
+        if (stream.fields & Stream::pushPop)
+            opcode |= random % 3 << 4U;
+        if (stream.fields & (Stream::ccc | Stream::nnn))
+            opcode |= (random & 7U) << 3U;
+
+        const std::uint16_t next = pc + Intel8080::length(opcode);
+        if (opcode == 0xC9 or (stream.opcode == 0xC0 and (0b01100110U >> (opcode >> 3U & 7U) & 1U))) {
+            memory[returns++] = next & 0xFF;
+            memory[returns++] = next >> 8;
+        }
+        memory[pc++] = opcode;
+        if (Intel8080::length(opcode) == 2)
+            memory[pc++] = (opcode == 0xD3 or opcode == 0xDB) ? 0x20 + random % 16 : random;
+        else if (Intel8080::length(opcode) == 3) {
+            const bool jumps {(opcode & 0xC7U) == 0xC2 or (opcode & 0xC7U) == 0xC4 or opcode == 0xC3 or opcode == 0xCD};
+            const std::uint16_t addr {jumps ? next : data};
+            memory[pc++] = addr & 0xFF;
+            memory[pc++] = addr >> 8;
+        }
+    }
+    emit({0xC3, start & 0xFF, start >> 8});
+}
+
+void program(Memory& memory, const std::vector<std::uint8_t>& image)
+{
+    std::copy(image.begin(), image.end(), memory.begin() + 0x100);
+    // "out 0,a; hlt" at 0x0000 (the end of the test), "out 1,a; ret" at 0x0005 (CP/M calls, whose output is ignored)
+    constexpr std::uint8_t patch[] {0xD3, 0x00, 0x76, 0x00, 0x00, 0xD3, 0x01, 0xC9};
+    std::copy(std::begin(patch), std::end(patch), memory.begin());
+}
+
+struct Statistics {
+    double mean {0.0}, variance {0.0}, min {0.0}, max {0.0};
+};
+
+Statistics statistics(const std::vector<double>& values)
+{
+    Statistics result {};
+    result.min = *std::min_element(values.begin(), values.end());
+    result.max = *std::max_element(values.begin(), values.end());
+    for (const double value : values)
+        result.mean += value / static_cast<double>(values.size());
+    for (const double value : values)
+        result.variance += (value - result.mean) * (value - result.mean);
+    result.variance = values.size() > 1 ? result.variance / static_cast<double>(values.size() - 1) : 0.0;
+    return result;
+}
+
+void write(std::ostream& json, const std::string_view name, const Statistics& result)
+{
+    json << "\"" << name << "\": {\"mean\": " << result.mean << ", \"variance\": " << result.variance
+         << ", \"stddev\": " << std::sqrt(result.variance) << ", \"min\": " << result.min << ", \"max\": "
+         << result.max << "}";
+}
+
+int main(int argc, char** argv)
+{
+    int repetitions {5};
+    std::uint64_t budget {2000000}, sampleEvery {1000000};
+    std::string filter {}, outputFile {};
+    bool exm {false};
+
+    using namespace std::string_view_literals;
+    for (int i {1}; i < argc; ++i) {
+        if (argv[i] == "-reps"sv and i + 1 < argc) {
+            repetitions = std::max(1, std::stoi(argv[++i]));
+        } else if (argv[i] == "-states"sv and i + 1 < argc) {
+            budget = std::stoull(argv[++i]);
+        } else if (argv[i] == "-sample"sv and i + 1 < argc) {
+            sampleEvery = std::max<std::uint64_t>(1, std::stoull(argv[++i]));
+        } else if (argv[i] == "-filter"sv and i + 1 < argc) {
+            filter = argv[++i];
+        } else if (argv[i] == "-o"sv and i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (argv[i] == "-exm"sv) {
+            exm = true;
+        } else {
+            std::cerr << "Unrecognized command line argument '" << argv[i] << "'.\nAvailable arguments are:\n"
+                      << "\trepetitions of every case: -reps N\n\tstates per instruction stream: -states N\n"
+                      << "\tstates between samples of the profiled engine: -sample N\n"
+                      << "\tonly the cases containing text: -filter text\n\tinclude 8080EXM.COM (hours): -exm\n"
+                      << "\twrite the JSON to a file instead of stdout: -o file\n\n";
+            return 1;
+        }
+    }
+
+    std::vector<Case> cases {};
+    for (const Stream& stream : streams) {
+        Case& test {cases.emplace_back(std::string {stream.name}, "opcode")};
+        test.budget = budget;
+        generate(stream, *test.memory);
+    }
+
+    std::vector<std::string> programs {"TST8080.COM", "8080PRE.COM", "CPUTEST.COM"};
+    if (exm)
+        programs.emplace_back("8080EXM.COM");
+    std::vector<std::uint8_t> tst8080 {};
+    for (const std::string& testName : programs) {
+        std::ifstream file {testDirectory + testName, std::ios::binary};
+        if (!file.is_open()) {
+            std::cerr << "error: can't open file '" << testDirectory + testName
+                      << "'. Ensure you're in the correct directory: 'Intel8080/'.\n";
+            return 1;
+        }
+        const std::vector<std::uint8_t> image {std::istreambuf_iterator<char> {file}, std::istreambuf_iterator<char> {}};
+        program(*cases.emplace_back(testName, "program").memory, image);
+        if (testName == "TST8080.COM")
+            tst8080 = image;
+    }
+
+    // LXI SP, 0F000h; EI; loop: HLT; INR B; JMP loop, with PUSH PSW; INR C; OUT 10h; POP PSW; EI; RET at 0038h
+    Case& interrupts {cases.emplace_back("HLT and an interrupt every 100 states", "interrupts")};
+    interrupts.budget = budget;
+    interrupts.interruptEvery = 100;
+    constexpr std::uint8_t idle[] {0x31, 0x00, 0xF0, 0xFB, 0x76, 0x04, 0xC3, 0x04, 0x01};
+    constexpr std::uint8_t handler[] {0xF5, 0x0C, 0xD3, 0x10, 0xF1, 0xFB, 0xC9};
+    std::copy(std::begin(idle), std::end(idle), interrupts.memory->begin() + 0x100);
+    std::copy(std::begin(handler), std::end(handler), interrupts.memory->begin() + 0x38);
+
+    Case& waits {cases.emplace_back("TST8080.COM with 2 wait states per machine cycle", "waitStates")};
+    waits.waitStates = 2;
+    program(*waits.memory, tst8080);
+
+    std::ofstream file {};
+    if (!outputFile.empty())
+        file.open(outputFile);
+    std::ostream& json {outputFile.empty() ? std::cout : file};
+    json << "{\n  \"benchmark\": \"Intel8080_bench\",\n  \"repetitions\": " << repetitions << ",\n  \"results\": [";
+
+    bool first {true};
+    for (const Case& test : cases) {
+        if (test.name.find(filter) == std::string::npos)
+            continue;
+        // states and instructions are counted by tick(), which gets to the same place as every other engine. run() can
+        // overshoot by an instruction, and once a program halts at its end it says the whole slice went by
+        std::uint64_t states {0}, instructions {0};
+        double bare {0.0}; // mean seconds of runUntil(), which the profiled engine adds the profiler to
+        for (const Engine engine :
+             {Engine::tick, Engine::runUntil, Engine::profiled, Engine::step, Engine::blockCache, Engine::jit}) {
+            if (test.waitStates != 0 and engine != Engine::tick and engine != Engine::runUntil
+                and engine != Engine::profiled)
+                continue;
+            if (engine == Engine::jit and !Intel8080Translator::available())
+                continue;
+
+            std::vector<double> seconds {}, statesPerSecond {}, instructionsPerSecond {};
+            for (int i {0}; i < repetitions; ++i) {
+                const Sample sample {run(engine, test, sampleEvery)};
+                if (engine == Engine::tick) {
+                    states = sample.states;
+                    instructions = sample.instructions;
+                }
+                seconds.push_back(sample.seconds);
+                statesPerSecond.push_back(static_cast<double>(states) / sample.seconds);
+                instructionsPerSecond.push_back(static_cast<double>(instructions) / sample.seconds);
+            }
+            std::cerr << test.name << " (" << engineNames[static_cast<int>(engine)] << "): "
+                      << statistics(statesPerSecond).mean / 1e6 << " M states/s";
+            if (engine == Engine::runUntil)
+                bare = statistics(seconds).mean;
+            else if (engine == Engine::profiled)
+                std::cerr << ", " << (statistics(seconds).mean / bare - 1) * 100 << "% over runUntil";
+            std::cerr << '\n';
+
+            json << (first ? "\n" : ",\n") << "    {\"case\": \"" << test.name << "\", \"kind\": \"" << test.kind
+                 << "\", \"engine\": \"" << engineNames[static_cast<int>(engine)] << "\", \"states\": " << states
+                 << ", \"instructions\": " << instructions << ", ";
+            write(json, "seconds", statistics(seconds));
+            json << ", ";
+            write(json, "statesPerSecond", statistics(statesPerSecond));
+            json << ", ";
+            write(json, "instructionsPerSecond", statistics(instructionsPerSecond));
+            json << "}";
+            first = false;
+        }
+    }
+    json << "\n  ]\n}\n";
+
+    return 0;
+}
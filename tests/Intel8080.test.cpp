@@ -1,67 +1,63 @@
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <format>
+#include <mutex>
+#include <optional>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <chrono>
-#include "Intel8080.h"
+#include <deque>
+#include <thread>
+#include <vector>
+#include "Intel8080Trace.h"
 
 using Memory = std::array<std::uint8_t, 0x10000>;
 
 static constexpr std::string testDirectory {"tests/binaries/"};
-static constexpr std::string disassambleTable[256] = {
-        "nop", "lxi b,#", "stax b", "inx b",
-        "inr_ b", "dcr_ b", "mvi b,#", "rlc", "ill", "dad b", "ldax b", "dcx b",
-        "inr_ c", "dcr_ c", "mvi c,#", "rrc", "ill", "lxi d,#", "stax d", "inx d",
-        "inr_ d", "dcr_ d", "mvi d,#", "ral", "ill", "dad d", "ldax d", "dcx d",
-        "inr_ e", "dcr_ e", "mvi e,#", "rar", "ill", "lxi h,#", "shld", "inx h",
-        "inr_ h", "dcr_ h", "mvi h,#", "daa", "ill", "dad h", "lhld", "dcx h",
-        "inr_ l", "dcr_ l", "mvi l,#", "cma", "ill", "lxi sp,#", "sta $", "inx sp",
-        "inr_ M", "dcr_ M", "mvi M,#", "stc", "ill", "dad sp", "lda $", "dcx sp",
-        "inr_ a", "dcr_ a", "mvi a,#", "cmc", "mov b,b", "mov b,c", "mov b,d",
-        "mov b,e", "mov b,h", "mov b,l", "mov b,M", "mov b,a", "mov c,b", "mov c,c",
-        "mov c,d", "mov c,e", "mov c,h", "mov c,l", "mov c,M", "mov c,a", "mov d,b",
-        "mov d,c", "mov d,d", "mov d,e", "mov d,h", "mov d,l", "mov d,M", "mov d,a",
-        "mov e,b", "mov e,c", "mov e,d", "mov e,e", "mov e,h", "mov e,l", "mov e,M",
-        "mov e,a", "mov h,b", "mov h,c", "mov h,d", "mov h,e", "mov h,h", "mov h,l",
-        "mov h,M", "mov h,a", "mov l,b", "mov l,c", "mov l,d", "mov l,e", "mov l,h",
-        "mov l,l", "mov l,M", "mov l,a", "mov M,b", "mov M,c", "mov M,d", "mov M,e",
-        "mov M,h", "mov M,l", "hlt", "mov M,a", "mov a,b", "mov a,c", "mov a,d",
-        "mov a,e", "mov a,h", "mov a,l", "mov a,M", "mov a,a", "add_ b", "add_ c",
-        "add_ d", "add_ e", "add_ h", "add_ l", "add_ M", "add_ a", "adc_ b", "adc_ c",
-        "adc_ d", "adc_ e", "adc_ h", "adc_ l", "adc_ M", "adc_ a", "sub_ b", "sub_ c",
-        "sub_ d", "sub_ e", "sub_ h", "sub_ l", "sub_ M", "sub_ a", "sbb_ b", "sbb_ c",
-        "sbb_ d", "sbb_ e", "sbb_ h", "sbb_ l", "sbb_ M", "sbb_ a", "ana_ b", "ana_ c",
-        "ana_ d", "ana_ e", "ana_ h", "ana_ l", "ana_ M", "ana_ a", "xra_ b", "xra_ c",
-        "xra_ d", "xra_ e", "xra_ h", "xra_ l", "xra_ M", "xra_ a", "ora_ b", "ora_ c",
-        "ora_ d", "ora_ e", "ora_ h", "ora_ l", "ora_ M", "ora_ a", "cmp_ b", "cmp_ c",
-        "cmp_ d", "cmp_ e", "cmp_ h", "cmp_ l", "cmp_ M", "cmp_ a", "rnz", "pop b",
-        "jnz $", "jmp $", "cnz $", "push b", "adi #", "rst 0", "rz", "ret", "jz $",
-        "ill", "cz $", "call $", "aci #", "rst 1", "rnc", "pop d", "jnc $", "out p",
-        "cnc $", "push d", "sui #", "rst 2", "rc", "ill", "jc $", "in p", "cc $",
-        "ill", "sbi #", "rst 3", "rpo", "pop h", "jpo $", "xthl", "cpo $", "push h",
-        "ani_ #", "rst 4", "rpe", "pchl", "jpe $", "xchg", "cpe $", "ill", "xri #",
-        "rst 5", "rp", "pop psw", "jp $", "di", "cp $", "push psw", "ori #",
-        "rst 6", "rm", "sphl", "jm $", "ei", "cm $", "ill", "cpi #", "rst 7"};
-
-bool testRunning {true}; // flag needed by two functions could pass by reference but im lazy
-
-void log (Intel8080& intel8080, const Memory& memory, unsigned long long currentCycle)
+
+// everything one diagnostic needs, so they can run on their own threads
+struct Test {
+    Test(std::string name, unsigned long long expectedCycles, Intel8080Trace* trace)
+        : name {std::move(name)}, expectedCycles {expectedCycles}, trace {trace}, out {trace ? std::cout : buffer} {}
+
+    const std::string name;
+    const unsigned long long expectedCycles;
+    Memory memory {};
+    Intel8080Trace* trace; // with -debug
+    std::ostringstream buffer {};
+    std::ostream& out; // the buffer, or stdout with -debug which is too much to hold on to
+    bool running {true};
+    bool done {false};
+
+    // a piece of a test starts from a snapshot of another piece, instead of loading the file, and can stop when it gets
+    // to an address. only the last piece prints the summary, with the totals of every piece
+    std::optional<Intel8080::State> from {};
+    std::optional<std::uint16_t> stopAt {};
+    bool summary {true};
+
+    Intel8080::State state {}; // where it stopped
+    unsigned long long cycles {0};
+    unsigned long instructions {0};
+    std::chrono::steady_clock::time_point begin {}, end {};
+};
+
+// 8080EXM.COM goes over a table of exercisers, one per group of instructions:
+//      0122: mov a,m / inx h / ora m / jz done / dcx h / call stt / jmp 0122
+// each of them sets up everything it uses and stt moves hl on to the next one, so a group can be run on its own from a
+// snapshot of the first time around the loop with hl pointing at its entry
+static constexpr std::uint16_t exmLoop {0x0122};
+static constexpr std::uint16_t exmTable {0x013A};
+
+// the instruction about to be executed, with the cycle it started on
+void log(Intel8080Trace& trace, const Intel8080& intel8080, const Memory& memory, unsigned long long currentCycle)
 {
-    std::cout << std::format(
-            "PC: {:0>4X}, AF: {:0>4X}, BC: {:0>4X}, DE: {:0>4X}, HL: {:0>4X}, SP: {:0>4X}, CYC: {:d}\t({:0>2X} {:0>2X} {:0>2X} {:0>2X}) - {:s}\n",
-            intel8080.pc,
-            intel8080.getReg(Intel8080::A) << 8U | intel8080.getReg(Intel8080::F),
-            intel8080.getPair(Intel8080::BC),
-            intel8080.getPair(Intel8080::DE),
-            intel8080.getPair(Intel8080::HL),
-            intel8080.getPair(Intel8080::SP),
-            currentCycle - 1,
-            memory[intel8080.pc],
-            memory[intel8080.pc + 1U],
-            memory[intel8080.pc + 2U],
-            memory[intel8080.pc + 3U],
-            disassambleTable[memory[intel8080.pc]]);
+    const std::uint16_t pc {intel8080.pc};
+    trace.record(intel8080, currentCycle - 1, {memory[pc], memory[static_cast<std::uint16_t>(pc + 1U)],
+                                               memory[static_cast<std::uint16_t>(pc + 2U)],
+                                               memory[static_cast<std::uint16_t>(pc + 3U)]});
 }
 
 int loadFile(Memory& memory, const std::string& path, int addr)
@@ -98,119 +94,194 @@ std::string t(std::chrono::steady_clock::time_point begin, std::chrono::steady_c
     }
 }
 
-void onDataInput(Intel8080& intel8080, Memory& memory, bool debug, bool verbose)
+void onDataInput(Intel8080& intel8080, Test& test, bool verbose)
 {
+    const Memory& memory {test.memory};
     if (intel8080.status == Intel8080::instructionFetch) {
         intel8080.setDBus(memory[intel8080.getABus()]);
-        if (debug and verbose)
-            std::cout << std::format(
+        if (verbose)
+            test.out << std::format(
                     "\tFETCH CYCLE\t[{:s}]: abus={:0>4X}, dbus={:0>2X}\n",
-                    disassambleTable[memory[intel8080.getABus()]],
+                    Intel8080Trace::disassemble(memory[intel8080.getABus()]),
                     intel8080.getABus(),
                     intel8080.getDBus());
     } else if (intel8080.status == Intel8080::memoryRead or intel8080.status == Intel8080::stackRead) {
         intel8080.setDBus(memory[intel8080.getABus()]);
-        if (debug and verbose)
-            std::cout << std::format(
+        if (verbose)
+            test.out << std::format(
                     "\tREAD CYCLE\t[{:s}]: abus={:0>4X}, dbus={:0>2X}\n",
-                    disassambleTable[intel8080.ir],
+                    Intel8080Trace::disassemble(intel8080.ir),
                     intel8080.getABus(),
                     intel8080.getDBus());
     } else if (intel8080.status == Intel8080::inputRead) {
         intel8080.setDBus(0ULL);
     } else {
-        std::cout << std::format("ERROR: unrecognized status word with DBIN pin high '{:b}' - {:s}\n",
-                                 intel8080.status, disassambleTable[intel8080.ir]);
+        test.out << std::format("ERROR: unrecognized status word with DBIN pin high '{:b}' - {:s}\n",
+                                 intel8080.status, Intel8080Trace::disassemble(intel8080.ir));
+    }
+}
+
+void onOutput(Intel8080& intel8080, Test& test, std::uint16_t port)
+{
+    const Memory& memory {test.memory};
+    if (port == 0) {
+        test.running = false;
+    } else if (port == 1) {
+        const std::uint8_t operation{intel8080.getReg(Intel8080::C)};
+        if (operation == 9) {
+            // print from memory at (DE) until '$' char
+            std::uint16_t addr{intel8080.getPair(Intel8080::DE)};
+            do {
+                test.out << (char) memory[addr++];
+            } while (memory[addr] != '$');
+        } else if (operation == 2 or operation == 5) {
+            // print a character stored in E
+            test.out << (char) intel8080.getReg(Intel8080::E);
+        }
     }
 }
 
-void onDataOutput(Intel8080& intel8080, Memory& memory, bool debug, bool verbose)
+void onDataOutput(Intel8080& intel8080, Test& test, bool verbose)
 {
+    Memory& memory {test.memory};
     if (intel8080.status == Intel8080::memoryWrite or intel8080.status == Intel8080::stackWrite) {
         memory[intel8080.getABus()] = intel8080.getDBus();
-        if (debug and verbose)
-            std::cout << std::format(
+        if (verbose)
+            test.out << std::format(
                     "\tWRITE CYCLE\t[{:s}]: abus={:0>4X}, dbus={:0>2X}, mem={:0>2X}\n",
-                    disassambleTable[intel8080.ir],
+                    Intel8080Trace::disassemble(intel8080.ir),
                     intel8080.getABus(),
                     intel8080.getDBus(),
                     memory[intel8080.getABus()]);
     } else if (intel8080.status == Intel8080::outputWrite) {
-        std::uint16_t port{intel8080.getABus()};
-        if (port == 0) {
-            testRunning = false;
-        } else if (port == 1) {
-            const std::uint8_t operation{intel8080.getReg(Intel8080::C)};
-            if (operation == 9) {
-                // print from memory at (DE) until '$' char
-                std::uint16_t addr{intel8080.getPair(Intel8080::DE)};
-                do {
-                    std::cout << (char) memory[addr++];
-                } while (memory[addr] != '$');
-            } else if (operation == 2 or operation == 5) {
-                // print a character stored in E
-                std::cout << (char) intel8080.getReg(Intel8080::E);
-            }
-        }
+        onOutput(intel8080, test, intel8080.getABus());
     } else {
-        std::cout << std::format("ERROR: unrecognized status word with WR pin high '{:b}' - {:s}\n",
-                                 intel8080.status, disassambleTable[intel8080.ir]);
+        test.out << std::format("ERROR: unrecognized status word with WR pin high '{:b}' - {:s}\n",
+                                 intel8080.status, Intel8080Trace::disassemble(intel8080.ir));
     }
 }
 
-void test(Intel8080& intel8080, const std::string& testName, unsigned long long expectedCycles, bool debug, bool verbose)
+// bus for the instruction-stepped engine, does the same thing as onDataInput() and onDataOutput()
+class TestBus : public Intel8080::Bus {
+public:
+    TestBus(Intel8080& intel8080, Test& test) : intel8080_ {intel8080}, test_ {test} {}
+
+    std::uint8_t read(std::uint16_t addr) override { return test_.memory[addr]; }
+    void write(std::uint16_t addr, std::uint8_t val) override { test_.memory[addr] = val; }
+    std::uint8_t in(std::uint8_t) override { return 0U; }
+    void out(std::uint8_t port, std::uint8_t) override { onOutput(intel8080_, test_, port); }
+private:
+    Intel8080& intel8080_;
+    Test& test_;
+};
+
+bool run(Test& test, bool verbose, bool fast)
 {
-    Memory memory {};
-    if (loadFile(memory, testDirectory + testName, 0x100) < 0)
-        return;
-    std::cout << std::format("*** TEST: {:s}\n", testName);
+    Memory& memory {test.memory};
+    Intel8080 intel8080 {};
+    test.begin = std::chrono::steady_clock::now();
+
+    if (test.from) {
+        intel8080.loadState(*test.from);
+    } else {
+        if (loadFile(memory, testDirectory + test.name, 0x100) < 0)
+            return false;
+        test.out << std::format("*** TEST: {:s}\n", test.name);
 
-    // inject "out 0,a" at 0x0000 (signal to stop the test)
-    memory[0x0000] = 0xD3;
-    memory[0x0001] = 0x00;
+        // inject "out 0,a" at 0x0000 (signal to stop the test)
+        memory[0x0000] = 0xD3;
+        memory[0x0001] = 0x00;
 
-    // inject "out 1,a" at 0x0005 (signal to output some characters)
-    memory[0x0005] = 0xD3;
-    memory[0x0006] = 0x01;
-    memory[0x0007] = 0xC9;
+        // inject "out 1,a" at 0x0005 (signal to output some characters)
+        memory[0x0005] = 0xD3;
+        memory[0x0006] = 0x01;
+        memory[0x0007] = 0xC9;
 
-    // reset the cpu for the next test
-    intel8080.reset();
-    intel8080.pc = 0x100U;
-    testRunning = true;
+        intel8080.reset();
+        intel8080.pc = 0x100U;
+    }
 
     unsigned long long executedCycles {0};
     unsigned long instructions {0};
-    std::chrono::steady_clock::time_point begin {std::chrono::steady_clock::now()};
+    const int stopAt {test.stopAt ? *test.stopAt : -1};
 
-    while (testRunning) {
-        intel8080.tick();
-        ++executedCycles;
-
-        if (intel8080.pins & Intel8080::SYNC and intel8080.status == Intel8080::instructionFetch) {
+    if (fast) {
+        TestBus bus {intel8080, test};
+        while (test.running) {
             ++instructions;
-            if (debug)
-                log(intel8080, memory, executedCycles);
-        } else if (intel8080.pins & Intel8080::DBIN) {
-            onDataInput(intel8080, memory, debug, verbose);
-        } else if (intel8080.pins & Intel8080::WR) {
-            onDataOutput(intel8080, memory, debug, verbose);
+            if (test.trace)
+                log(*test.trace, intel8080, memory, executedCycles + 1);
+            executedCycles += intel8080.step(bus);
+            if (intel8080.pc == stopAt)
+                break;
+        }
+    } else {
+        while (test.running) {
+            intel8080.tick();
+            ++executedCycles;
+
+            if (intel8080.pins & Intel8080::SYNC and intel8080.status == Intel8080::instructionFetch) {
+                ++instructions;
+                if (test.trace)
+                    log(*test.trace, intel8080, memory, executedCycles);
+                // stops just after T1 of the fetch, a snapshot of it carries on from T2
+                if (intel8080.getABus() == stopAt)
+                    break;
+            } else if (intel8080.pins & Intel8080::DBIN) {
+                onDataInput(intel8080, test, verbose);
+            } else if (intel8080.pins & Intel8080::WR) {
+                onDataOutput(intel8080, test, verbose);
+            }
+        }
+        // need to tick() one more time because the test ended before the cpu could finish its last cycle
+        if (!test.running) {
+            intel8080.tick();
+            ++executedCycles;
+        }
+    }
+
+    test.state = intel8080.saveState();
+    test.cycles = executedCycles;
+    test.instructions = instructions;
+    test.end = std::chrono::steady_clock::now();
+    return true;
+}
+
+// runs 8080EXM.COM up to the first time around its loop, and adds a piece for each group and the end of the test that
+// starts from there. falls back to running it whole if it can't get that far
+void shard(std::deque<Test>& tests, unsigned long long expectedCycles, Intel8080Trace* trace, bool verbose, bool fast)
+{
+    Test& prefix {tests.emplace_back("8080EXM.COM", expectedCycles, trace)};
+    prefix.stopAt = exmLoop;
+    prefix.summary = false;
+    if (!run(prefix, verbose, fast) or !prefix.running) {
+        tests.pop_back();
+        tests.emplace_back("8080EXM.COM", expectedCycles, trace);
+        return;
+    }
+    prefix.done = true;
+
+    for (std::uint16_t entry {exmTable};; entry += 2) {
+        Test& piece {tests.emplace_back("8080EXM.COM", expectedCycles, trace)};
+        piece.memory = prefix.memory;
+        piece.from = prefix.state;
+        piece.from->pair[Intel8080::HL] = entry;
+        piece.stopAt = exmLoop;
+        piece.summary = false;
+        if ((prefix.memory[entry] | prefix.memory[entry + 1]) == 0) {
+            piece.summary = true; // the end of the table, which prints "Tests complete" and stops
+            break;
         }
     }
-    // need to tick() one more time because the test ended before the cpu could finish its last cycle
-    intel8080.tick();
-    ++executedCycles;
-
-    unsigned long long diff {expectedCycles > executedCycles ? expectedCycles - executedCycles : executedCycles - expectedCycles};
-    std::cout << std::format("\n*** {:d} instructions executed on {:d} cycles (expected={:d}, diff={:d}) in {:s}\n\n",
-           instructions, executedCycles, expectedCycles, diff,
-                             t(begin, std::chrono::steady_clock::now()));
 }
 
 int main(int argc, char** argv)
 {
     bool debug {false};
     bool verbose {false};
+    bool fast {false};
+    bool sharded {false};
+    unsigned jobs {std::max(1U, std::thread::hardware_concurrency())};
 
     // simple command line parsing
     using namespace std::string_view_literals;
@@ -219,21 +290,91 @@ int main(int argc, char** argv)
             debug = true;
         } else if (argv[i] == "-v"sv) {
             verbose = true;
+        } else if (argv[i] == "-fast"sv) {
+            fast = true;
+        } else if (argv[i] == "-j"sv and i + 1 < argc) {
+            jobs = std::max(1, std::stoi(argv[++i]));
+        } else if (argv[i] == "-shard"sv) {
+            sharded = true;
         } else {
-            std::cout << std::format("Unrecognized command line argument '{:s}'.\nAvailable arguments are:\n\tenable logging: -debug\n\tenable verbose logging: -v\n\n", argv[i]);
+            std::cout << std::format("Unrecognized command line argument '{:s}'.\nAvailable arguments are:\n\tenable logging: -debug\n\tenable verbose logging: -v\n\trun instruction-stepped: -fast\n\tnumber of tests to run at once: -j N\n\trun each group of 8080EXM.COM as its own test: -shard\n\n", argv[i]);
         }
     }
     verbose = (verbose and debug); // verbose only makes sense if debug is also enabled
+    // the trace is written by a thread of its own, so the tests only have to copy the processor into it. there's only one
+    // of it, and the test output goes straight to stdout, so they run one after another
+    std::ofstream traceFile {};
+    std::optional<Intel8080Trace> trace {};
+    if (debug) {
+        jobs = 1;
+        traceFile.open("Intel8080.trace", std::ios::binary);
+        trace.emplace(traceFile);
+    }
+    Intel8080Trace* const log {trace ? &*trace : nullptr};
+
+    std::deque<Test> tests {}; // never moves them, their output stream refers to their buffer
+    tests.emplace_back("TST8080.COM", 4924ULL, log);
+    tests.emplace_back("8080PRE.COM", 7817ULL, log);
+    tests.emplace_back("CPUTEST.COM", 255653383ULL, log);
 
-    Intel8080 intel8080 {};
     std::chrono::steady_clock::time_point begin {std::chrono::steady_clock::now()};
+    if (sharded)
+        shard(tests, 23803381171ULL, log, verbose, fast);
+    else
+        tests.emplace_back("8080EXM.COM", 23803381171ULL, log);
 
-    test(intel8080, "TST8080.COM", 4924ULL, debug, verbose);
-    test(intel8080, "8080PRE.COM", 7817ULL, debug, verbose);
-    test(intel8080, "CPUTEST.COM", 255653383ULL, debug, verbose);
-    test(intel8080, "8080EXM.COM", 23803381171ULL, debug, verbose);
+    // the summary of a test sharded into pieces adds up all of them
+    unsigned long long cycles {0};
+    unsigned long instructions {0};
+    std::optional<std::chrono::steady_clock::time_point> started {};
+    std::chrono::steady_clock::time_point finished {};
+    auto print {[&](const Test& test) {
+        std::cout << test.buffer.str();
+        if (test.end == std::chrono::steady_clock::time_point {}) // it didn't run
+            return;
+        cycles += test.cycles;
+        instructions += test.instructions;
+        started = std::min(started.value_or(test.begin), test.begin);
+        finished = std::max(finished, test.end);
+        if (test.summary) {
+            const unsigned long long expectedCycles {test.expectedCycles};
+            unsigned long long diff {expectedCycles > cycles ? expectedCycles - cycles : cycles - expectedCycles};
+            std::cout << std::format("\n*** {:d} instructions executed on {:d} cycles (expected={:d}, diff={:d}) in {:s}\n\n",
+                                     instructions, cycles, expectedCycles, diff, t(*started, finished));
+            cycles = 0;
+            instructions = 0;
+            started.reset();
+            finished = {};
+        }
+        std::cout << std::flush;
+    }};
+
+    // each thread takes the next test that hasn't started. when one finishes, its output and any finished ones after it
+    // are printed, so the output comes out in the same order as running them one after another
+    std::atomic<std::size_t> next {0};
+    std::mutex printing {};
+    std::size_t printed {0};
+    auto worker {[&] {
+        for (std::size_t i {next++}; i < tests.size(); i = next++) {
+            if (tests[i].done) // the start of a sharded test, which has already run
+                continue;
+            run(tests[i], verbose, fast);
+
+            const std::lock_guard lock {printing};
+            tests[i].done = true;
+            for (; printed < tests.size() and tests[printed].done; ++printed)
+                print(tests[printed]);
+        }
+    }};
+    std::vector<std::jthread> threads {};
+    for (unsigned i {0}; i < std::min<std::size_t>(jobs, tests.size()); ++i)
+        threads.emplace_back(worker);
+    threads.clear(); // joins them
 
     std::cout << "Done. Total time elapsed " << t(begin, std::chrono::steady_clock::now()) << std::endl;
+    if (trace)
+        std::cout << "Trace written to Intel8080.trace (" << trace->dropped()
+                  << " instructions dropped), see it with Intel8080_trace Intel8080.trace" << std::endl;
 
     return 0;
 }
\ No newline at end of file
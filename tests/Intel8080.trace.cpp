@@ -0,0 +1,85 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Intel8080Trace.h"
+
+// Turns a trace from Intel8080Trace, e.g. the one Intel8080_test -debug writes, into the text it used to print: a line
+// of registers, cycle and disassembly for every instruction. Given a text log instead, e.g. from an older build, -o
+// turns it into a trace. Where the trace dropped records it prints how many are missing instead.
+//
+// Usage: Intel8080_trace file [-from CYCLE] [-to CYCLE] [-o file.trace]
+
+int main(int argc, char** argv)
+{
+    const char* path {nullptr};
+    const char* output {nullptr};
+    std::uint64_t from {0}, to {~0ULL};
+
+    using namespace std::string_view_literals;
+    for (int i {1}; i < argc; ++i) {
+        if (argv[i] == "-from"sv and i + 1 < argc) {
+            from = std::stoull(argv[++i]);
+        } else if (argv[i] == "-to"sv and i + 1 < argc) {
+            to = std::stoull(argv[++i]);
+        } else if (argv[i] == "-o"sv and i + 1 < argc) {
+            output = argv[++i];
+        } else if (argv[i][0] != '-' and !path) {
+            path = argv[i];
+        } else {
+            std::cerr << "Unrecognized command line argument '" << argv[i] << "'.\n";
+            path = nullptr;
+            break;
+        }
+    }
+    if (!path) {
+        std::cerr << "Usage: Intel8080_trace file [-from CYCLE] [-to CYCLE] [-o file.trace]\n";
+        return 1;
+    }
+    std::ios::sync_with_stdio(false);
+
+    // a text log: every line that isn't an instruction, e.g. the output of the program, is skipped
+    Intel8080TraceReader reader {};
+    if (!reader.open(path)) {
+        std::ifstream log {path};
+        if (!log.is_open()) {
+            std::cerr << "error: can't open file '" << path << "'.\n";
+            return 1;
+        }
+        if (!output) {
+            std::cerr << "error: '" << path << "' isn't a trace, give -o to turn it into one.\n";
+            return 1;
+        }
+        std::ofstream trace {output, std::ios::binary};
+        Intel8080Trace::Encoder encoder {};
+        std::vector<std::uint8_t> bytes {};
+        encoder.begin(bytes);
+        std::uint64_t records {0};
+        Intel8080Trace::Record record {};
+        for (std::string line {}; std::getline(log, line);) {
+            if (Intel8080Trace::parse(line, record) and record.cycle >= from and record.cycle <= to) {
+                encoder.add(record, bytes);
+                ++records;
+            }
+            if (bytes.size() >= 1U << 16U) {
+                trace.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+                bytes.clear();
+            }
+        }
+        encoder.end(bytes);
+        trace.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        std::cout << records << " instructions written to " << output << '\n';
+        return trace.good() ? 0 : 1;
+    }
+
+    // every test of Intel8080_test starts again from cycle 0, so this can't stop at the first record past -to
+    for (Intel8080Trace::Record record {}; reader.next(record);) {
+        if (record.cycle < from or record.cycle > to)
+            continue;
+        if (reader.gap() != 0)
+            std::cout << "gap of " << reader.gap() << " records\n";
+        std::cout << Intel8080Trace::render(record) << '\n';
+    }
+    return 0;
+}
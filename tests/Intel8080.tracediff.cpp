@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Intel8080Trace.h"
+
+// Finds the first instruction where two traces differ, e.g. this emulator's and another one's imported from its text
+// log. Where both traces have an index with keyframes at the same records, the records between two keyframes are only
+// decoded if their bytes differ, so it takes about as long as the traces agree for and never reads the rest. Where a
+// trace dropped records, the other one skips as many and the gap is reported instead of a difference.
+//
+// Usage: Intel8080_tracediff a b [-no-cycles] [-context N]
+// a and b are traces or text logs in the format of Intel8080Trace::render(). Exits with 0 if they're the same, 1 if
+// they differ and 2 if one can't be read.
+
+struct Input {
+    Intel8080TraceReader reader {};
+    std::vector<std::uint8_t> imported {}; // a text log, encoded as a trace
+    const char* path {nullptr};
+    Intel8080Trace::Record record {};      // the last one read
+    bool more {true};
+    std::uint64_t missing {0};             // records dropped so far
+
+    // where the last record read was in what was traced
+    [[nodiscard]] std::uint64_t place() const { return reader.position() + missing; }
+};
+
+bool load(Input& input, const char* path)
+{
+    input.path = path;
+    if (input.reader.open(path))
+        return true;
+    std::ifstream log {path};
+    if (!log.is_open()) {
+        std::cerr << "error: can't open file '" << path << "'.\n";
+        return false;
+    }
+    Intel8080Trace::Encoder encoder {};
+    encoder.begin(input.imported);
+    Intel8080Trace::Record record {};
+    for (std::string line {}; std::getline(log, line);) {
+        if (Intel8080Trace::parse(line, record))
+            encoder.add(record, input.imported);
+    }
+    encoder.end(input.imported);
+    return input.reader.open(input.imported);
+}
+
+// the first keyframe at or after a record
+std::size_t keyframeFrom(const Intel8080TraceReader& reader, const std::uint64_t record)
+{
+    const auto keyframes {reader.keyframes()};
+    return std::lower_bound(keyframes.begin(), keyframes.end(), record,
+                            [](const Intel8080TraceReader::Keyframe& keyframe, const std::uint64_t n) {
+                                return keyframe.record < n;
+                            }) - keyframes.begin();
+}
+
+// reads the next record, and says so if records were dropped before it
+void next(Input& input, std::uint64_t& gaps)
+{
+    input.more = input.reader.next(input.record);
+    if (input.more and input.reader.gap() != 0) {
+        input.missing += input.reader.gap();
+        std::cout << "gap of " << input.reader.gap() << " records before instruction " << input.reader.position() - 1
+                  << " of " << input.path << '\n';
+        ++gaps;
+    }
+}
+
+// skips the records up to the next keyframe if both traces are at a keyframe and have exactly the same bytes up to the
+// next one
+bool skip(Intel8080TraceReader& a, Intel8080TraceReader& b)
+{
+    const std::uint64_t position {a.position()};
+    const std::size_t i {keyframeFrom(a, position)}, j {keyframeFrom(b, position)};
+    const auto ka {a.keyframes()}, kb {b.keyframes()};
+    if (i + 1 >= ka.size() or j + 1 >= kb.size() or ka[i].record != position or kb[j].record != position
+        or ka[i].offset != a.offset() or kb[j].offset != b.offset() or ka[i + 1].record != kb[j + 1].record)
+        return false;
+    const std::uint64_t size {ka[i + 1].offset - ka[i].offset};
+    if (size != kb[j + 1].offset - kb[j].offset or std::memcmp(a.bytes(ka[i].offset).data(), b.bytes(kb[j].offset).data(), size) != 0)
+        return false;
+    a.seek(ka[i + 1].record);
+    b.seek(kb[j + 1].record);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* paths[2] {nullptr, nullptr};
+    bool cycles {true};
+    std::uint64_t context {5};
+
+    using namespace std::string_view_literals;
+    for (int i {1}; i < argc; ++i) {
+        if (argv[i] == "-no-cycles"sv) {
+            cycles = false;
+        } else if (argv[i] == "-context"sv and i + 1 < argc) {
+            context = std::stoull(argv[++i]);
+        } else if (argv[i][0] != '-' and !paths[1]) {
+            paths[paths[0] ? 1 : 0] = argv[i];
+        } else {
+            std::cerr << "Unrecognized command line argument '" << argv[i] << "'.\n";
+            return 2;
+        }
+    }
+    if (!paths[1]) {
+        std::cerr << "Usage: Intel8080_tracediff a b [-no-cycles] [-context N]\n";
+        return 2;
+    }
+
+    Input inputs[2] {};
+    for (int i {0}; i < 2; ++i) {
+        if (!load(inputs[i], paths[i])) {
+            std::cerr << "error: '" << paths[i] << "' is neither a trace nor a log.\n";
+            return 2;
+        }
+    }
+    Input& inputA {inputs[0]};
+    Input& inputB {inputs[1]};
+    Intel8080TraceReader& a {inputA.reader};
+    Intel8080TraceReader& b {inputB.reader};
+
+    const Intel8080Trace::Record& ra {inputA.record};
+    const Intel8080Trace::Record& rb {inputB.record};
+    const bool& moreA {inputA.more};
+    const bool& moreB {inputB.more};
+    std::uint64_t skipped {0}, gaps {0};
+    for (;;) {
+        if (inputA.missing == inputB.missing and skip(a, b)) {
+            ++skipped;
+            continue;
+        }
+        next(inputA, gaps);
+        next(inputB, gaps);
+        // the trace that's behind skips the records the other one dropped
+        while (moreA and moreB and inputA.place() != inputB.place())
+            next(inputA.place() < inputB.place() ? inputA : inputB, gaps);
+        if (!moreA or !moreB)
+            break;
+        Intel8080Trace::Record compared {ra};
+        if (!cycles)
+            compared.cycle = rb.cycle;
+        if (compared != rb)
+            break;
+    }
+    if (!moreA and !moreB) {
+        std::cout << "the traces are the same, " << a.position() << " instructions";
+        if (gaps != 0)
+            std::cout << " apart from " << gaps << (gaps == 1 ? " gap" : " gaps");
+        std::cout << '\n';
+        return 0;
+    }
+
+    // show the instructions of a that led up to it again
+    const std::uint64_t at {moreA ? a.position() - 1 : a.position()};
+    std::cout << "first difference at instruction " << at << " (" << skipped << " stretches between keyframes skipped)\n";
+    a.seek(at - std::min(at, context));
+    Intel8080Trace::Record record {};
+    while (a.position() < at and a.next(record)) {
+        if (a.position() + context > at)
+            std::cout << "  " << Intel8080Trace::render(record) << '\n';
+    }
+    if (moreA)
+        std::cout << "< " << Intel8080Trace::render(ra) << '\n';
+    else
+        std::cout << "< (end of " << paths[0] << ")\n";
+    if (moreB)
+        std::cout << "> " << Intel8080Trace::render(rb) << '\n';
+    else
+        std::cout << "> (end of " << paths[1] << ")\n";
+    return 1;
+}
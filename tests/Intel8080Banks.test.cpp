@@ -0,0 +1,122 @@
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "Intel8080BlockCache.h"
+#include "Intel8080Banks.h"
+#include "Intel8080Core.h"
+#include "Intel8080Scheduler.h"
+
+// Runs a program that switches the bank it's running from, with and without the block cache, checks writes land in the
+// right bank of the store, has a scheduler event switch the bank under the running code, then times switching a 16K
+// window.
+
+// 4000-7FFF is a window onto 4 banks of 16K selected by OUT 1, C000-FFFF is always the same RAM and OUT 0 halts
+struct Machine : Intel8080MemoryMap {
+    Machine()
+    {
+        mapRam(0xC0, common);
+        banks.addWindow(0x40, 0x40, 1);
+    }
+
+    static std::uint8_t in(std::uint8_t) { return 0U; }
+    void out(const std::uint8_t port, const std::uint8_t val) { banks.out(port, val); }
+
+    std::array<std::uint8_t, 0x4000> common {};
+    std::vector<std::uint8_t> store = std::vector<std::uint8_t>(4 * 0x4000);
+    Intel8080Banks banks {*this, store};
+};
+
+// C000 MVI A,1 / OUT 1 / MVI A,55 / STA 4000 / MVI A,0 / OUT 1 / LDA 4000 / MOV D,A / JMP 4000
+// 4000 in bank 0: MVI A,1 / OUT 1 / MVI C,AA / HLT, and from 4004 in bank 1: MVI C,BB / HLT
+template<class Policy>
+bool switches(Intel8080Core<Policy>& intel8080, Machine& machine)
+{
+    const std::uint8_t common[] {0x3E, 0x01, 0xD3, 0x01, 0x3E, 0x55, 0x32, 0x00, 0x40, 0x3E, 0x00, 0xD3, 0x01, 0x3A,
+                                 0x00, 0x40, 0x57, 0xC3, 0x00, 0x40};
+    const std::uint8_t bank0[] {0x3E, 0x01, 0xD3, 0x01, 0x0E, 0xAA, 0x76};
+    std::copy(std::begin(common), std::end(common), machine.common.begin());
+    std::copy(std::begin(bank0), std::end(bank0), machine.store.begin());
+    machine.store[0x4004] = 0x0E;
+    machine.store[0x4005] = 0xBB;
+    machine.store[0x4006] = 0x76;
+
+    intel8080.reset();
+    intel8080.pc = 0xC000;
+    intel8080.run(200);
+    return intel8080.getReg(Intel8080::C) == 0xBB and intel8080.getReg(Intel8080::D) == 0x3E
+           and machine.store[0x4000] == 0x55 and machine.banks.window(0).bank == 1 and machine.read(0x4000) == 0x55;
+}
+
+// 4000 in bank 0: INR B / JMP 4000, and in bank 1: INR C / JMP 4000, switched to bank 1 halfway by the host
+template<class Policy>
+std::pair<int, int> switchedFromOutside(Intel8080Core<Policy>& intel8080, Machine& machine)
+{
+    const std::uint8_t bank0[] {0x04, 0xC3, 0x00, 0x40};
+    const std::uint8_t bank1[] {0x0C, 0xC3, 0x00, 0x40};
+    std::copy(std::begin(bank0), std::end(bank0), machine.store.begin());
+    std::copy(std::begin(bank1), std::end(bank1), machine.store.begin() + 0x4000);
+    machine.banks.select(0, 0);
+
+    intel8080.reset();
+    intel8080.pc = 0x4000;
+    Intel8080Scheduler scheduler {};
+    scheduler.at(intel8080.clock() + 1000, [&](std::uint64_t) { machine.banks.select(0, 1); });
+    scheduler.run(intel8080, 2000);
+    return {intel8080.getReg(Intel8080::B), intel8080.getReg(Intel8080::C)};
+}
+
+int main()
+{
+    Intel8080Core<Machine> plain {};
+    if (!switches(plain, plain.bus)) {
+        std::cout << "FAIL: the program didn't see the banks it switched to\n";
+        return 1;
+    }
+
+    // the block at 4000 is decoded from bank 0 all the way to the HLT, and has to be thrown away by the OUT in it
+    Intel8080Core<Intel8080BlockCache<Machine>> cached {};
+    if (!switches(cached, cached.bus.policy)) {
+        std::cout << "FAIL: the block cache ran code from a bank that was switched out\n";
+        return 1;
+    }
+
+    // nothing the program does tells the cache the bank has changed, it has to notice when it looks up the next block
+    Intel8080Core<Machine> plainOutside {};
+    Intel8080Core<Intel8080BlockCache<Machine>> cachedOutside {};
+    const auto [b, c] {switchedFromOutside(plainOutside, plainOutside.bus)};
+    const auto [cachedB, cachedC] {switchedFromOutside(cachedOutside, cachedOutside.bus.policy)};
+    if (c == 0 or cachedB != b or cachedC != c) {
+        std::cout << "FAIL: after the scheduler switched banks, B=" << cachedB << " C=" << cachedC << " instead of B=" << b
+                  << " C=" << c << '\n';
+        return 1;
+    }
+
+    // a window without pages or bigger than the whole store has no bank to start out on
+    for (const std::size_t pages : {std::size_t {0}, std::size_t {0x101}}) {
+        Machine machine {};
+        try {
+            machine.banks.addWindow(0x80, pages, 2);
+            std::cout << "FAIL: added a window of " << pages << " pages onto a store of 256\n";
+            return 1;
+        } catch (const std::invalid_argument&) {
+        }
+    }
+
+    // through the cache, which looks for the pages that changed
+    constexpr int switches {1000000};
+    const auto begin {std::chrono::steady_clock::now()};
+    for (int i {0}; i < switches; ++i)
+        cached.bus.out(1, static_cast<std::uint8_t>(i));
+    const std::chrono::duration<double, std::nano> elapsed {std::chrono::steady_clock::now() - begin};
+    if (cached.bus.policy.banks.window(0).bank != (switches - 1) % 4 or cached.bus.policy.page(0x40) != &cached.bus.policy.store[0x4000 * 3]) {
+        std::cout << "FAIL: ended up on bank " << cached.bus.policy.banks.window(0).bank << '\n';
+        return 1;
+    }
+
+    std::cout << "*** switched banks under running code, a 16K switch takes " << elapsed.count() / switches << " ns\n";
+    return 0;
+}
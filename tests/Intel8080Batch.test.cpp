@@ -0,0 +1,133 @@
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Intel8080Batch.h"
+
+// Runs the diagnostics many times over on a pool of threads and checks every copy comes back with the same states,
+// instructions and output as running it alone, along with jobs that halt or run out of budget.
+
+static constexpr std::string testDirectory {"tests/binaries/"};
+
+// "out 1" is a CP/M call (print a character or a string), "out 0" is the end of the test
+void bdos(Intel8080Batch::Machine& machine, const std::uint8_t port, std::uint8_t)
+{
+    if (port == 0) {
+        machine.running = false;
+    } else if (machine.cpu.getReg(Intel8080::C) == 9) {
+        for (std::uint16_t addr {machine.cpu.getPair(Intel8080::DE)}; machine.memory[addr] != '$'; ++addr)
+            machine.output.push_back(machine.memory[addr]);
+    } else if (machine.cpu.getReg(Intel8080::C) == 2) {
+        machine.output.push_back(machine.cpu.getReg(Intel8080::E));
+    }
+}
+
+bool same(const Intel8080Batch::Result& a, const Intel8080Batch::Result& b)
+{
+    return a.cycles == b.cycles and a.instructions == b.instructions and a.output == b.output and a.exit == b.exit;
+}
+
+int main()
+{
+    std::vector<Intel8080Batch::Job> programs {};
+    for (const std::string testName : {"TST8080.COM", "8080PRE.COM", "CPUTEST.COM"}) {
+        std::ifstream file {testDirectory + testName, std::ios::binary};
+        if (!file.is_open()) {
+            std::cerr << "error: can't open file '" << testDirectory + testName
+                      << "'. Ensure you're in the correct directory: 'Intel8080/'.\n";
+            return 1;
+        }
+
+        Intel8080Batch::Job job {};
+        job.image.assign(std::istreambuf_iterator<char> {file}, std::istreambuf_iterator<char> {});
+        // the same "out 0,a" and "out 1,a; ret" as Intel8080.test.cpp
+        job.patches = {{0x0000, 0xD3}, {0x0001, 0x00}, {0x0005, 0xD3}, {0x0006, 0x01}, {0x0007, 0xC9}};
+        job.out = bdos;
+        programs.push_back(job);
+    }
+
+    // MVI A, 1; HLT
+    Intel8080Batch::Job halt {};
+    halt.image = {0x3E, 0x01, 0x76};
+    programs.push_back(halt);
+
+    // JMP 0100h, until the budget runs out
+    Intel8080Batch::Job loop {};
+    loop.image = {0xC3, 0x00, 0x01};
+    loop.cycleBudget = 100000;
+    programs.push_back(loop);
+
+    const std::vector<std::uint64_t> expectedCycles {4924, 7817, 255653383, 13, 100000};
+    const std::vector<Intel8080Batch::Exit> expectedExit {Intel8080Batch::Exit::stopped, Intel8080Batch::Exit::stopped,
+        Intel8080Batch::Exit::stopped, Intel8080Batch::Exit::halted, Intel8080Batch::Exit::budget};
+
+    std::vector<Intel8080Batch::Result> alone {};
+    for (std::size_t i {0}; i < programs.size(); ++i) {
+        alone.push_back(Intel8080Batch::run(programs[i]));
+        if (alone[i].cycles != expectedCycles[i] or alone[i].exit != expectedExit[i]) {
+            std::cout << "FAIL: job " << i << " took " << alone[i].cycles << " states (expected " << expectedCycles[i]
+                      << ")\n";
+            return 1;
+        }
+    }
+
+    // lots of the short ones around the long one, so the threads have something to steal
+    std::vector<Intel8080Batch::Job> jobs {};
+    std::vector<std::size_t> program {};
+    for (int i {0}; i < 200; ++i) {
+        const std::size_t which {i == 7 or i == 150 ? 2U : i % programs.size() == 2 ? 0U : i % programs.size()};
+        jobs.push_back(programs[which]);
+        program.push_back(which);
+    }
+
+    for (const unsigned threads : {1U, 4U, 0U}) {
+        const Intel8080Batch batch {threads};
+        const std::vector<Intel8080Batch::Result> results {batch.run(jobs)};
+        for (std::size_t i {0}; i < jobs.size(); ++i) {
+            if (!same(results[i], alone[program[i]])) {
+                std::cout << "FAIL: job " << i << " on " << batch.threads() << " threads took " << results[i].cycles
+                          << " states (expected " << alone[program[i]].cycles << ")\n";
+                return 1;
+            }
+        }
+        std::cout << "*** " << jobs.size() << " jobs on " << batch.threads() << " threads match\n";
+    }
+
+    // a job starts from the same registers after another one on the same thread as it does alone
+    // LXI SP, 1234h; LXI B, 5678h; LXI H, 9ABCh; MVI A, 42h; STC; EI; HLT
+    Intel8080Batch::Job dirty {};
+    dirty.image = {0x31, 0x34, 0x12, 0x01, 0x78, 0x56, 0x21, 0xBC, 0x9A, 0x3E, 0x42, 0x37, 0xFB, 0x76};
+    // OUT 1; HLT, with the handler noting down registers the job never set
+    Intel8080Batch::Job probe {};
+    probe.image = {0xD3, 0x01, 0x76};
+    probe.out = [](Intel8080Batch::Machine& machine, std::uint8_t, std::uint8_t) {
+        const Intel8080& cpu {machine.cpu};
+        for (const std::uint8_t r : {Intel8080::A, Intel8080::F, Intel8080::B, Intel8080::C, Intel8080::H, Intel8080::L})
+            machine.output.push_back(static_cast<std::uint8_t>(cpu.getReg(r)));
+        machine.output.push_back(static_cast<std::uint8_t>(cpu.getPair(Intel8080::SP) >> 8U));
+        machine.output.push_back(static_cast<std::uint8_t>((cpu.pins & Intel8080::INTE) != 0));
+    };
+    const Intel8080Batch::Result fresh {Intel8080Batch::run(probe)};
+    // a thread runs its own jobs from the back, so the probe goes second
+    const std::vector<Intel8080Batch::Result> after {Intel8080Batch {1}.run({probe, dirty})};
+    if (fresh.output.size() != 8 or fresh.output[0] != 0 or !same(after[0], fresh)) {
+        std::cout << "FAIL: a job saw the registers the job before it on the same thread left behind\n";
+        return 1;
+    }
+    std::cout << "*** every job starts from a fresh processor\n";
+
+    // a handler that throws doesn't take the pool down with it
+    jobs[100].out = [](Intel8080Batch::Machine&, std::uint8_t, std::uint8_t) { throw std::runtime_error {"out"}; };
+    try {
+        (void)Intel8080Batch {4}.run(jobs);
+        std::cout << "FAIL: the exception got lost\n";
+        return 1;
+    } catch (const std::runtime_error&) {
+        std::cout << "*** the exception made it out of the pool\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <vector>
+#include "Intel8080Core.h"
+
+// Only built with INTEL8080_COUNTERS. Runs TST8080 through tick() and step() and checks both count every opcode, state
+// and branch the same way and add up to the totals of the diagnostic, then that wait states, halts and interrupts are
+// counted as well.
+
+using Memory = std::array<std::uint8_t, 0x10000>;
+
+static constexpr std::string testDirectory {"tests/binaries/"};
+
+// "out 0" ends the diagnostic, anything else is thrown away
+struct Machine {
+    std::uint8_t read(const std::uint16_t addr) const { return memory[addr]; }
+    void write(const std::uint16_t addr, const std::uint8_t val) { memory[addr] = val; }
+    static std::uint8_t in(std::uint8_t) { return 0U; }
+    void out(const std::uint8_t port, std::uint8_t) { running = running and port != 0; }
+
+    Memory memory {};
+    bool running {true};
+};
+
+// takes the interrupt off the INT pin once it's acknowledged
+struct Interrupted {
+    std::uint8_t read(const std::uint16_t addr) const { return (*memory)[addr]; }
+    void write(const std::uint16_t addr, const std::uint8_t val) { (*memory)[addr] = val; }
+    static std::uint8_t in(std::uint8_t) { return 0U; }
+    static void out(std::uint8_t, std::uint8_t) {}
+
+    std::uint8_t acknowledge()
+    {
+        cpu->pins &= ~Intel8080::INT;
+        return 0xFFU; // RST 7
+    }
+
+    Memory* memory {nullptr};
+    Intel8080* cpu {nullptr};
+};
+
+std::uint64_t sum(const std::array<std::uint64_t, 256>& counts)
+{
+    return std::accumulate(counts.begin(), counts.end(), std::uint64_t {0});
+}
+
+// runs a state at a time until "out 0", pulling READY low for the given number of states at every machine cycle
+std::uint64_t tick(Intel8080& intel8080, Machine& machine, const unsigned waitStates)
+{
+    std::uint64_t cycles {0};
+    unsigned waiting {0};
+    while (machine.running) {
+        intel8080.tick();
+        ++cycles;
+        if (intel8080.pins & Intel8080::SYNC)
+            waiting = waitStates;
+        if (waiting != 0) {
+            --waiting;
+            intel8080.pins &= ~Intel8080::READY;
+        } else {
+            intel8080.pins |= Intel8080::READY;
+        }
+        if (intel8080.pins & Intel8080::DBIN)
+            intel8080.setDBus(std::uint_fast8_t {intel8080.status == Intel8080::inputRead ? std::uint8_t {0}
+                : machine.read(intel8080.getABus())});
+        else if (intel8080.pins & Intel8080::WR and intel8080.status == Intel8080::outputWrite)
+            machine.out(intel8080.getABus() & 0xFFU, intel8080.getDBus());
+        else if (intel8080.pins & Intel8080::WR)
+            machine.write(intel8080.getABus(), intel8080.getDBus());
+    }
+    // finish the last machine cycle, like Intel8080.test.cpp, which might be waiting
+    intel8080.pins |= Intel8080::READY;
+    for (bool waited {true}; waited; ++cycles) {
+        waited = intel8080.pins & Intel8080::WAIT;
+        intel8080.tick();
+    }
+    return cycles;
+}
+
+int main()
+{
+    std::ifstream file {testDirectory + "TST8080.COM", std::ios::binary};
+    if (!file.is_open()) {
+        std::cerr << "error: can't open file '" << testDirectory + "TST8080.COM"
+                  << "'. Ensure you're in the correct directory: 'Intel8080/'.\n";
+        return 1;
+    }
+    const std::vector<std::uint8_t> image {std::istreambuf_iterator<char> {file}, std::istreambuf_iterator<char> {}};
+    Machine machine {};
+    std::copy(image.begin(), image.end(), machine.memory.begin() + 0x100);
+    // "out 0,a" at 0x0000 and "out 1,a; ret" at 0x0005
+    for (const auto& [addr, val] : {std::pair {0x0000, 0xD3}, {0x0001, 0x00}, {0x0005, 0xD3}, {0x0006, 0x01}, {0x0007, 0xC9}})
+        machine.memory[addr] = val;
+
+    // a state at a time
+    Intel8080 ticked {};
+    ticked.reset();
+    ticked.pc = 0x100;
+    Machine tickedMachine {machine};
+    const std::uint64_t tickedCycles {tick(ticked, tickedMachine, 0)};
+    const Intel8080Counters byTick {ticked.counters()};
+
+    // an instruction at a time
+    Intel8080Core<Machine> stepped {machine};
+    stepped.reset();
+    stepped.pc = 0x100;
+    std::uint64_t steppedCycles {0};
+    while (stepped.bus.running)
+        steppedCycles += stepped.step();
+    const Intel8080Counters byStep {stepped.counters()};
+
+    for (const Intel8080Counters* counters : {&byTick, &byStep}) {
+        const char* engine {counters == &byTick ? "tick()" : "step()"};
+        if (sum(counters->executed) != 651 or sum(counters->states) != 4924 or counters->waitStates != 0) {
+            std::cout << "FAIL: " << engine << " counted " << sum(counters->executed) << " instructions on "
+                      << sum(counters->states) << " states (expected 651 on 4924)\n";
+            return 1;
+        }
+    }
+    if (tickedCycles != 4924 or steppedCycles != 4924 or byTick.executed != byStep.executed
+        or byTick.states != byStep.states or byTick.taken != byStep.taken or byTick.notTaken != byStep.notTaken
+        or byTick.taken == 0 or byTick.notTaken == 0) {
+        std::cout << "FAIL: tick() and step() counted TST8080.COM differently\n";
+        return 1;
+    }
+    std::cout << byStep.report(10);
+
+    // wait states count towards the instruction that waited
+    Intel8080 waited {};
+    waited.reset();
+    waited.pc = 0x100;
+    Machine waitedMachine {machine};
+    const std::uint64_t waitedCycles {tick(waited, waitedMachine, 2)};
+    const Intel8080Counters slow {waited.counters()};
+    if (sum(slow.states) != waitedCycles or slow.waitStates != waitedCycles - 4924 or slow.executed != byTick.executed) {
+        std::cout << "FAIL: counted " << slow.waitStates << " wait states (expected " << waitedCycles - 4924 << ")\n";
+        return 1;
+    }
+
+    // HLT keeps the states spent halted, and every interrupt is counted: 0000 EI / HLT / JMP 0000, 0038 EI / RET
+    Memory memory {};
+    for (const auto& [addr, val] : {std::pair {0x0000, 0xFB}, {0x0001, 0x76}, {0x0002, 0xC3}, {0x0038, 0xFB}, {0x0039, 0xC9}})
+        memory[addr] = val;
+    Intel8080Core<Interrupted> idle {};
+    idle.bus = {&memory, &idle};
+    idle.reset();
+    std::uint64_t idleCycles {0};
+    for (int i {0}; i < 10; ++i) {
+        idleCycles += idle.run(1000);
+        idle.pins |= Intel8080::INT;
+    }
+    idleCycles += idle.run(1000); // takes the last one
+    const Intel8080Counters counters {idle.counters()};
+    if (counters.interrupts != 10 or counters.executed[0xFF] != 10 or sum(counters.states) != idleCycles
+        or counters.states[0x76] < 10 * 900) {
+        std::cout << "FAIL: counted " << counters.interrupts << " interrupts and " << counters.states[0x76]
+                  << " halted states\n";
+        return 1;
+    }
+
+    idle.resetCounters();
+    if (sum(idle.counters().states) != 0) {
+        std::cout << "FAIL: the counters weren't reset\n";
+        return 1;
+    }
+
+    std::cout << "*** counted every instruction, state, branch and interrupt\n";
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "Intel8080BlockCache.h"
+#include "Intel8080Core.h"
+#include "Intel8080Jit.h"
+
+// Runs the same programs on the plain instruction-stepped engine and on the block cache and the translator, in the same
+// random-sized slices, and checks they always agree on the states elapsed, every register and memory.
+
+using Memory = std::array<std::uint8_t, 0x10000>;
+
+static constexpr std::string testDirectory {"tests/binaries/"};
+
+struct Machine {
+    Memory memory {};
+    bool running {true};
+    // page 80h is a device instead of memory: reads count up and writes are latched
+    std::uint8_t counter {0}, latch {0};
+};
+
+struct Ram {
+    std::uint8_t read(std::uint16_t addr) { return addr >> 8U == 0x80 ? machine->counter++ : machine->memory[addr]; }
+    void write(std::uint16_t addr, std::uint8_t val) { (addr >> 8U == 0x80 ? machine->latch : machine->memory[addr]) = val; }
+    static std::uint8_t in(std::uint8_t) { return 0U; }
+    void out(std::uint8_t port, std::uint8_t) { if (port == 0) machine->running = false; }
+    std::uint8_t* memory() { return machine->memory.data(); }
+
+    Machine* machine;
+};
+
+bool same(const Intel8080& plain, const Intel8080& fast)
+{
+    for (const std::uint8_t r : {Intel8080::A, Intel8080::F})
+        if (plain.getReg(r) != fast.getReg(r))
+            return false;
+    for (const std::uint8_t rp : {Intel8080::BC, Intel8080::DE, Intel8080::HL, Intel8080::SP, Intel8080::WZ})
+        if (plain.getPair(rp) != fast.getPair(rp))
+            return false;
+    return plain.pc == fast.pc and plain.ir == fast.ir;
+}
+
+template<class Policy>
+bool compare(const std::string& engine, const std::string& name, const Memory& program)
+{
+    auto machine {std::make_unique<std::array<Machine, 2>>()};
+    (*machine)[0].memory = (*machine)[1].memory = program;
+
+    Intel8080Core<Ram> plain {Ram {&(*machine)[0]}};
+    Intel8080Core<Policy> fast {Policy {Ram {&(*machine)[1]}}};
+    if constexpr (requires { fast.bus.mmio(0x80); })
+        fast.bus.mmio(0x80);
+    for (Intel8080* intel8080 : {static_cast<Intel8080*>(&plain), static_cast<Intel8080*>(&fast)}) {
+        intel8080->reset();
+        intel8080->pc = 0x100U;
+    }
+
+    std::uint64_t elapsed[2] {0, 0};
+    std::uint32_t seed {1};
+    while ((*machine)[0].running or (*machine)[1].running) {
+        seed = seed * 1103515245U + 12345U;
+        const std::uint64_t slice {1 + (seed >> 16U) % 200};
+        elapsed[0] += plain.run(slice);
+        elapsed[1] += fast.run(slice);
+        if (elapsed[0] != elapsed[1] or (*machine)[0].running != (*machine)[1].running or !same(plain, fast)) {
+            std::cout << "FAIL: " << name << " differs with " << engine << " after " << elapsed[0] << " states ("
+                      << elapsed[1] << "), pc=" << std::hex << plain.pc << " (" << fast.pc << ")\n" << std::dec;
+            return false;
+        }
+    }
+    if ((*machine)[0].memory != (*machine)[1].memory or (*machine)[0].counter != (*machine)[1].counter
+        or (*machine)[0].latch != (*machine)[1].latch) {
+        std::cout << "FAIL: " << name << " memory differs with " << engine << '\n';
+        return false;
+    }
+
+    std::cout << "*** " << name << " with " << engine << ": " << elapsed[0] << " states match\n";
+    return true;
+}
+
+bool compare(const std::string& name, const Memory& program)
+{
+    return compare<Intel8080BlockCache<Ram>>("the block cache", name, program)
+        and compare<Intel8080Jit<Ram>>("the translator", name, program);
+}
+
+int main()
+{
+    // MVI A, 0; STA 0106h; MVI B, 55h; OUT 0 - the store rewrites the MVI B it's decoded along with
+    constexpr std::uint8_t selfModifying[] {0x3E, 0x00, 0x32, 0x06, 0x01, 0x06, 0x55, 0xD3, 0x00};
+
+    Memory memory {};
+    std::copy(std::begin(selfModifying), std::end(selfModifying), memory.begin() + 0x100);
+    if (!compare("self-modifying code", memory))
+        return 1;
+
+    // LXI H, 8000h; MVI C, 40h; loop: MOV A, M; ADD B; MOV B, A; MOV M, A; DCR C; JNZ loop; OUT 0 - every access to
+    // the device has to go through the bus, even once the loop is hot
+    constexpr std::uint8_t device[] {0x21, 0x00, 0x80, 0x0E, 0x40, 0x7E, 0x80, 0x47, 0x77, 0x0D, 0xC2, 0x05, 0x01, 0xD3, 0x00};
+    memory = {};
+    std::copy(std::begin(device), std::end(device), memory.begin() + 0x100);
+    if (!compare("memory mapped I/O", memory))
+        return 1;
+
+    for (const std::string testName : {"TST8080.COM", "8080PRE.COM", "CPUTEST.COM"}) {
+        memory = {};
+        std::ifstream file {testDirectory + testName, std::ios::binary};
+        if (!file.is_open()) {
+            std::cerr << "error: can't open file '" << testDirectory + testName
+                      << "'. Ensure you're in the correct directory: 'Intel8080/'.\n";
+            return 1;
+        }
+        file.read(reinterpret_cast<char*>(&memory[0x100]), memory.size() - 0x100);
+
+        // the same "out 0,a" and "out 1,a; ret" as Intel8080.test.cpp, the output is ignored
+        memory[0x0000] = 0xD3;
+        memory[0x0001] = 0x00;
+        memory[0x0005] = 0xD3;
+        memory[0x0006] = 0x01;
+        memory[0x0007] = 0xC9;
+        if (!compare(testName, memory))
+            return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include "Intel8080Core.h"
+
+// Checks the table-driven flags against the original branch-per-flag functions for every accumulator, operand and
+// incoming flags combination. Each instruction is followed by one that reads or keeps the flags it left, and the flags
+// are read back through the accessors as well as F, since S, Z and P are only worked out when they're read.
+
+struct Ram {
+    std::uint8_t read(std::uint16_t addr) const { return memory[addr]; }
+    void write(std::uint16_t addr, std::uint8_t val) { memory[addr] = val; }
+    static std::uint8_t in(std::uint8_t) { return 0U; }
+    static void out(std::uint8_t, std::uint8_t) {}
+
+    std::array<std::uint8_t, 0x10000> memory {};
+};
+
+// the flag functions as they were before the lookup tables
+struct Reference {
+    static constexpr std::uint8_t zeroBit {0b01000000U};
+    static constexpr std::uint8_t signBit {0b10000000U};
+    static constexpr std::uint8_t parityBit {0b00000100U};
+    static constexpr std::uint8_t carryBit {0b00000001U};
+    static constexpr std::uint8_t auxiliaryBit {0b00010000U};
+
+    void setFlag(const std::uint8_t bit, const bool enabled) { enabled ? f |= bit : f &= ~bit; }
+    [[nodiscard]] std::uint8_t cy() const { return f & carryBit; }
+    [[nodiscard]] std::uint8_t ac() const { return (f & auxiliaryBit) >> 4U; }
+
+    void zspFlags(const std::uint8_t val)
+    {
+        setFlag(zeroBit, val == 0);
+        setFlag(signBit, val & 0x80U);
+        setFlag(parityBit, std::popcount(val) % 2 == 0);
+    }
+
+    void carryFlagsAdd(const std::uint8_t addend, const std::uint8_t carry = 0)
+    {
+        std::uint16_t res {static_cast<uint16_t>(a + addend + carry)};
+        setFlag(auxiliaryBit, (a ^ addend ^ res) & 0x10U);
+        setFlag(carryBit, res > 0xFF);
+    }
+
+    void carryFlagsSub(const std::uint8_t subtrahend, const std::uint8_t carry = 0)
+    {
+        std::uint16_t res {static_cast<uint16_t>(a - subtrahend - carry)};
+        setFlag(auxiliaryBit, ~(a ^ subtrahend ^ res) & 0x10U);
+        setFlag(carryBit, a < subtrahend + carry);
+    }
+
+    void execute(const std::uint8_t op, const std::uint8_t v)
+    {
+        switch (op) {
+            case 0x80: carryFlagsAdd(v); a += v; zspFlags(a); break;
+            case 0x88: { const std::uint8_t carry {cy()}; carryFlagsAdd(v, carry); a += v + carry; zspFlags(a); break; }
+            case 0x90: carryFlagsSub(v); a -= v; zspFlags(a); break;
+            case 0x98: { const std::uint8_t carry {cy()}; carryFlagsSub(v, carry); a = a - v - carry; zspFlags(a); break; }
+            case 0xA0: case 0xE6:
+                setFlag(auxiliaryBit, (a | v) & 0b1000U);
+                setFlag(carryBit, false);
+                a &= v;
+                zspFlags(a);
+                break;
+            case 0xA8: setFlag(auxiliaryBit, false); setFlag(carryBit, false); a ^= v; zspFlags(a); break;
+            case 0xB0: setFlag(auxiliaryBit, false); setFlag(carryBit, false); a |= v; zspFlags(a); break;
+            case 0xB8: carryFlagsSub(v); zspFlags(a - v); break;
+            case 0x3C: ++a; setFlag(auxiliaryBit, (a & 0xFU) == 0); zspFlags(a); break;
+            case 0x3D: --a; setFlag(auxiliaryBit, (a & 0xFU) != 0xF); zspFlags(a); break;
+            case 0x27: {
+                std::uint8_t addend {0};
+                std::uint8_t msb {static_cast<uint8_t>(a & 0xF0)}, lsb {static_cast<uint8_t>(a & 0xF)};
+                if (lsb > 9 or ac())
+                    addend = 6U;
+                setFlag(auxiliaryBit, lsb + addend > 0xF);
+                if (msb > 0x90 or cy() or (msb >= 0x90 and lsb > 9)) {
+                    addend += 0x60U;
+                    setFlag(carryBit, true);
+                }
+                a += addend;
+                zspFlags(a);
+                break;
+            }
+            case 0x07: setFlag(carryBit, a & 0x80); a = (a << 1U) | cy(); break;
+            case 0x0F: setFlag(carryBit, a & 0x01); a = (a >> 1U) | (cy() << 7U); break;
+            case 0x17: { const std::uint8_t carry {cy()}; setFlag(carryBit, a & 0x80); a = (a << 1U) | carry; break; }
+            case 0x1F: { const std::uint8_t carry {cy()}; setFlag(carryBit, a & 0x01); a = (a >> 1U) | (carry << 7U); break; }
+            case 0x3F: setFlag(carryBit, !cy()); break;
+            case 0x37: setFlag(carryBit, true); break;
+            case 0x09: setFlag(carryBit, hl + bc > 0xFFFF); hl = hl + bc; break;
+            default: break;
+        }
+    }
+
+    std::uint8_t a, f;
+    std::uint16_t bc, hl;
+};
+
+int main()
+{
+    // ADD, ADC, SUB, SBB, ANA, XRA, ORA and CMP with B, and ANI
+    constexpr std::uint8_t binary[] {0x80, 0x88, 0x90, 0x98, 0xA0, 0xA8, 0xB0, 0xB8, 0xE6, 0x09};
+    // INR A, DCR A, DAA, RLC, RRC, RAL, RAR, CMC and STC
+    constexpr std::uint8_t unary[] {0x3C, 0x3D, 0x27, 0x07, 0x0F, 0x17, 0x1F, 0x3F, 0x37};
+    // incoming flags, every combination of AC and CY with S, Z and P both set and reset
+    constexpr std::uint8_t flags[] {0x02, 0x03, 0x12, 0x13, 0xC6, 0xC7, 0xD6, 0xD7};
+    // NOP, and RAL, CMC and DAD B that leave S, Z and P alone, and DAA and INR A that read AC and CY or keep CY
+    constexpr std::uint8_t then[] {0x00, 0x17, 0x3F, 0x09, 0x27, 0x3C};
+
+    static Intel8080Core<Ram> intel8080 {};
+    auto& memory {intel8080.bus.memory};
+
+    // LXI SP, 0100h; POP PSW; POP B; POP H; <op> <data>; <then>
+    constexpr std::uint8_t program[] {0x31, 0x00, 0x01, 0xF1, 0xC1, 0xE1};
+    std::copy(std::begin(program), std::end(program), memory.begin());
+
+    unsigned long checked {0};
+    auto check {[&](const std::uint8_t op, const std::uint8_t a, const std::uint8_t v, const std::uint8_t f) {
+        Reference expected {a, f, static_cast<std::uint16_t>(v << 8U | a), static_cast<std::uint16_t>(a << 8U | v)};
+        const std::uint8_t next {then[(a + v + checked) % std::size(then)]};
+        expected.execute(op, v);
+        expected.execute(next, v);
+
+        memory[0x100] = f;
+        memory[0x101] = a;
+        memory[0x102] = a;
+        memory[0x103] = v;
+        memory[0x104] = v;
+        memory[0x105] = a;
+        memory[6] = op;
+        memory[7] = v;
+        memory[op == 0xE6 ? 8 : 7] = next;
+        intel8080.pc = 0;
+        for (int i {0}; i < 6; ++i)
+            intel8080.step();
+        ++checked;
+
+        const std::uint8_t got {intel8080.getReg(Intel8080::F)};
+        const bool accessors {intel8080.s() == got >> 7U and intel8080.z() == (got >> 6U & 1U)
+                              and intel8080.ac() == (got >> 4U & 1U) and intel8080.p() == (got >> 2U & 1U)
+                              and intel8080.cy() == (got & 1U)};
+        if (intel8080.getReg(Intel8080::A) == expected.a and got == expected.f and accessors
+            and intel8080.getPair(Intel8080::HL) == expected.hl)
+            return true;
+
+        std::cout << std::hex << std::setfill('0')
+                  << "FAIL: op=" << std::setw(2) << +op << " then " << std::setw(2) << +next << " a=" << std::setw(2) << +a << " v=" << std::setw(2) << +v
+                  << " f=" << std::setw(2) << +f << ": expected a=" << std::setw(2) << +expected.a << " f="
+                  << std::setw(2) << +expected.f << " hl=" << std::setw(4) << expected.hl << ", got a=" << std::setw(2)
+                  << +intel8080.getReg(Intel8080::A) << " f=" << std::setw(2) << +intel8080.getReg(Intel8080::F)
+                  << " hl=" << std::setw(4) << intel8080.getPair(Intel8080::HL) << '\n';
+        return false;
+    }};
+
+    for (const std::uint8_t f : flags) {
+        for (int a {0}; a < 256; ++a) {
+            for (const std::uint8_t op : unary)
+                if (!check(op, a, 0, f)) return 1;
+            for (int v {0}; v < 256; ++v)
+                for (const std::uint8_t op : binary)
+                    if (!check(op, a, v, f)) return 1;
+        }
+    }
+
+    std::cout << std::dec << "*** " << checked << " flag results match\n";
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include "Intel8080Core.h"
+#include "Intel8080InterruptController.h"
+#include "Intel8080Scheduler.h"
+
+// Checks priorities, masking and end-of-interrupt against the INT pin, then runs a program that programs the controller
+// through its ports and serves two timers from the scheduler on a masked third, with step() and with runUntil().
+
+using Memory = std::array<std::uint8_t, 0x10000>;
+
+constexpr std::uint64_t duration {200000};
+
+// 0000 JMP 0200, past the RSTs
+// 0200 LXI SP,F000 / MVI A,13 / OUT 20 / XRA A / OUT 21 / MVI A,01 / OUT 21 (ICW1, ICW2 and ICW4, a single 8259)
+// 020E MVI A,40 / OUT 21 (mask level 6) / EI / HLT / JMP 0213
+// RST n for level n jumps to 0100 + 10n: PUSH PSW / PUSH H / LXI H,1000+n / INR M / MVI A,20 / OUT 20 (EOI) / POP H /
+// POP PSW / EI / RET, so 1000-1007 count each level's interrupts
+Memory program()
+{
+    Memory memory {};
+    const auto put {[&memory](std::uint16_t addr, std::initializer_list<std::uint8_t> code) {
+        for (const std::uint8_t byte : code)
+            memory[addr++] = byte;
+    }};
+    put(0x0000, {0xC3, 0x00, 0x02});
+    put(0x0200, {0x31, 0x00, 0xF0, 0x3E, 0x13, 0xD3, 0x20, 0xAF, 0xD3, 0x21, 0x3E, 0x01, 0xD3, 0x21});
+    put(0x020E, {0x3E, 0x40, 0xD3, 0x21, 0xFB, 0x76, 0xC3, 0x13, 0x02});
+    for (std::uint8_t level {1}; level < 8; ++level) {
+        const auto handler {static_cast<std::uint8_t>(level * 0x10)};
+        put(level * 8, {0xC3, handler, 0x01});
+        put(0x0100 + handler, {0xF5, 0xE5, 0x21, level, 0x10, 0x34, 0x3E, 0x20, 0xD3, 0x20, 0xE1, 0xF1, 0xFB, 0xC9});
+    }
+    return memory;
+}
+
+struct Machine {
+    std::uint8_t read(const std::uint16_t addr) const { return memory[addr]; }
+    void write(const std::uint16_t addr, const std::uint8_t val) { memory[addr] = val; }
+    std::uint8_t in(const std::uint8_t port) const { return pic->in(port).value_or(0xFFU); }
+    void out(const std::uint8_t port, const std::uint8_t val) const { pic->out(port, val); }
+    std::uint8_t acknowledge() const { return pic->acknowledge(); }
+
+    Memory memory {program()};
+    Intel8080InterruptController* pic {nullptr};
+};
+
+// level 1 every 1000 states, level 4 every 2500 and the masked level 6 every 700
+void timers(Intel8080Scheduler& scheduler, Intel8080InterruptController& pic)
+{
+    scheduler.every(1000, 1000, [&pic](std::uint64_t) { pic.requestInterrupt(1); });
+    scheduler.every(2500, 2500, [&pic](std::uint64_t) { pic.requestInterrupt(4); });
+    scheduler.every(700, 700, [&pic](std::uint64_t) { pic.requestInterrupt(6); });
+}
+
+bool counted(const Memory& memory, const Intel8080InterruptController& pic)
+{
+    return memory[0x1001] == (duration - 1) / 1000 % 256 and memory[0x1004] == (duration - 1) / 2500 % 256
+           and memory[0x1006] == 0 and pic.requests() == 0x40 and pic.inService() == 0 and pic.mask() == 0x40;
+}
+
+int main()
+{
+    Intel8080 intel8080 {};
+    Intel8080InterruptController pic {intel8080};
+    const auto interrupting {[&intel8080] { return (intel8080.pins & Intel8080::INT) != 0; }};
+
+    pic.requestInterrupt(5);
+    if (!interrupting() or pic.acknowledge() != Intel8080InterruptController::rst(5) or interrupting()) {
+        std::cout << "FAIL: a request didn't raise INT until it was acknowledged\n";
+        return 1;
+    }
+    // less important than what's in service waits, more important goes ahead
+    pic.requestInterrupt(7);
+    const bool waited {!interrupting()};
+    pic.requestInterrupt(2);
+    if (!waited or !interrupting() or pic.acknowledge() != 0xD7 or pic.inService() != 0x24) {
+        std::cout << "FAIL: level 7 or level 2 didn't get the right priority over level 5 in service\n";
+        return 1;
+    }
+    pic.endOfInterrupt();
+    const bool stillFive {!interrupting() and pic.inService() == 0x20};
+    pic.endOfInterrupt(5);
+    if (!stillFive or !interrupting()) {
+        std::cout << "FAIL: end-of-interrupt didn't let level 7 through once level 5 was done\n";
+        return 1;
+    }
+    pic.setMask(0x80);
+    const bool masked {!interrupting()};
+    pic.setMask(0x00);
+    if (!masked or pic.acknowledge() != 0xFF or pic.requests() != 0 or pic.acknowledge() != 0xFF
+        or pic.inService() != 0x80) {
+        std::cout << "FAIL: masking or the spurious interrupt doesn't work\n";
+        return 1;
+    }
+
+    // an instruction at a time
+    Intel8080Core<Machine> stepped {};
+    Intel8080InterruptController steppedPic {stepped};
+    stepped.bus.pic = &steppedPic;
+    stepped.reset();
+    Intel8080Scheduler scheduler {};
+    timers(scheduler, steppedPic);
+    scheduler.run(stepped, duration);
+    if (!counted(stepped.bus.memory, steppedPic)) {
+        std::cout << "FAIL: served " << +stepped.bus.memory[0x1001] << " and " << +stepped.bus.memory[0x1004]
+                  << " interrupts with step()\n";
+        return 1;
+    }
+
+    // a state at a time, with the controller answering the acknowledge
+    Memory memory {program()};
+    Intel8080 ticked {};
+    Intel8080InterruptController tickedPic {ticked};
+    ticked.reset();
+    Intel8080Scheduler ticker {};
+    timers(ticker, tickedPic);
+    for (std::uint64_t elapsed {0}; elapsed < duration;) {
+        elapsed += ticker.runUntil(ticked, Intel8080::DBIN | Intel8080::WR, duration - elapsed);
+        if (tickedPic.access(ticked))
+            continue;
+        if (ticked.pins & Intel8080::DBIN and ticked.status == Intel8080::inputRead)
+            ticked.setDBus(std::uint_fast8_t {tickedPic.in(ticked.getABus() & 0xFFU).value_or(0xFFU)});
+        else if (ticked.pins & Intel8080::DBIN)
+            ticked.setDBus(std::uint_fast8_t {memory[ticked.getABus()]});
+        else if (ticked.pins & Intel8080::WR and ticked.status == Intel8080::outputWrite)
+            tickedPic.out(ticked.getABus() & 0xFFU, ticked.getDBus());
+        else if (ticked.pins & Intel8080::WR)
+            memory[ticked.getABus()] = ticked.getDBus();
+    }
+    if (!counted(memory, tickedPic)) {
+        std::cout << "FAIL: served " << +memory[0x1001] << " and " << +memory[0x1004] << " interrupts with tick()\n";
+        return 1;
+    }
+
+    std::cout << "*** served " << (duration - 1) / 1000 + (duration - 1) / 2500
+              << " interrupts on 2 levels and none on the masked one\n";
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Intel8080Core.h"
+#include "Intel8080Lockstep.h"
+
+// Runs random code on every lane of the lockstep engine, with the registers and most of memory different in each lane so
+// the lanes keep splitting up and meeting again, and checks each lane against Intel8080Core running it alone. Then runs
+// the diagnostics in every lane.
+
+using Memory = std::array<std::uint8_t, 0x10000>;
+
+static constexpr std::string testDirectory {"tests/binaries/"};
+static constexpr std::size_t lanes {16};
+
+// IN reads something different in each lane, OUT keeps a running sum of what it's given
+struct LaneIo {
+    std::uint8_t in(const std::size_t lane, const std::uint8_t port) const { return port * 7U + lane; }
+    void out(const std::size_t lane, const std::uint8_t port, const std::uint8_t val) { sum[lane] += port ^ val; }
+
+    std::array<unsigned, lanes> sum {};
+};
+
+struct Ram {
+    std::uint8_t read(const std::uint16_t addr) const { return (*memory)[addr]; }
+    void write(const std::uint16_t addr, const std::uint8_t val) const { (*memory)[addr] = val; }
+    std::uint8_t in(const std::uint8_t port) const { return port * 7U + lane; }
+    void out(const std::uint8_t port, const std::uint8_t val) { sum += port ^ val; }
+
+    Memory* memory;
+    std::size_t lane;
+    unsigned sum {0};
+};
+
+std::uint32_t random(std::uint32_t& seed)
+{
+    seed = seed * 1103515245U + 12345U;
+    return seed >> 16U;
+}
+
+bool jumps(const std::uint8_t opcode)
+{
+    return (opcode & 0xC7U) == 0xC2 or (opcode & 0xC7U) == 0xC4 or opcode == 0xC3 or opcode == 0xCB
+        or (opcode & 0xCFU) == 0xCD;
+}
+
+bool same(const Intel8080Lockstep<lanes, LaneIo>& lockstep, const std::size_t lane, const Intel8080Core<Ram>& alone,
+    const std::uint64_t elapsed)
+{
+    for (const std::uint8_t r : {Intel8080::A, Intel8080::F})
+        if (lockstep.getReg(lane, r) != alone.getReg(r))
+            return false;
+    for (const std::uint8_t rp : {Intel8080::BC, Intel8080::DE, Intel8080::HL, Intel8080::SP, Intel8080::WZ})
+        if (lockstep.getPair(lane, rp) != alone.getPair(rp))
+            return false;
+    if (lockstep.pc[lane] != alone.pc or lockstep.cycles[lane] != elapsed or lockstep.bus.sum[lane] != alone.bus.sum)
+        return false;
+    for (int addr {0}; addr < 0x10000; ++addr)
+        if (lockstep.read(lane, addr) != (*alone.bus.memory)[addr])
+            return false;
+    return true;
+}
+
+// runs every lane from start for the budget or until it halts, then each lane alone on Intel8080Core
+bool compare(const std::string& name, std::array<Memory, lanes>& memories, const std::uint16_t start,
+    const std::uint64_t budget)
+{
+    auto lockstep {std::make_unique<Intel8080Lockstep<lanes, LaneIo>>()};
+    for (std::size_t lane {0}; lane < lanes; ++lane) {
+        for (int addr {0}; addr < 0x10000; ++addr)
+            lockstep->write(lane, addr, memories[lane][addr]);
+        lockstep->pc[lane] = start;
+    }
+    lockstep->run(budget);
+
+    for (std::size_t lane {0}; lane < lanes; ++lane) {
+        Intel8080Core<Ram> alone {Ram {&memories[lane], lane}};
+        alone.reset();
+        alone.pc = start;
+
+        std::uint64_t elapsed {0};
+        while (elapsed < budget and alone.ir != 0x76)
+            elapsed += alone.step();
+        if (!same(*lockstep, lane, alone, elapsed)) {
+            std::cout << "FAIL: lane " << lane << " of " << name << " differs after " << elapsed << " states ("
+                      << lockstep->cycles[lane] << "), pc=" << std::hex << alone.pc << " (" << lockstep->pc[lane]
+                      << ")\n" << std::dec;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    auto memories {std::make_unique<std::array<Memory, lanes>>()};
+
+    for (std::uint32_t round {0}; round < 20; ++round) {
+        // 100h-1FFh is the same code in every lane: random instructions other than HLT, with the jumps and calls kept
+        // inside it
+        std::uint32_t seed {round + 1};
+        std::vector<std::uint8_t> code {};
+        while (code.size() < 0xF0) {
+            const std::uint8_t opcode = random(seed);
+            code.push_back(opcode == 0x76 ? 0x00 : opcode);
+            if (Intel8080::length(opcode) > 1)
+                code.push_back(random(seed));
+            if (Intel8080::length(opcode) > 2)
+                code.push_back(jumps(opcode) ? 0x01 : random(seed));
+        }
+        code.resize(0x100, 0x00);
+
+        // the rest of memory is different in every lane, and so are the registers, which are popped off the stack by
+        // LXI SP, 0040h; POP PSW; POP B; POP D; POP H; LXI SP, sp; JMP 0100h at 0080h
+        for (std::size_t lane {0}; lane < lanes; ++lane) {
+            Memory& memory {(*memories)[lane]};
+            std::uint32_t laneSeed {round * 1000 + static_cast<std::uint32_t>(lane) + 7};
+            for (auto& byte : memory)
+                byte = random(laneSeed);
+            std::copy(code.begin(), code.end(), memory.begin() + 0x100);
+            const std::uint8_t prologue[] {0x31, 0x40, 0x00, 0xF1, 0xC1, 0xD1, 0xE1, 0x31, memory[0x50], memory[0x51],
+                0xC3, 0x00, 0x01};
+            std::copy(std::begin(prologue), std::end(prologue), memory.begin() + 0x80);
+        }
+        if (!compare("round " + std::to_string(round), *memories, 0x80, 20000))
+            return 1;
+    }
+    std::cout << "*** random code matches in every lane\n";
+
+    for (const std::string testName : {"TST8080.COM", "8080PRE.COM"}) {
+        std::ifstream file {testDirectory + testName, std::ios::binary};
+        if (!file.is_open()) {
+            std::cerr << "error: can't open file '" << testDirectory + testName
+                      << "'. Ensure you're in the correct directory: 'Intel8080/'.\n";
+            return 1;
+        }
+        const std::vector<std::uint8_t> image {std::istreambuf_iterator<char> {file}, std::istreambuf_iterator<char> {}};
+
+        // HLT where the program ends, "out 1,a; ret" for the CP/M calls (whose output is ignored)
+        for (Memory& memory : *memories) {
+            memory = {};
+            std::copy(image.begin(), image.end(), memory.begin() + 0x100);
+            memory[0x0000] = 0x76;
+            memory[0x0005] = 0xD3;
+            memory[0x0006] = 0x01;
+            memory[0x0007] = 0xC9;
+        }
+        if (!compare(testName, *memories, 0x100, ~0ULL))
+            return 1;
+        std::cout << "*** " << testName << " matches in every lane\n";
+    }
+
+    return 0;
+}
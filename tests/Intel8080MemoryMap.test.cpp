@@ -0,0 +1,131 @@
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "Intel8080Core.h"
+#include "Intel8080MemoryMap.h"
+
+// Runs TST8080 out of RAM mapped through the page table, with step() and with tick(), then checks ROM, unmapped pages,
+// devices, mirrors and a program that switches banks from under itself.
+
+static constexpr std::string testDirectory {"tests/binaries/"};
+
+// "out 0" ends the diagnostic, anything else is thrown away
+struct Machine : Intel8080MemoryMap {
+    static std::uint8_t in(std::uint8_t) { return 0U; }
+    void out(const std::uint8_t port, std::uint8_t) { running = running and port != 0; }
+
+    bool running {true};
+};
+
+// a latch at F000 that selects which of two banks is at 8000-80FF, and counts what it's asked for
+class Banks : public Intel8080MemoryMap::Device {
+public:
+    explicit Banks(Intel8080MemoryMap& map) : map_ {map} { select(0); }
+
+    std::uint8_t read(const std::uint16_t addr) override
+    {
+        ++reads;
+        return static_cast<std::uint8_t>(addr);
+    }
+
+    void write(std::uint16_t, const std::uint8_t val) override
+    {
+        ++writes;
+        select(val & 1U);
+    }
+
+    void select(const int bank) { map_.mapRam(0x80, banks[bank]); }
+
+    std::array<std::array<std::uint8_t, 0x100>, 2> banks {};
+    int reads {0}, writes {0};
+private:
+    Intel8080MemoryMap& map_;
+};
+
+int main()
+{
+    std::ifstream file {testDirectory + "TST8080.COM", std::ios::binary};
+    if (!file.is_open()) {
+        std::cerr << "error: can't open file '" << testDirectory + "TST8080.COM"
+                  << "'. Ensure you're in the correct directory: 'Intel8080/'.\n";
+        return 1;
+    }
+    const std::vector<std::uint8_t> image {std::istreambuf_iterator<char> {file}, std::istreambuf_iterator<char> {}};
+    std::array<std::uint8_t, 0x10000> ram {};
+    std::copy(image.begin(), image.end(), ram.begin() + 0x100);
+    // "out 0,a" at 0x0000 and "out 1,a; ret" at 0x0005
+    for (const auto& [addr, val] : {std::pair {0x0000, 0xD3}, {0x0001, 0x00}, {0x0005, 0xD3}, {0x0006, 0x01}, {0x0007, 0xC9}})
+        ram[addr] = val;
+    const std::array<std::uint8_t, 0x10000> fresh {ram};
+
+    // an instruction at a time
+    Intel8080Core<Machine> stepped {};
+    stepped.bus.mapRam(0x00, ram);
+    stepped.reset();
+    stepped.pc = 0x100;
+    std::uint64_t cycles {0};
+    while (stepped.bus.running)
+        cycles += stepped.step();
+    if (cycles != 4924) {
+        std::cout << "FAIL: TST8080.COM took " << cycles << " states with step() (expected 4924)\n";
+        return 1;
+    }
+
+    // a state at a time, with the map answering the pins
+    ram = fresh;
+    Machine machine {};
+    machine.mapRam(0x00, ram);
+    Intel8080 ticked {};
+    ticked.reset();
+    ticked.pc = 0x100;
+    for (cycles = 0; machine.running; ++cycles) {
+        ticked.tick();
+        if (!machine.access(ticked) and ticked.pins & Intel8080::WR and ticked.status == Intel8080::outputWrite)
+            machine.out(ticked.getABus() & 0xFFU, ticked.getDBus());
+        else if (ticked.pins & Intel8080::DBIN and ticked.status == Intel8080::inputRead)
+            ticked.setDBus(std::uint_fast8_t {0});
+    }
+    ticked.tick(); // the rest of "out 0"
+    if (++cycles != 4924) {
+        std::cout << "FAIL: TST8080.COM took " << cycles << " states with tick() (expected 4924)\n";
+        return 1;
+    }
+
+    // ROM ignores writes, nothing mapped reads as 0xFF, and mirrors are the same memory
+    Intel8080MemoryMap map {};
+    const std::array<std::uint8_t, 0x200> rom {0x12};
+    std::array<std::uint8_t, 0x100> small {};
+    map.mapRom(0x00, rom);
+    map.mapRam(0x10, small);
+    map.mapRam(0x11, small);
+    map.write(0x0000, 0x34);
+    map.write(0x1005, 0x56);
+    if (map.read(0x0000) != 0x12 or rom[0] != 0x12 or map.read(0x0200) != 0xFF or map.read(0x1105) != 0x56
+        or map.page(0x01) != &rom[0x100] or map.page(0x02)) {
+        std::cout << "FAIL: ROM, unmapped pages or mirrors don't work\n";
+        return 1;
+    }
+
+    // 0000 MVI A,1 / STA F000 / LDA 8000 / STA 0100 / HLT, which reads bank 1 after selecting it
+    Intel8080Core<Machine> switching {};
+    Banks banks {switching.bus};
+    switching.bus.mapDevice(0xF0, 1, banks);
+    std::array<std::uint8_t, 0x200> low {0x3E, 0x01, 0x32, 0x00, 0xF0, 0x3A, 0x00, 0x80, 0x32, 0x00, 0x01, 0x76};
+    switching.bus.mapRam(0x00, low);
+    banks.banks[0][0] = 0xAA;
+    banks.banks[1][0] = 0xBB;
+    switching.reset();
+    switching.run(100);
+    if (low[0x100] != 0xBB or banks.writes != 1 or banks.reads != 0 or switching.bus.read(0xF042) != 0x42
+        or banks.reads != 1) {
+        std::cout << "FAIL: read " << +low[0x100] << " after switching banks\n";
+        return 1;
+    }
+
+    std::cout << "*** TST8080.COM ran out of mapped memory and every kind of page behaves\n";
+    return 0;
+}
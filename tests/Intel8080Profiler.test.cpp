@@ -0,0 +1,148 @@
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include "Intel8080Profiler.h"
+#include "Intel8080Scheduler.h"
+
+// Profiles a program with nested calls, a routine that throws its return address away and an interrupt handler, and
+// checks the folded stacks only ever hold the stacks the program can actually be in, in the right proportions. Then
+// profiles one that waits in HLT for its interrupts. What profiling costs is measured by Intel8080_bench.
+
+using Memory = std::array<std::uint8_t, 0x10000>;
+
+constexpr std::uint64_t duration {2000000};
+constexpr std::uint64_t interval {97};
+
+void put(Memory& memory, std::uint16_t addr, const std::initializer_list<std::uint8_t> code)
+{
+    for (const std::uint8_t byte : code)
+        memory[addr++] = byte;
+}
+
+// main:   0100 LXI SP,F000 / EI
+//         0104 CALL outer / CALL escape
+// outer:  0200 CALL inner / CALL inner / RET
+// inner:  0300 MVI B,20 / DCR B / JNZ 0302 / RET
+// escape: 0400 POP H / JMP 0104
+// isr:    0038 PUSH PSW / POP PSW / EI / RET
+Memory program()
+{
+    Memory memory {};
+    put(memory, 0x0100, {0x31, 0x00, 0xF0, 0xFB, 0xCD, 0x00, 0x02, 0xCD, 0x00, 0x04});
+    put(memory, 0x0200, {0xCD, 0x00, 0x03, 0xCD, 0x00, 0x03, 0xC9});
+    put(memory, 0x0300, {0x06, 0x14, 0x05, 0xC2, 0x02, 0x03, 0xC9});
+    put(memory, 0x0400, {0xE1, 0xC3, 0x04, 0x01});
+    put(memory, 0x0038, {0xF5, 0xF1, 0xFB, 0xC9});
+    return memory;
+}
+
+// main: 0100 LXI SP,F000 / EI
+// idle: 0104 HLT
+// loop: 0105 JMP 0104
+// isr:  0038 EI / RET
+Memory halting()
+{
+    Memory memory {};
+    put(memory, 0x0100, {0x31, 0x00, 0xF0, 0xFB, 0x76, 0xC3, 0x04, 0x01});
+    put(memory, 0x0038, {0xFB, 0xC9});
+    return memory;
+}
+
+// runs a program with an interrupt every 1000 states and a sample every interval, the way the profiler's header says to
+void run(const Memory& image, Intel8080Profiler& profiler)
+{
+    Memory memory {image};
+    Intel8080 intel8080 {};
+    intel8080.reset();
+    intel8080.pc = 0x100;
+    Intel8080Scheduler scheduler {};
+    scheduler.every(1000, 1000, [&intel8080](std::uint64_t) { intel8080.pins |= Intel8080::INT; });
+    scheduler.every(interval, interval, [&profiler](std::uint64_t) { profiler.takeSample(); });
+
+    for (std::uint64_t elapsed {0}; elapsed < duration;) {
+        elapsed += scheduler.runUntil(intel8080, Intel8080::DBIN | Intel8080::WR, duration - elapsed);
+        profiler.update(intel8080);
+
+        if (intel8080.pins & Intel8080::DBIN
+            and (intel8080.status == Intel8080::interruptAck or intel8080.status == Intel8080::interruptAckWhileHalt)) {
+            intel8080.setDBus(std::uint_fast8_t {0xFF}); // RST 7
+            intel8080.pins &= ~Intel8080::INT;
+        } else if (intel8080.pins & Intel8080::DBIN) {
+            intel8080.setDBus(std::uint_fast8_t {memory[intel8080.getABus()]});
+        } else if (intel8080.pins & Intel8080::WR and intel8080.status != Intel8080::outputWrite) {
+            memory[intel8080.getABus()] = intel8080.getDBus();
+        }
+    }
+}
+
+std::map<std::string, std::uint64_t> profile(Intel8080Profiler& profiler, const Memory& image)
+{
+    run(image, profiler);
+    std::stringstream folded {};
+    profiler.writeFolded(folded);
+    std::map<std::string, std::uint64_t> stacks {};
+    std::string stack {};
+    for (std::uint64_t count {}; folded >> stack >> count;)
+        stacks[stack] = count;
+    return stacks;
+}
+
+int main()
+{
+    Intel8080Profiler profiler {};
+    std::istringstream map {"0100 main\n0x0200 outer\n0300h inner\n; not a symbol\n0400 escape\n0038 isr\n"};
+    if (profiler.loadSymbols(map) != 5) {
+        std::cout << "FAIL: didn't read the 5 symbols\n";
+        return 1;
+    }
+
+    const std::map<std::string, std::uint64_t> stacks {profile(profiler, program())};
+    std::uint64_t total {0}, isr {0};
+    for (const auto& [stack, count] : stacks) {
+        total += count;
+        const std::string outside {stack.ends_with(";isr") ? stack.substr(0, stack.size() - 4) : stack};
+        isr += stack.ends_with(";isr") ? count : 0;
+        if (outside != "main" and outside != "main;outer" and outside != "main;outer;inner" and outside != "main;escape") {
+            std::cout << "FAIL: sampled a stack the program can't be in: " << stack << '\n';
+            return 1;
+        }
+    }
+    if (total != duration / interval or total != profiler.samples()) {
+        std::cout << "FAIL: took " << total << " samples (expected " << duration / interval << ")\n";
+        return 1;
+    }
+    // inner's loop is most of the time, the 4 instructions of the handler every 1000 states about 4%
+    if (stacks.at("main;outer;inner") < total * 3 / 4 or isr < total / 50 or isr > total / 10) {
+        std::cout << "FAIL: " << stacks.at("main;outer;inner") << " samples in inner and " << isr << " in isr out of "
+                  << total << '\n';
+        return 1;
+    }
+
+    // without symbols, routines go by the address they were called at
+    Intel8080Profiler anonymous {};
+    const std::map<std::string, std::uint64_t> addresses {profile(anonymous, program())};
+    if (!addresses.contains("0100;0200;0300") or !addresses.contains("0100;0200;0300;0038")) {
+        std::cout << "FAIL: the stacks weren't named by address\n";
+        return 1;
+    }
+
+    // the samples that come due while halted go to the HLT once the interrupt acknowledge ends the halt
+    Intel8080Profiler waiting {};
+    std::istringstream halts {"0100 main\n0104 idle\n0105 loop\n0038 isr\n"};
+    waiting.loadSymbols(halts);
+    const std::map<std::string, std::uint64_t> idle {profile(waiting, halting())};
+    if (waiting.samples() != duration / interval or !idle.contains("main;idle") or !idle.contains("main;isr")
+        or idle.at("main;idle") < waiting.samples() * 9 / 10) {
+        std::cout << "FAIL: " << (idle.contains("main;idle") ? idle.at("main;idle") : 0) << " of "
+                  << waiting.samples() << " samples in HLT\n";
+        return 1;
+    }
+
+    for (const auto& [stack, count] : stacks)
+        std::cout << stack << ' ' << count << '\n';
+    std::cout << "*** " << total << " samples, all of them in stacks the program can be in\n";
+    return 0;
+}
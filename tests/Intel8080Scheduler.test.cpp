@@ -0,0 +1,137 @@
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Intel8080Core.h"
+#include "Intel8080Scheduler.h"
+
+// Checks events run in order and can be cancelled, then that a timer raising INT from the scheduler is acknowledged on
+// exactly the same states as the host raising it between calls of tick(), and that it wakes a halted processor on time.
+
+using Memory = std::array<std::uint8_t, 0x10000>;
+
+constexpr std::uint64_t duration {100000};
+constexpr std::uint64_t period {1000};
+
+// 0000 LXI SP,F000 / EI / INR B (or HLT) / JMP 0003, and at 0038 INR C / RET
+Memory program(const bool halt)
+{
+    Memory memory {};
+    const auto put {[&memory](std::uint16_t addr, std::initializer_list<std::uint8_t> code) {
+        for (const std::uint8_t byte : code)
+            memory[addr++] = byte;
+    }};
+    put(0x0000, {0x31, 0x00, 0xF0, 0xFB, static_cast<std::uint8_t>(halt ? 0x76 : 0x04), 0xC3, 0x03, 0x00});
+    put(0x0038, {0x0C, 0xC9});
+    return memory;
+}
+
+// answers the pins of the state tick() or runUntil() just ran, and notes the clock at every interrupt acknowledge
+void serve(Intel8080& intel8080, Memory& memory, std::vector<std::uint64_t>& acknowledged)
+{
+    if (intel8080.pins & Intel8080::DBIN and (intel8080.status == Intel8080::interruptAck
+                                              or intel8080.status == Intel8080::interruptAckWhileHalt)) {
+        intel8080.setDBus(std::uint_fast8_t {0xFF}); // RST 7
+        intel8080.pins &= ~Intel8080::INT;
+        acknowledged.push_back(intel8080.clock());
+    } else if (intel8080.pins & Intel8080::DBIN) {
+        intel8080.setDBus(std::uint_fast8_t {memory[intel8080.getABus()]});
+    } else if (intel8080.pins & Intel8080::WR and intel8080.status != Intel8080::outputWrite) {
+        memory[intel8080.getABus()] = intel8080.getDBus();
+    }
+}
+
+struct Machine {
+    std::uint8_t read(const std::uint16_t addr) const { return memory[addr]; }
+    void write(const std::uint16_t addr, const std::uint8_t val) { memory[addr] = val; }
+    static std::uint8_t in(std::uint8_t) { return 0U; }
+    static void out(std::uint8_t, std::uint8_t) {}
+
+    std::uint8_t acknowledge()
+    {
+        cpu->pins &= ~Intel8080::INT;
+        acknowledged.push_back(cpu->clock());
+        return 0xFFU; // RST 7
+    }
+
+    Memory memory {program(true)};
+    Intel8080* cpu {nullptr};
+    std::vector<std::uint64_t> acknowledged {};
+};
+
+int main()
+{
+    // events due at the same cycle go in the order they were scheduled, even ones scheduled while dispatching
+    Intel8080Scheduler scheduler {};
+    std::string order {};
+    scheduler.at(30, [&](std::uint64_t) { order += 'a'; });
+    scheduler.at(10, [&](std::uint64_t) {
+        order += 'b';
+        scheduler.at(10, [&](std::uint64_t) { order += 'e'; });
+    });
+    scheduler.at(10, [&](std::uint64_t) { order += 'c'; });
+    const std::uint64_t cancelled {scheduler.at(20, [&](std::uint64_t) { order += 'x'; })};
+    const std::uint64_t periodic {scheduler.every(5, 10, [&](std::uint64_t cycle) {
+        order += static_cast<char>('0' + cycle / 10);
+        if (cycle == 25)
+            scheduler.cancel(periodic);
+    })};
+    scheduler.cancel(cancelled);
+    if (scheduler.dispatch(9) != 1 or scheduler.next() != 10 or scheduler.dispatch(100) != 6 or order != "0bce12a"
+        or !scheduler.empty()) {
+        std::cout << "FAIL: events ran in the order '" << order << "' (expected '0bce12a')\n";
+        return 1;
+    }
+
+    std::vector<std::uint64_t> due {};
+    for (std::uint64_t cycle {period}; cycle < duration; cycle += period)
+        due.push_back(cycle);
+
+    // the host raising INT between ticks when it's due
+    Memory memory {program(false)};
+    Intel8080 ticked {};
+    ticked.reset();
+    std::vector<std::uint64_t> polled {};
+    for (std::uint64_t cycle {0}; cycle < duration; ++cycle) {
+        if (cycle != 0 and cycle % period == 0)
+            ticked.pins |= Intel8080::INT;
+        ticked.tick();
+        serve(ticked, memory, polled);
+    }
+
+    // and the scheduler doing it, with the processor running from pin event to pin event in between
+    memory = program(false);
+    Intel8080 scheduled {};
+    scheduled.reset();
+    Intel8080Scheduler timer {};
+    timer.every(period, period, [&scheduled](std::uint64_t) { scheduled.pins |= Intel8080::INT; });
+    std::vector<std::uint64_t> dispatched {};
+    for (std::uint64_t elapsed {0}; elapsed < duration;) {
+        elapsed += timer.runUntil(scheduled, Intel8080::SYNC | Intel8080::DBIN | Intel8080::WR, duration - elapsed);
+        serve(scheduled, memory, dispatched);
+    }
+    const Intel8080::State a {ticked.saveState()}, b {scheduled.saveState()};
+    if (polled.size() != due.size() or dispatched != polled or std::memcmp(&a, &b, sizeof(a)) != 0 or a.clock != duration) {
+        std::cout << "FAIL: " << dispatched.size() << " interrupts from the scheduler and " << polled.size()
+                  << " from polling, or they ended up in different states\n";
+        return 1;
+    }
+
+    // a halted processor is woken by every interrupt right when it's due
+    Intel8080Core<Machine> halted {};
+    halted.bus.cpu = &halted;
+    halted.reset();
+    Intel8080Scheduler wakeUp {};
+    wakeUp.every(period, period, [&halted](std::uint64_t) { halted.pins |= Intel8080::INT; });
+    const std::uint64_t elapsed {wakeUp.run(halted, duration)};
+    if (halted.bus.acknowledged != due or halted.getReg(Intel8080::C) != due.size() or elapsed != halted.clock()) {
+        std::cout << "FAIL: " << halted.bus.acknowledged.size() << " of " << due.size()
+                  << " interrupts woke the processor on time\n";
+        return 1;
+    }
+
+    std::cout << "*** " << halted.bus.acknowledged.size() << " interrupts from the scheduler, every one on time\n";
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Intel8080Core.h"
+#include "Intel8080Memory.h"
+
+// Takes snapshots of the diagnostics part way through, on both engines and in the middle of an instruction for tick(),
+// and checks that the original and every copy go on to finish with the same states, output and final state, and that
+// forked memory stays separate once written.
+
+static constexpr std::string testDirectory {"tests/binaries/"};
+
+// "out 1" is a CP/M call (print a character or a string), "out 0" is the end of the test
+struct Machine {
+    std::uint8_t read(const std::uint16_t addr) const { return memory.read(addr); }
+    void write(const std::uint16_t addr, const std::uint8_t val) { memory.write(addr, val); }
+    static std::uint8_t in(std::uint8_t) { return 0U; }
+
+    void out(const Intel8080& intel8080, const std::uint8_t port)
+    {
+        if (port == 0) {
+            running = false;
+        } else if (intel8080.getReg(Intel8080::C) == 9) {
+            for (std::uint16_t addr {intel8080.getPair(Intel8080::DE)}; memory.read(addr) != '$'; ++addr)
+                output.push_back(static_cast<char>(memory.read(addr)));
+        } else if (intel8080.getReg(Intel8080::C) == 2) {
+            output.push_back(static_cast<char>(intel8080.getReg(Intel8080::E)));
+        }
+    }
+
+    Intel8080Memory memory {};
+    std::string output {};
+    bool running {true};
+};
+
+// Intel8080Core needs out() to only take the port and value, so the processor goes along in the policy
+struct Bus {
+    std::uint8_t read(const std::uint16_t addr) const { return machine.read(addr); }
+    void write(const std::uint16_t addr, const std::uint8_t val) { machine.write(addr, val); }
+    static std::uint8_t in(std::uint8_t) { return 0U; }
+    void out(const std::uint8_t port, std::uint8_t) { machine.out(*intel8080, port); }
+
+    Machine machine {};
+    const Intel8080* intel8080 {nullptr};
+};
+
+struct Run {
+    std::uint64_t cycles;
+    std::string output;
+    Intel8080::State state;
+};
+
+bool same(const Run& a, const Run& b)
+{
+    return a.cycles == b.cycles and a.output == b.output and std::memcmp(&a.state, &b.state, sizeof(a.state)) == 0;
+}
+
+// runs an instruction at a time until "out 0"
+Run finish(Intel8080Core<Bus>& intel8080, std::uint64_t cycles)
+{
+    intel8080.bus.intel8080 = &intel8080;
+    while (intel8080.bus.machine.running)
+        cycles += intel8080.step();
+    return {cycles, intel8080.bus.machine.output, intel8080.saveState()};
+}
+
+// runs a state at a time until "out 0" or the given number of states, doing what the pins ask for
+Run tick(Intel8080& intel8080, Machine& machine, std::uint64_t cycles, const std::uint64_t until = ~0ULL)
+{
+    while (machine.running and cycles < until) {
+        intel8080.tick();
+        ++cycles;
+        if (intel8080.pins & Intel8080::DBIN)
+            intel8080.setDBus(std::uint_fast8_t {intel8080.status == Intel8080::inputRead ? std::uint8_t {0}
+                : machine.read(intel8080.getABus())});
+        else if (intel8080.pins & Intel8080::WR and intel8080.status == Intel8080::outputWrite)
+            machine.out(intel8080, intel8080.getABus() & 0xFFU);
+        else if (intel8080.pins & Intel8080::WR)
+            machine.write(intel8080.getABus(), intel8080.getDBus());
+    }
+    return {cycles, machine.output, intel8080.saveState()};
+}
+
+int main()
+{
+    for (const std::string testName : {"TST8080.COM", "8080PRE.COM", "CPUTEST.COM"}) {
+        std::ifstream file {testDirectory + testName, std::ios::binary};
+        if (!file.is_open()) {
+            std::cerr << "error: can't open file '" << testDirectory + testName
+                      << "'. Ensure you're in the correct directory: 'Intel8080/'.\n";
+            return 1;
+        }
+        const std::vector<std::uint8_t> image {std::istreambuf_iterator<char> {file}, std::istreambuf_iterator<char> {}};
+
+        Machine machine {};
+        machine.memory.load(0x100, image);
+        // the same "out 0,a" and "out 1,a; ret" as Intel8080.test.cpp
+        machine.memory.load(0x0000, std::vector<std::uint8_t> {0xD3, 0x00, 0x00, 0x00, 0x00, 0xD3, 0x01, 0xC9});
+
+        // instruction-stepped: fork by copying the processor along with its memory, and by saving the state
+        Intel8080Core<Bus> original {Bus {machine}};
+        original.reset();
+        original.pc = 0x100;
+        original.bus.intel8080 = &original;
+        std::uint64_t prefix {0};
+        while (prefix < 3000)
+            prefix += original.step();
+
+        Intel8080Core<Bus> copy {original};
+        const Intel8080::State state {original.saveState()};
+        const Machine snapshot {original.bus.machine};
+        if (&copy.ir == &original.ir or copy.ir != original.ir) {
+            std::cout << "FAIL: " << testName << " copy's ir isn't its own\n";
+            return 1;
+        }
+
+        const Run expected {finish(original, prefix)};
+        Intel8080Core<Bus> restored {Bus {snapshot}};
+        restored.loadState(state);
+        for (const Run& run : {finish(copy, prefix), finish(restored, prefix)}) {
+            if (!same(run, expected)) {
+                std::cout << "FAIL: " << testName << " took " << run.cycles << " states after forking (expected "
+                          << expected.cycles << ")\n";
+                return 1;
+            }
+        }
+
+        // state-stepped: snapshot 1001 states in, which is in the middle of an instruction
+        Intel8080 ticked {};
+        Machine tickedMachine {machine};
+        ticked.reset();
+        ticked.pc = 0x100;
+        (void)tick(ticked, tickedMachine, 0, 1001);
+        const Intel8080::State midInstruction {ticked.saveState()};
+        Machine resumedMachine {tickedMachine};
+
+        const Run tickExpected {tick(ticked, tickedMachine, 1001)};
+        Intel8080 resumed {};
+        resumed.loadState(midInstruction);
+        const Run tickRun {tick(resumed, resumedMachine, 1001)};
+        if (!same(tickRun, tickExpected) or tickRun.output != expected.output) {
+            std::cout << "FAIL: " << testName << " took " << tickRun.cycles << " states resumed mid-instruction"
+                      << " (expected " << tickExpected.cycles << ")\n";
+            return 1;
+        }
+
+        std::cout << "*** " << testName << ": " << expected.cycles << " states with every snapshot\n";
+    }
+
+    // forks share pages until they write to them
+    Intel8080Memory memory {};
+    memory.write(0x1234, 0x56);
+    Intel8080Memory fork {memory.fork()};
+    if (&fork.page(0x12) != &memory.page(0x12)) {
+        std::cout << "FAIL: a fork copied a page it didn't write to\n";
+        return 1;
+    }
+    fork.write(0x1234, 0x78);
+    if (&fork.page(0x12) == &memory.page(0x12) or memory.read(0x1234) != 0x56 or fork.read(0x1234) != 0x78
+        or &fork.page(0x13) != &memory.page(0x13)) {
+        std::cout << "FAIL: writing to a fork changed the original\n";
+        return 1;
+    }
+    const Intel8080Memory::Page* const shared {&memory.page(0x13)};
+    memory.write(0x1300, 0x9A);
+    const Intel8080Memory::Page* const copied {&memory.page(0x13)};
+    memory.write(0x1301, 0xBC);
+    if (copied == shared or &memory.page(0x13) != copied or fork.read(0x1300) != 0x00) {
+        std::cout << "FAIL: the original didn't copy a page it shared once, and only once\n";
+        return 1;
+    }
+
+    // two forks of one page written at the same time on two threads each end up with a page of their own
+    std::vector<Intel8080Memory> forks {memory.fork(), memory.fork()};
+    std::vector<std::thread> writers {};
+    for (std::size_t i {0}; i < forks.size(); ++i) {
+        writers.emplace_back([&forks, i] {
+            for (std::uint16_t addr {0x1200}; addr < 0x1300; ++addr)
+                forks[i].write(addr, static_cast<std::uint8_t>(i + 1));
+        });
+    }
+    for (std::thread& writer : writers)
+        writer.join();
+    if (&forks[0].page(0x12) == &forks[1].page(0x12) or memory.read(0x1234) != 0x56 or forks[0].read(0x1234) != 1
+        or forks[1].read(0x1234) != 2) {
+        std::cout << "FAIL: forks written on two threads shared a page\n";
+        return 1;
+    }
+    std::cout << "*** forked memory is copied on write\n";
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Intel8080Trace.h"
+
+// Records more than the ring buffer holds as fast as possible, and checks everything that wasn't dropped comes out in
+// order and intact, with or without the index, and that the reader knows how many were dropped at every gap. Then that
+// a record renders the same as the text -debug used to print, and parses back.
+
+std::vector<std::uint8_t> bytes(const std::stringstream& out)
+{
+    const std::string text {out.str()};
+    return {text.begin(), text.end()};
+}
+
+int main()
+{
+    constexpr std::uint64_t count {1000000};
+
+    Intel8080 intel8080 {};
+    intel8080.reset();
+    std::stringstream out {};
+    std::uint64_t dropped {0};
+    {
+        Intel8080Trace trace {out, 1000, 64}; // 1024
+        for (std::uint64_t cycle {0}; cycle < count; ++cycle) {
+            intel8080.pc = static_cast<std::uint16_t>(cycle / 3);
+            // the cycle goes back to 0 halfway, like the next test of Intel8080_test
+            const std::uint8_t half {cycle >= count / 2};
+            trace.record(intel8080, cycle - half * count / 2, {static_cast<std::uint8_t>(cycle / 7), half, 2, 3});
+        }
+        dropped = trace.dropped();
+    }
+    const std::vector<std::uint8_t> file {bytes(out)};
+
+    Intel8080TraceReader reader {};
+    if (!reader.open(file)) {
+        std::cout << "FAIL: the trace can't be read\n";
+        return 1;
+    }
+    std::vector<Intel8080Trace::Record> records {};
+    std::uint64_t last {0}, gaps {0};
+    for (Intel8080Trace::Record record {}; reader.next(record);) {
+        const std::uint64_t cycle {record.cycle + record.code[1] * count / 2};
+        if ((!records.empty() and cycle <= last) or record.pc != static_cast<std::uint16_t>(cycle / 3)
+            or record.code[0] != static_cast<std::uint8_t>(cycle / 7) or record.code[3] != 3) {
+            std::cout << "FAIL: record " << records.size() << " (cycle " << record.cycle << ") is out of order or garbled\n";
+            return 1;
+        }
+        // one record per cycle, so the cycles skipped are the records dropped
+        if (reader.gap() != (records.empty() ? cycle : cycle - last - 1)) {
+            std::cout << "FAIL: a gap of " << reader.gap() << " records before cycle " << cycle << '\n';
+            return 1;
+        }
+        gaps += reader.gap();
+        last = cycle;
+        records.push_back(record);
+    }
+    // the ones dropped at the very end have no record after them to say so
+    if (records.size() + dropped != count or records.size() < 1024 or gaps + count - 1 - last != dropped) {
+        std::cout << "FAIL: read " << records.size() << " records and dropped " << dropped << " of " << count << ", "
+                  << gaps << " of them in gaps\n";
+        return 1;
+    }
+    if (reader.keyframes().size() != (records.size() + 63) / 64 or file.size() >= records.size() * sizeof(Intel8080Trace::Record) / 2) {
+        std::cout << "FAIL: " << reader.keyframes().size() << " keyframes and " << file.size() << " bytes for "
+                  << records.size() << " records\n";
+        return 1;
+    }
+
+    // seeking starts from the keyframe before, and reads the same records from there
+    const std::uint64_t middle {records.size() / 2 + 5};
+    reader.seek(middle);
+    Intel8080Trace::Record record {};
+    while (reader.position() <= middle and reader.next(record)) {}
+    if (reader.position() != middle + 1 or record != records[middle]) {
+        std::cout << "FAIL: seeking to record " << middle << " got to " << reader.position() - 1 << '\n';
+        return 1;
+    }
+
+    // without the index, e.g. when the emulator crashed, up to where it was cut off
+    const std::vector<std::uint8_t> cut {file.begin(), file.begin() + static_cast<std::ptrdiff_t>(file.size() / 2)};
+    Intel8080TraceReader unindexed {};
+    std::uint64_t read {0};
+    for (bool ok {unindexed.open(cut)}; ok and unindexed.next(record); ++read) {
+        if (record != records[read]) {
+            std::cout << "FAIL: record " << read << " of the cut off trace is different\n";
+            return 1;
+        }
+    }
+    if (!unindexed.keyframes().empty() or read < records.size() / 3) {
+        std::cout << "FAIL: read " << read << " records of a trace cut off halfway\n";
+        return 1;
+    }
+
+    // a gap where a keyframe is due anyway is in the index, one in between isn't
+    Intel8080Trace::Encoder encoder {4};
+    std::vector<std::uint8_t> gapped {};
+    encoder.begin(gapped);
+    for (std::uint64_t i {0}; i < 10; ++i)
+        encoder.add({i, static_cast<std::uint16_t>(i), 0, 0, 0, 0, 0, {}}, gapped, i == 4 ? 7 : i == 6 ? 1 : 0);
+    encoder.end(gapped);
+    std::vector<std::uint64_t> found {};
+    for (bool ok {reader.open(gapped)}; ok and reader.next(record);)
+        found.push_back(record.pc == reader.position() - 1 ? reader.gap() : 99);
+    reader.seek(7);
+    while (reader.position() < 7 and reader.next(record)) {}
+    if (found != std::vector<std::uint64_t> {0, 0, 0, 0, 7, 0, 1, 0, 0, 0} or reader.keyframes().size() != 3
+        or !reader.next(record) or record.pc != 7 or reader.gap() != 0) {
+        std::cout << "FAIL: the gaps of 7 and 1 records didn't read back\n";
+        return 1;
+    }
+
+    // the same line Intel8080_test -debug printed at the first instruction of TST8080.COM
+    Intel8080 fresh {};
+    fresh.reset();
+    fresh.pc = 0x100;
+    std::stringstream one {};
+    {
+        Intel8080Trace trace {one};
+        trace.record(fresh, 0, {0xC3, 0xB2, 0x01, 0x4D});
+    }
+    const std::vector<std::uint8_t> first {bytes(one)};
+    const std::string expected {
+            "PC: 0100, AF: 0002, BC: 0000, DE: 0000, HL: 0000, SP: 0000, CYC: 0\t(C3 B2 01 4D) - jmp $"};
+    Intel8080Trace::Record parsed {};
+    if (!reader.open(first) or !reader.next(record) or Intel8080Trace::render(record) != expected
+        or !Intel8080Trace::parse(expected, parsed) or parsed != record or Intel8080Trace::parse("\tFETCH CYCLE", parsed)) {
+        std::cout << "FAIL: rendered '" << Intel8080Trace::render(record) << "'\n";
+        return 1;
+    }
+
+    std::cout << "*** " << records.size() << " records written in order in " << file.size() << " bytes, " << dropped
+              << " dropped while the buffer was full\n";
+    return 0;
+}